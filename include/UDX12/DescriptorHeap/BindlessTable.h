@@ -0,0 +1,83 @@
+#pragma once
+
+#include "DescriptorHeapAllocation.h"
+#include "DescriptorCopyBatch.h"
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace Ubpa::UDX12 {
+    class GPUDescriptorHeap;
+
+    // Stable indices of resource descriptors in one large range of the static part of a GPUDescriptorHeap.
+    // Shaders index the range directly (bindless), so draws don't set up descriptor tables:
+    //
+    //   GPUDescriptorHeap static part
+    //   | X X O X | 0  1  2  3  4  5  6  7  8  9 ... NumIndices-1 |  O  X  O |
+    //              '-- m_Range, bound once as a descriptor table --'
+    //
+    //   free indices : [5, 2]  (stack, O(1))       m_NumUsedIndices = 9 (indices past it were never used)
+    //   stale indices: {fence 7: 3}, {fence 8: 6}  recycled once the fence completes
+    //
+    // A freed index may still be referenced by command lists in flight, so Free() tags it with the current
+    // frame fence value and ReleaseStaleIndices() recycles it once that fence completes.
+    // Descriptors are written by queued copies from CPU descriptor heaps, FlushWrites() issues all of them
+    // with one ID3D12Device::CopyDescriptors() (it must be called before the command lists that use the indices
+    // are executed). All methods are thread-safe.
+    class BindlessTable {
+    public:
+        static constexpr uint32_t InvalidIndex = static_cast<uint32_t>(-1);
+
+        BindlessTable(ID3D12Device* pDevice, GPUDescriptorHeap& Heap, uint32_t NumIndices);
+
+        BindlessTable            (const BindlessTable&) = delete;
+        BindlessTable            (BindlessTable&&)      = delete;
+        BindlessTable& operator= (const BindlessTable&) = delete;
+        BindlessTable& operator= (BindlessTable&&)      = delete;
+
+        ~BindlessTable();
+
+        // O(1), returns InvalidIndex if the table is full
+        uint32_t Allocate();
+        // Allocates an index and queues the copy of the descriptor Src to it
+        uint32_t Allocate(D3D12_CPU_DESCRIPTOR_HANDLE Src);
+        // The index is recycled once the current frame fence value completes
+        void     Free(uint32_t Index);
+
+        // Queues the copy of the descriptor Src to Index, an index is written at most once per flush
+        void     Write(uint32_t Index, D3D12_CPU_DESCRIPTOR_HANDLE Src);
+        DescriptorCopyBatch::FlushStats FlushWrites();
+
+        // Indices freed from now on are recycled once CompletedFenceValue >= FenceValue
+        void SetFrameFenceValue(uint64_t FenceValue);
+        void ReleaseStaleIndices(uint64_t CompletedFenceValue);
+
+        // The table base, e.g. for SetGraphicsRootDescriptorTable()
+        D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle() const noexcept { return m_Range.GetGpuHandle(); }
+        // For views created directly in the table
+        D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(uint32_t Index) const noexcept { return m_Range.GetCpuHandle(Index); }
+        // The index of the table base in the whole heap (e.g. for ResourceDescriptorHeap[] in SM 6.6)
+        uint32_t GetHeapOffset() const noexcept { return m_HeapOffset; }
+
+        uint32_t GetNumIndices() const noexcept { return m_Range.GetNumHandles(); }
+        // Allocated and stale indices
+        uint32_t GetNumUsedIndices();
+
+    private:
+        struct StaleIndex {
+            uint64_t FenceValue;
+            uint32_t Index;
+        };
+
+        DescriptorHeapAllocation m_Range;
+        uint32_t                 m_HeapOffset;
+
+        std::mutex             m_Mutex;
+        uint32_t               m_NumUsedIndices{ 0 };
+        std::vector<uint32_t>  m_FreeIndices;
+        uint64_t               m_FenceValue{ 0 };
+        std::deque<StaleIndex> m_StaleIndices;
+        DescriptorCopyBatch    m_Writes;
+    };
+}
@@ -6,9 +6,19 @@
 #pragma once
 
 #include "IDescriptorAllocator.h"
+#include "DescriptorHeapAllocation.h"
 #include "DescriptorHeapAllocMngr.h"
+#include "DescriptorReleaseQueue.h"
+#include "DescriptorTelemetry.h"
 
-#include <unordered_set>
+#include "../MaxSegmentTree.h"
+
+#include <atomic>
+#include <array>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <limits>
 
 namespace Ubpa::UDX12 {
 	// CPU descriptor heap is intended to provide storage for resource view descriptor handles.
@@ -18,23 +28,99 @@ namespace Ubpa::UDX12 {
     //           m_HeapPool[0]                m_HeapPool[1]                 m_HeapPool[2]
     //   |  X  X  X  X  X  X  X  X |, |  X  X  X  O  O  X  X  O  |, |  X  O  O  O  O  O  O  O  |
     //
-    //    X - used descriptor                m_AvailableHeaps = {1,2}
+    //    X - used descriptor                m_LargestFreeBlocks = {0, 2, 7}
     //    O - available descriptor
     //
-    // Allocation routine goes through the list of managers that have available descriptors and tries to process
-    // the request using every manager. If there are no available managers or no manager was able to handle the request,
-    // the function creates a new descriptor heap manager and lets it handle the request
+    // m_LargestFreeBlocks is a max segment tree over the manager IDs that holds the largest count every manager
+    // can allocate. Allocation routine looks up the first manager that can handle the request in O(log n).
+    // If there is no such manager, the function creates a new descriptor heap manager and lets it handle the request.
+    // The entry of a manager is updated after every allocation and free.
     //
     // Render device contains four CPUDescriptorHeap object instances (one for each D3D12 heap type). The heaps are accessed
     // when a texture or a buffer view is created.
     //
+    // If CacheSize > 0, allocations of at most MaxCachedCount descriptors go through per-thread caches (magazines)
+    // in front of the pool, so worker threads that create views in parallel rarely take m_HeapPoolMutex:
+    //
+    //   thread -> m_ThreadCaches[hash(thread id) % NumThreadCaches]
+    //               Magazines[Count - 1]  | A  A  A  A  .  .  .  . |   at most CacheSize allocations of Count descriptors
+    //                 empty on Allocate() : refill CacheSize / 2 allocations from the pool with one lock
+    //                 full on Free()      : return the older half to the pool with one lock
+    //
+    // A cache is guarded by a try-lock only. A thread that fails to take it (another thread hashed to the same cache)
+    // goes to the pool directly, so threads never wait on each other in the cache layer.
+    //
+    // If deferred release is enabled, Free() only tags the allocation with the current frame fence value.
+    // ReleaseStaleAllocations() returns all allocations whose fence has completed to the pool in one batch.
+    //
+    // Relocatable allocations are owned by the heap and referred to by an ID, so Compact() can move them.
+    // Compact() drains one heap at a time within a time budget: the heap is hidden from allocations, its
+    // relocatable allocations are copied to the other heaps (the owners are told the new handle by the
+    // relocation callback), and the heap is released once it is empty. Only heaps whose live allocations
+    // are all relocatable are drained.
+    //
+    //   before :  |  X  X  O  O  O  O  O  O  |, |  O  R  O  O  R  R  O  O  |      R - relocatable allocation
+    //   after  :  |  X  X  R  R  R  O  O  O  |, (released)
+    //
+    // The pool only grows on Allocate(). TrimIdleHeaps() is called once per frame and releases the heaps that
+    // have been fully free for TrimPolicy::NumIdleFrames frames, so the pool follows the working set after a spike:
+    //
+    //   idle frames :       0              3              1              3
+    //               |  X  X  O  O |, |  O  O  O  O |, |  O  O  O  O |, |  O  O  O  O |    NumIdleFrames = 3
+    //                                     released                       released
+    //
     class CPUDescriptorHeap final : public IDescriptorAllocator {
     public:
+        static constexpr uint32_t MaxCachedCount  = 4;
+        static constexpr size_t   NumThreadCaches = 64;
+
+        using RelocatableId = uint32_t;
+        static constexpr RelocatableId InvalidRelocatableId = static_cast<RelocatableId>(-1);
+        // Called after the allocation is moved, OldHandle only identifies the allocation and must not be used
+        using RelocationCallback = std::function<void(D3D12_CPU_DESCRIPTOR_HANDLE OldHandle, D3D12_CPU_DESCRIPTOR_HANDLE NewHandle)>;
+
+        struct TrimPolicy {
+            // Frames a heap must stay fully free before it is released (0 disables trimming)
+            uint32_t NumIdleFrames{ 0 };
+            // The pool never shrinks below MinNumHeaps heaps
+            size_t   MinNumHeaps{ 1 };
+            // Above MaxNumHeaps heaps, fully free heaps are released without waiting for NumIdleFrames
+            size_t   MaxNumHeaps{ std::numeric_limits<size_t>::max() };
+            // Hysteresis, a heap is released only if the remaining heaps keep at least
+            // NumReserveDescriptors available descriptors, so a pool at its working set doesn't
+            // create and release heaps every few frames
+            size_t   NumReserveDescriptors{ 0 };
+        };
+
+        struct TrimStats {
+            // TrimIdleHeaps() calls that released at least one heap
+            size_t NumTrimEvents{ 0 };
+            size_t NumTrimmedHeaps{ 0 };
+            size_t NumTrimmedDescriptors{ 0 };
+            size_t NumCreatedHeaps{ 0 };
+        };
+
+        struct CompactionStats {
+            size_t NumMovedAllocations{ 0 };
+            size_t NumMovedDescriptors{ 0 };
+            size_t NumReleasedHeaps{ 0 };
+            // No heap can be drained any more
+            bool   Finished{ false };
+        };
+
         // Initializes the heap
+        // Backend selects the free block index of every descriptor heap manager in the pool
+        // CacheSize is the capacity of every per-thread magazine (0 disables the caches)
+        // NumSlabDescriptors is the size of the single-descriptor slab of every descriptor heap manager (0 disables the slabs)
+        // NodeMask is the adapter node of every D3D12 descriptor heap in the pool
         CPUDescriptorHeap(ID3D12Device*               pDevice,
                           uint32_t                    NumDescriptorsInHeap,
                           D3D12_DESCRIPTOR_HEAP_TYPE  Type,
-                          D3D12_DESCRIPTOR_HEAP_FLAGS Flags);
+                          D3D12_DESCRIPTOR_HEAP_FLAGS Flags,
+                          VarSizeAllocMngr::Backend   Backend            = VarSizeAllocMngr::Backend::Tree,
+                          uint32_t                    CacheSize          = 0,
+                          uint32_t                    NumSlabDescriptors = 0,
+                          UINT                        NodeMask           = 1);
 
         CPUDescriptorHeap            (const CPUDescriptorHeap&) = delete;
         CPUDescriptorHeap            (CPUDescriptorHeap&&)      = delete;
@@ -46,21 +132,118 @@ namespace Ubpa::UDX12 {
         virtual DescriptorHeapAllocation Allocate(uint32_t Count) override final;
         virtual void                     Free(DescriptorHeapAllocation&& Allocation) override final;
         virtual uint32_t                 GetDescriptorSize() const noexcept override final { return m_DescriptorSize; }
+        // Lock timing covers m_HeapPoolMutex
+        virtual DescriptorTelemetry*     GetTelemetry() noexcept override final { return &m_Telemetry; }
+
+        // Returns all cached allocations to the pool
+        void FlushThreadCaches();
+
+        void EnableDeferredRelease(bool Enable) noexcept { m_DeferredRelease = Enable; }
+        // Allocations freed from now on are released once CompletedFenceValue >= FenceValue
+        void SetFrameFenceValue(uint64_t FenceValue) noexcept { m_ReleaseQueue.SetFenceValue(FenceValue); }
+        void ReleaseStaleAllocations(uint64_t CompletedFenceValue);
+
+        uint32_t GetCacheSize() const noexcept { return m_CacheSize; }
+
+        // Allocates Count descriptors that Compact() may move (InvalidRelocatableId on failure)
+        RelocatableId               AllocateRelocatable(uint32_t Count, RelocationCallback Callback);
+        void                        FreeRelocatable(RelocatableId Id);
+        // The current handle, may change at the next Compact()
+        D3D12_CPU_DESCRIPTOR_HANDLE GetRelocatableHandle(RelocatableId Id, uint32_t Offset = 0);
+
+        // Moves relocatable allocations out of sparse heaps and releases empty heaps until Budget is spent,
+        // the relocation callbacks are called on the calling thread without any lock held
+        CompactionStats Compact(std::chrono::microseconds Budget);
+
+        size_t GetNumHeaps();
+
+        void       SetTrimPolicy(const TrimPolicy& Policy);
+        TrimPolicy GetTrimPolicy();
+        // Updates the idle frame counters and releases the idle heaps, returns the number of released heaps
+        size_t     TrimIdleHeaps();
+        TrimStats  GetTrimStats();
 
     private:
+        struct alignas(64) ThreadCache {
+            std::atomic_flag                                                  Busy;
+            std::array<std::vector<DescriptorHeapAllocation>, MaxCachedCount> Magazines;
+        };
+
+        // The cache of the calling thread, nullptr if it is taken by another thread
+        ThreadCache* TryLockThreadCache() noexcept;
+
+        // Allocate() without the telemetry
+        DescriptorHeapAllocation AllocateFromCache(uint32_t Count);
+        DescriptorHeapAllocation AllocateFromPool(uint32_t Count);
+        // Fills a prefix of Allocations with allocations of Count descriptors, the rest stays null
+        void                     AllocateBatchFromPool(uint32_t Count, std::span<DescriptorHeapAllocation> Allocations);
+        void                     FreeToPool(DescriptorHeapAllocation&& Allocation);
+        void                     FreeBatchToPool(std::span<DescriptorHeapAllocation> Allocations);
+
+        // Creates a new descriptor heap manager that can allocate Count descriptors, returns its ID
+        size_t CreateHeap(uint32_t Count);
+        // Destroys an empty descriptor heap manager, its slot is reused by CreateHeap()
+        void   ReleaseHeap(size_t HeapIdx);
+        // The heap being drained takes no allocations
+        void   UpdateLargestFreeBlock(size_t HeapIdx) {
+            m_LargestFreeBlocks.Set(HeapIdx, HeapIdx == m_CompactionHeap ? 0 : m_HeapPool[HeapIdx]->GetMaxAllocatableCount());
+        }
+        uint32_t GetNumUsedDescriptors(size_t HeapIdx) const noexcept {
+            return m_HeapPool[HeapIdx]->GetMaxDescriptors() - static_cast<uint32_t>(m_HeapPool[HeapIdx]->GetNumAvailableDescriptors());
+        }
+
+        // Picks the heap to drain and fills m_CompactionQueue, guarded by m_HeapPoolMutex
+        bool BeginHeapCompaction();
+        void EndHeapCompaction();
+
         ID3D12Device* m_pDevice;
 
-        // Pool of descriptor heap managers
-        std::mutex                                    m_HeapPoolMutex;
-        std::vector<DescriptorHeapAllocMngr>          m_HeapPool;
-        // Indices of available descriptor heap managers
-        std::unordered_set<size_t>                    m_AvailableHeaps;
+        // Pool of descriptor heap managers, the pool index is the manager ID.
+        // A released manager leaves an empty slot that the next CreateHeap() reuses
+        std::mutex                                            m_HeapPoolMutex;
+        std::vector<std::unique_ptr<DescriptorHeapAllocMngr>> m_HeapPool;
+        // Largest allocatable count of every descriptor heap manager (0 for empty slots)
+        MaxSegmentTree                                        m_LargestFreeBlocks;
+        // Scratch buffer of AllocateBatchFromPool(), guarded by m_HeapPoolMutex
+        std::vector<uint32_t>                                 m_BatchCounts;
+
+        // Relocatable allocations, guarded by m_HeapPoolMutex
+        struct Relocatable {
+            DescriptorHeapAllocation Allocation;
+            RelocationCallback       Callback;
+        };
+        std::vector<Relocatable>   m_Relocatables;
+        std::vector<RelocatableId> m_FreeRelocatableIds;
+        // Number of descriptors in relocatable allocations of every heap
+        std::vector<uint32_t>      m_NumRelocatableDescriptors;
+
+        // Guarded by m_HeapPoolMutex
+        TrimPolicy            m_TrimPolicy;
+        TrimStats             m_TrimStats;
+        // Number of consecutive TrimIdleHeaps() calls that found the heap fully free, for every heap
+        std::vector<uint32_t> m_NumIdleFrames;
+
+        // Heap being drained by Compact() and its relocatable allocations to move, guarded by m_HeapPoolMutex
+        static constexpr size_t    InvalidHeapIdx = static_cast<size_t>(-1);
+        size_t                     m_CompactionHeap = InvalidHeapIdx;
+        std::vector<RelocatableId> m_CompactionQueue;
 
         D3D12_DESCRIPTOR_HEAP_DESC m_HeapDesc;
         const UINT                 m_DescriptorSize = 0;
+        VarSizeAllocMngr::Backend  m_Backend;
+        uint32_t                   m_NumSlabDescriptors;
+
+        std::atomic_bool       m_DeferredRelease{ false };
+        DescriptorReleaseQueue m_ReleaseQueue;
+
+        // Per-thread caches, allocated only if m_CacheSize > 0
+        const uint32_t                 m_CacheSize;
+        std::unique_ptr<ThreadCache[]> m_ThreadCaches;
 
         // Maximum heap size during the application lifetime - for statistic purposes
         uint32_t m_MaxSize     = 0;
         uint32_t m_CurrentSize = 0;
+
+        DescriptorTelemetry m_Telemetry;
     };
 }
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "DescriptorHeapAllocation.h"
+
+#include <vector>
+
+namespace Ubpa::UDX12 {
+    // The class collects descriptor copies (e.g. from CPUDescriptorHeap allocations into
+    // GPUDescriptorHeap ranges) during a frame and issues them with one ID3D12Device::CopyDescriptors() call.
+    //
+    // Flush() sorts the copies by destination, then merges contiguous destinations and, independently,
+    // contiguous sources in that order (CopyDescriptors() only needs the same total count on both sides)
+    //
+    //   copies : dst 12 <- src 40, dst 10 <- src 3, dst 11 <- src 4, dst 13 <- src 41
+    //   sorted : dst 10 11 12 13
+    //            src  3  4 40 41
+    //   ranges : dst [10, 14)           1 range
+    //            src [3, 5) [40, 42)    2 ranges
+    //
+    // Destination ranges of one flush must not overlap. The class is not thread safe.
+    class DescriptorCopyBatch {
+    public:
+        struct FlushStats {
+            size_t NumCopies{ 0 };
+            size_t NumDescriptors{ 0 };
+            size_t NumDstRanges{ 0 };
+            size_t NumSrcRanges{ 0 };
+        };
+
+        DescriptorCopyBatch(ID3D12Device* pDevice, D3D12_DESCRIPTOR_HEAP_TYPE Type);
+
+        // Copies NumDescriptors descriptors starting at Src to the descriptors starting at Dst
+        void Add(D3D12_CPU_DESCRIPTOR_HANDLE Dst, D3D12_CPU_DESCRIPTOR_HANDLE Src, uint32_t NumDescriptors = 1);
+        // Copies Count descriptors of Src (from SrcOffset) to Dst (from DstOffset)
+        void Add(const DescriptorHeapAllocation& Dst, uint32_t DstOffset,
+                 const DescriptorHeapAllocation& Src, uint32_t SrcOffset,
+                 uint32_t Count);
+
+        // Issues all pending copies and clears them
+        FlushStats Flush();
+
+        size_t GetNumPendingCopies() const noexcept { return m_Copies.size(); }
+
+    private:
+        struct Copy {
+            SIZE_T   Dst;
+            SIZE_T   Src;
+            uint32_t NumDescriptors;
+        };
+
+        ID3D12Device*                    m_pDevice;
+        const D3D12_DESCRIPTOR_HEAP_TYPE m_Type;
+        const UINT                       m_DescriptorSize;
+
+        std::vector<Copy> m_Copies;
+
+        // Arguments of CopyDescriptors(), kept to reuse the storage
+        std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_DstStarts;
+        std::vector<UINT>                        m_DstSizes;
+        std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_SrcStarts;
+        std::vector<UINT>                        m_SrcSizes;
+    };
+}
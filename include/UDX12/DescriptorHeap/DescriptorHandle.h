@@ -0,0 +1,68 @@
+#pragma once
+
+#include "DescriptorHeapAllocation.h"
+#include "DescriptorHeapRegistry.h"
+
+namespace Ubpa::UDX12 {
+    // Compact (16 bytes) form of a DescriptorHeapAllocation for large tables (e.g. material descriptor tables).
+    // The handle stores the registry index of its heap and the offset of the range in the heap,
+    // the CPU/GPU handles are resolved on demand through DescriptorHeapRegistry:
+    //
+    //   DescriptorHeapAllocation (40 bytes) : CPU handle, GPU handle, allocator, heap, count, manager ID, descriptor size
+    //   DescriptorHandle         (16 bytes) : | Offset | NumHandles | HeapIndex | ManagerId | Flags | (pad) |
+    //
+    // Unlike DescriptorHeapAllocation, the handle is a plain value: it is copyable and does nothing on destruction.
+    // The descriptors are released by Free() (or by the allocation returned by Attach()), after which
+    // all copies of the handle are dangling.
+    //
+    // Dynamic suballocations (DynamicSuballocMngr) are per-frame and cannot be detached.
+    class DescriptorHandle {
+    public:
+        enum Flags : uint16_t {
+            None          = 0,
+            ShaderVisible = 1 << 0,
+        };
+
+        // Null handle
+        DescriptorHandle() noexcept = default;
+
+        // Takes over the descriptors of the allocation, the allocation becomes null without being freed
+        static DescriptorHandle Detach(DescriptorHeapAllocation&& Allocation);
+        // Returns the descriptors as an allocation that owns them, the handle becomes null
+        DescriptorHeapAllocation Attach() noexcept;
+        // Returns the descriptors to their allocator, the handle becomes null
+        void Free() { Attach(); }
+
+        D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(uint32_t Offset = 0) const noexcept {
+            assert(Offset < m_NumHandles);
+            const auto& entry = DescriptorHeapRegistry::Instance().Get(m_HeapIndex);
+            return { entry.FirstCpuHandle.ptr + SIZE_T(m_Offset + Offset) * entry.DescriptorSize };
+        }
+
+        D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(uint32_t Offset = 0) const noexcept {
+            assert(Offset < m_NumHandles && IsShaderVisible());
+            const auto& entry = DescriptorHeapRegistry::Instance().Get(m_HeapIndex);
+            return { entry.FirstGpuHandle.ptr + UINT64(m_Offset + Offset) * entry.DescriptorSize };
+        }
+
+        ID3D12DescriptorHeap* GetDescriptorHeap() const noexcept { return DescriptorHeapRegistry::Instance().Get(m_HeapIndex).pHeap; }
+
+        uint32_t GetNumHandles()   const noexcept { return m_NumHandles; }
+        // Descriptor offset of the range from the heap start
+        uint32_t GetOffset()       const noexcept { return m_Offset; }
+        uint16_t GetHeapIndex()    const noexcept { return m_HeapIndex; }
+        bool     IsNull()          const noexcept { return m_HeapIndex == DescriptorHeapRegistry::InvalidIndex; }
+        bool     IsShaderVisible() const noexcept { return (m_Flags & ShaderVisible) != 0; }
+
+        friend bool operator==(const DescriptorHandle&, const DescriptorHandle&) noexcept = default;
+
+    private:
+        uint32_t m_Offset{ 0 };
+        uint32_t m_NumHandles{ 0 };
+        uint16_t m_HeapIndex{ DescriptorHeapRegistry::InvalidIndex };
+        uint16_t m_AllocationManagerId{ static_cast<uint16_t>(-1) };
+        uint16_t m_Flags{ None };
+    };
+
+    static_assert(sizeof(DescriptorHandle) == 16);
+}
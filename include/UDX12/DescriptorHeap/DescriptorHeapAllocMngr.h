@@ -10,23 +10,46 @@
 #include "../VarSizeAllocMngr.h"
 
 #include <mutex>
+#include <atomic>
+#include <memory>
 
 namespace Ubpa::UDX12 {
     // The class performs suballocations within one D3D12 descriptor heap.
-    // It uses VariableSizeAllocationsManager to manage free space in the heap
+    // It uses VariableSizeAllocationsManager to manage free space in the heap,
+    // the backend of the manager (tree, segregated fit or TLSF) is chosen at construction
     //
     // |  X  X  X  X  O  O  O  X  X  O  O  X  O  O  O  O  |  D3D12 descriptor heap
     //
     //  X - used descriptor
     //  O - available descriptor
     //
+    // Optionally, the first NumSlabDescriptors descriptors form a slab for single-descriptor allocations.
+    // The slab is a bitmap of 64-bit atomic words, Allocate(1) and the matching FreeAllocation() take
+    // no lock while the slab has free descriptors. Other requests (and Allocate(1) when the slab is full)
+    // go to the variable-size manager.
+    //
+    //  |<------------- slab ------------->|<----------- variable-size manager ---------->|
+    //  |  X  O  X  X  X  O  O  X  X  X  O  |  X  X  X  X  O  O  O  X  X  O  O  X  O  O  O |
+    //     m_SlabBitmap[0] = ...1011100111 (bit i : descriptor m_SlabOffset + i is used)
+    //
+    // If pending frees are enabled, FreeAllocation() of a range takes no lock either. The range is pushed onto
+    // a lock-free stack whose nodes live in m_PendingFrees, indexed by the first descriptor of the range
+    // (live ranges never share their first descriptor, so every range has its own node):
+    //
+    //   m_PendingHead -> [9] -> [2] -> [14] -> Invalid       m_PendingFrees[i] = { next, count } of the range at i
+    //
+    // The stack is drained in one exchange under m_FreeBlockManagerMutex by the next Allocate(), AllocateBatch(),
+    // FreeAllocations() or Flush(), and the ranges are returned with one FreeBatch() that merges adjacent ranges.
+    //
     class DescriptorHeapAllocMngr {
     public:
         // Creates a new D3D12 descriptor heap
         DescriptorHeapAllocMngr(ID3D12Device*                     pDevice,
                                 IDescriptorAllocator&             ParentAllocator,
                                 size_t                            ThisManagerId,
-                                const D3D12_DESCRIPTOR_HEAP_DESC& HeapDesc);
+                                const D3D12_DESCRIPTOR_HEAP_DESC& HeapDesc,
+                                VarSizeAllocMngr::Backend         Backend            = VarSizeAllocMngr::Backend::Tree,
+                                uint32_t                          NumSlabDescriptors = 0);
 
         // Uses subrange of descriptors in the existing D3D12 descriptor heap
         // that starts at offset FirstDescriptor and uses NumDescriptors descriptors
@@ -35,7 +58,9 @@ namespace Ubpa::UDX12 {
                                 size_t                 ThisManagerId,
                                 ID3D12DescriptorHeap*  pd3d12DescriptorHeap,
                                 uint32_t               FirstDescriptor,
-                                uint32_t               NumDescriptors);
+                                uint32_t               NumDescriptors,
+                                VarSizeAllocMngr::Backend Backend            = VarSizeAllocMngr::Backend::Tree,
+                                uint32_t                  NumSlabDescriptors = 0);
 
         // = default causes compiler error when instantiating std::vector::emplace_back() in Visual Studio 2015 (Version 14.0.23107.0 D14REL)
         DescriptorHeapAllocMngr(DescriptorHeapAllocMngr&& rhs) noexcept;
@@ -51,11 +76,52 @@ namespace Ubpa::UDX12 {
         DescriptorHeapAllocation Allocate(uint32_t Count);
         void                     FreeAllocation(DescriptorHeapAllocation&& Allocation);
 
-        size_t   GetNumAvailableDescriptors() const noexcept { return m_FreeBlockManager.GetFreeSize(); }
+        // Allocates Counts[i] descriptors into Allocations[i] (null on failure) under one lock
+        void AllocateBatch(std::span<const uint32_t> Counts, std::span<DescriptorHeapAllocation> Allocations);
+        // Frees all non-null allocations under one lock, adjacent ranges are merged before they are returned
+        void FreeAllocations(std::span<DescriptorHeapAllocation> Allocations);
+
+        // Makes FreeAllocation() lock-free, must be called before the manager is shared between threads
+        void EnablePendingFrees();
+        // Returns the pending frees to the free block manager
+        void Flush();
+
+        // Includes the pending frees
+        size_t   GetNumAvailableDescriptors() const noexcept {
+            return m_FreeBlockManager.GetFreeSize() + m_NumFreeSlabDescriptors.load(std::memory_order_relaxed)
+                + m_NumPendingDescriptors.load(std::memory_order_relaxed);
+        }
 	    uint32_t GetMaxDescriptors()          const noexcept { return m_NumDescriptorsInAllocation;     }
         size_t   GetMaxAllocatedSize()        const noexcept { return m_MaxAllocatedSize;               }
 
+        // Snapshot of the free block statistics (largest free block, histogram, fragmentation, live allocations)
+        VarSizeAllocMngr::Stats GetFreeBlockStats();
+        // Free block layout of the heap, see VarSizeAllocMngr::DumpFreeBlocks()
+        std::string             DumpFreeBlocks(bool json = false);
+
+        uint32_t GetNumSlabDescriptors()      const noexcept { return m_NumSlabDescriptors; }
+
+        // The largest Count that Allocate(Count) succeeds for, the pending frees are drained first.
+        // Takes the free block manager lock, so the value is exact until the next Allocate() or lock-free free
+        size_t   GetMaxAllocatableCount();
+
     private:
+        // Creates the allocation of Count descriptors that starts at descriptor Offset in the range
+        DescriptorHeapAllocation MakeAllocation(size_t Offset, uint32_t Count);
+
+        void   InitSlab(uint32_t NumSlabDescriptors);
+        // Lock-free, returns the offset of the descriptor (VarSizeAllocMngr::Allocation::InvalidOffset if the slab is full)
+        size_t TryAllocateFromSlab() noexcept;
+        void   FreeToSlab(size_t Offset) noexcept;
+        bool   IsInSlab(size_t Offset) const noexcept { return Offset - m_SlabOffset < m_NumSlabDescriptors; }
+
+        // Lock-free
+        void   PushPendingFree(size_t Offset, uint32_t Count) noexcept;
+        // Appends the pending frees to m_BatchAllocations, guarded by m_FreeBlockManagerMutex
+        void   TakePendingFrees();
+        // Guarded by m_FreeBlockManagerMutex
+        void   DrainPendingFrees();
+
         IDescriptorAllocator&  m_ParentAllocator;
         ID3D12Device* m_pDevice;
 
@@ -76,6 +142,10 @@ namespace Ubpa::UDX12 {
         std::mutex                     m_FreeBlockManagerMutex;
         VarSizeAllocMngr               m_FreeBlockManager;
 
+        // Scratch buffers of AllocateBatch() and FreeAllocations(), guarded by m_FreeBlockManagerMutex
+        std::vector<VarSizeAllocMngr::Request>    m_BatchRequests;
+        std::vector<VarSizeAllocMngr::Allocation> m_BatchAllocations;
+
         // Strong reference to D3D12 descriptor heap object
         CComPtr<ID3D12DescriptorHeap>  m_pd3d12DescriptorHeap;
 
@@ -87,6 +157,21 @@ namespace Ubpa::UDX12 {
 
         size_t m_MaxAllocatedSize{ 0 };
 
+        // Single-descriptor slab, the range is taken from m_FreeBlockManager at construction
+        size_t                                  m_SlabOffset{ 0 };
+        uint32_t                                m_NumSlabDescriptors{ 0 };
+        std::unique_ptr<std::atomic_uint64_t[]> m_SlabBitmap;
+        std::atomic_uint32_t                    m_NumFreeSlabDescriptors{ 0 };
+        // Word where the last search succeeded or the last free happened, the next search starts there
+        std::atomic_uint32_t                    m_SlabWordHint{ 0 };
+
+        // Pending frees, allocated by EnablePendingFrees()
+        static constexpr uint32_t               InvalidPendingFree = static_cast<uint32_t>(-1);
+        // Every node is (next << 32) | count
+        std::unique_ptr<uint64_t[]>             m_PendingFrees;
+        alignas(64) std::atomic_uint32_t        m_PendingHead{ InvalidPendingFree };
+        std::atomic_size_t                      m_NumPendingDescriptors{ 0 };
+
 #ifndef NDEBUG
         std::atomic_int32_t m_AllocationsCounter = 0;
 #endif // !NDEBUG
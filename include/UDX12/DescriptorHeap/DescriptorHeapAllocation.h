@@ -59,6 +59,7 @@ namespace Ubpa::UDX12 {
 
         // Returns pointer to D3D12 descriptor heap that contains this allocation
         ID3D12DescriptorHeap* GetDescriptorHeap() const noexcept { return m_pDescriptorHeap; }
+        IDescriptorAllocator* GetAllocator()      const noexcept { return m_pAllocator; }
 
         uint32_t GetNumHandles()          const noexcept { return m_NumHandles; }
         bool     IsNull()                 const noexcept { return m_FirstCpuHandle.ptr == 0; }
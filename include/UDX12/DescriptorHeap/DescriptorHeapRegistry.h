@@ -0,0 +1,62 @@
+#pragma once
+
+#include "IDescriptorAllocator.h"
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+namespace Ubpa::UDX12 {
+    // Process-wide table of the D3D12 descriptor heaps that DescriptorHandle objects point into.
+    // A handle stores the 16-bit index of its heap, the heap start and the allocator are looked up here.
+    //
+    //   DescriptorHandle { HeapIndex = 2, Offset = 5, NumHandles = 3 }
+    //                                 |
+    //   m_Entries : [0] [1] [2] ...   '-> { pHeap, pAllocator, FirstCpuHandle, FirstGpuHandle, DescriptorSize }
+    //
+    // Heaps are registered on first use by DescriptorHandle::Detach() and unregistered by their
+    // DescriptorHeapAllocMngr when the heap is destroyed. Get() takes no lock, an entry doesn't
+    // change while handles into its heap are alive.
+    class DescriptorHeapRegistry {
+    public:
+        static constexpr uint16_t MaxNumHeaps  = 4096;
+        static constexpr uint16_t InvalidIndex = static_cast<uint16_t>(-1);
+
+        struct Entry {
+            ID3D12DescriptorHeap*       pHeap{ nullptr };
+            IDescriptorAllocator*       pAllocator{ nullptr };
+            D3D12_CPU_DESCRIPTOR_HANDLE FirstCpuHandle{ 0 };
+            D3D12_GPU_DESCRIPTOR_HANDLE FirstGpuHandle{ 0 };
+            uint32_t                    DescriptorSize{ 0 };
+        };
+
+        // Never destroyed, descriptor heaps may be released during static destruction
+        static DescriptorHeapRegistry& Instance() noexcept {
+            static DescriptorHeapRegistry* instance = new DescriptorHeapRegistry;
+            return *instance;
+        }
+
+        // Returns the index of the heap, the heap is registered on first use.
+        // All allocations of a heap that are registered must come from pAllocator
+        uint16_t Register(ID3D12DescriptorHeap* pHeap, IDescriptorAllocator* pAllocator);
+        // Does nothing if the heap is not registered
+        void     Unregister(ID3D12DescriptorHeap* pHeap);
+
+        const Entry& Get(uint16_t Index) const noexcept {
+            assert(Index < MaxNumHeaps && m_Entries[Index].pHeap != nullptr);
+            return m_Entries[Index];
+        }
+
+        size_t GetNumHeaps();
+
+    private:
+        DescriptorHeapRegistry();
+
+        std::mutex                                           m_Mutex;
+        std::unique_ptr<Entry[]>                             m_Entries;
+        std::unordered_map<ID3D12DescriptorHeap*, uint16_t>  m_Heap2Index;
+        std::vector<uint16_t>                                m_FreeIndices;
+        uint16_t                                             m_NumUsedIndices{ 0 };
+    };
+}
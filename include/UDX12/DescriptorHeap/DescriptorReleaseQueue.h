@@ -0,0 +1,68 @@
+#pragma once
+
+#include "DescriptorHeapAllocation.h"
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <span>
+#include <algorithm>
+
+namespace Ubpa::UDX12 {
+    // Queue of stale descriptor heap allocations, every allocation is tagged with the fence value
+    // that the GPU signals after the last command list that may reference it
+    //
+    //   Push()   : frames -> | 5 5 5 | 6 6 | 7 7 7 7 |     tagged with the current fence value
+    //   Release(6)          '-------------'                retired in one batch
+    //
+    // Fence values are plain integers, they don't need to come from an ID3D12Fence
+    // (e.g. FrameResourceMngr::GetCurrentCpuFence() or a frame counter).
+    // Push() and Release() are thread-safe.
+    class DescriptorReleaseQueue {
+    public:
+        // Allocations pushed from now on are tagged with FenceValue, fence values must not decrease
+        void     SetFenceValue(uint64_t FenceValue) noexcept;
+        uint64_t GetFenceValue() const noexcept { return m_FenceValue; }
+
+        void Push(DescriptorHeapAllocation&& Allocation);
+
+        // Calls FreeBatch(std::span<DescriptorHeapAllocation>) once with all allocations
+        // whose fence value is not greater than CompletedFenceValue
+        template<typename Func>
+        void Release(uint64_t CompletedFenceValue, Func&& FreeBatch);
+
+        size_t GetSize();
+
+    private:
+        struct StaleAllocation {
+            uint64_t                 FenceValue;
+            DescriptorHeapAllocation Allocation;
+        };
+
+        std::mutex                  m_Mutex;
+        std::atomic_uint64_t        m_FenceValue{ 0 };
+        std::deque<StaleAllocation> m_Queue;
+        // Allocations taken out by Release(), kept to reuse the storage
+        std::vector<DescriptorHeapAllocation> m_Retired;
+    };
+
+    template<typename Func>
+    void DescriptorReleaseQueue::Release(uint64_t CompletedFenceValue, Func&& FreeBatch) {
+        std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+        // Fence values are pushed in non-decreasing order
+        while (!m_Queue.empty() && m_Queue.front().FenceValue <= CompletedFenceValue) {
+            m_Retired.push_back(std::move(m_Queue.front().Allocation));
+            m_Queue.pop_front();
+        }
+
+        if (m_Retired.empty())
+            return;
+
+        std::forward<Func>(FreeBatch)(std::span<DescriptorHeapAllocation>{ m_Retired });
+        assert(std::all_of(m_Retired.begin(), m_Retired.end(),
+            [](const DescriptorHeapAllocation& Allocation) { return Allocation.IsNull(); }));
+        m_Retired.clear();
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "IDescriptorAllocator.h"
+#include "DescriptorHeapAllocation.h"
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+
+namespace Ubpa::UDX12 {
+    // The class performs frame-ordered suballocations within a subrange of one D3D12 descriptor heap.
+    // Allocations are never freed individually, whole frames are released when their fence completes.
+    //
+    //                  m_Tail                                          m_Head
+    //                    |                                               |
+    //  |  O  O  O  O  O  | X  X  X  X | X  X  X  X  X  X  X | X  X  X  X  |  O  O  O  |
+    //                      frame 5      frame 6               frame 7 (open)
+    //
+    // m_Head and m_Tail are monotonic positions, the descriptor offset is position % NumDescriptors.
+    // Allocate() bumps m_Head with a CAS and takes no lock. An allocation never wraps around the end of
+    // the range, the descriptors between the head and the end are skipped and released with the frame.
+    // BeginFrame() and ReleaseCompletedFrames() are called once per frame and are guarded by a mutex.
+    class DescriptorRingAllocMngr {
+    public:
+        // Uses subrange of descriptors in the existing D3D12 descriptor heap
+        // that starts at offset FirstDescriptor and uses NumDescriptors descriptors
+        DescriptorRingAllocMngr(ID3D12Device*         pDevice,
+                                IDescriptorAllocator& ParentAllocator,
+                                size_t                ThisManagerId,
+                                ID3D12DescriptorHeap* pd3d12DescriptorHeap,
+                                uint32_t              FirstDescriptor,
+                                uint32_t              NumDescriptors);
+
+        DescriptorRingAllocMngr            (const DescriptorRingAllocMngr&) = delete;
+        DescriptorRingAllocMngr            (DescriptorRingAllocMngr&&)      = delete;
+        DescriptorRingAllocMngr& operator= (const DescriptorRingAllocMngr&) = delete;
+        DescriptorRingAllocMngr& operator= (DescriptorRingAllocMngr&&)      = delete;
+
+        // Lock-free, returns a null allocation if the ring is full
+        DescriptorHeapAllocation Allocate(uint32_t Count);
+
+        // Closes the open frame, allocations made from now on belong to the frame FenceValue.
+        // The first call closes nothing, allocations made before it belong to the first frame as well
+        void BeginFrame(uint64_t FenceValue);
+        // Releases all closed frames whose fence value is not greater than CompletedFenceValue
+        void ReleaseCompletedFrames(uint64_t CompletedFenceValue);
+
+        uint32_t GetMaxDescriptors() const noexcept { return m_NumDescriptors; }
+        // Includes the descriptors skipped at the end of the range
+        size_t   GetUsedSize() const noexcept {
+            return static_cast<size_t>(m_Head.load(std::memory_order_relaxed) - m_Tail.load(std::memory_order_relaxed));
+        }
+        // Sampled by BeginFrame()
+        size_t   GetMaxUsedSize() const noexcept { return m_MaxUsedSize; }
+
+    private:
+        struct ClosedFrame {
+            uint64_t FenceValue;
+            uint64_t Head; // m_Head when the frame was closed
+        };
+
+        IDescriptorAllocator& m_ParentAllocator;
+
+        // External ID assigned to this descriptor allocations manager
+        size_t m_ThisManagerId;
+
+        const UINT m_DescriptorSize;
+        const bool m_ShaderVisible;
+        uint32_t   m_NumDescriptors;
+
+        // Strong reference to D3D12 descriptor heap object
+        CComPtr<ID3D12DescriptorHeap> m_pd3d12DescriptorHeap;
+
+        D3D12_CPU_DESCRIPTOR_HANDLE m_FirstCPUHandle{ 0 };
+        D3D12_GPU_DESCRIPTOR_HANDLE m_FirstGPUHandle{ 0 };
+
+        // Own cache lines, the head is written by every allocating thread
+        alignas(64) std::atomic_uint64_t m_Head{ 0 };
+        alignas(64) std::atomic_uint64_t m_Tail{ 0 };
+
+        std::mutex              m_FrameMutex;
+        // m_FrameFenceValue is the fence value of the open frame once BeginFrame() has been called
+        bool                    m_FrameBegun{ false };
+        uint64_t                m_FrameFenceValue{ 0 };
+        std::deque<ClosedFrame> m_ClosedFrames;
+        size_t                  m_MaxUsedSize{ 0 };
+    };
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string_view>
+
+#include <cstdint>
+
+namespace Ubpa::UDX12 {
+    // Lock-free counters of one descriptor allocator, every IDescriptorAllocator exposes them by GetTelemetry().
+    // All updates are relaxed atomics, so the counters are left on in release builds.
+    //
+    //   frame N                                   EndFrame()        frame N + 1
+    //   | OnAllocate() OnFree() OnFailedAllocation() |  -> Snapshot  | ...
+    //     per-frame counters                           reset
+    //     descriptors in use, lifetime peak            kept
+    //
+    // The time the allocator's own lock is held is measured only if lock timing is enabled
+    // (two clock reads per lock), allocators without a lock of their own report 0.
+    class DescriptorTelemetry {
+    public:
+        struct Snapshot {
+            // Since the last EndFrame()
+            uint64_t NumAllocations{ 0 };
+            uint64_t NumFrees{ 0 };
+            uint64_t NumFailedAllocations{ 0 };
+            uint64_t LockHeldNanoseconds{ 0 };
+            uint64_t FramePeakDescriptorsInUse{ 0 };
+
+            uint64_t NumDescriptorsInUse{ 0 };
+            uint64_t NumBytesInUse{ 0 };
+            // Lifetime
+            uint64_t PeakDescriptorsInUse{ 0 };
+            // Number of EndFrame() calls before the snapshot
+            uint64_t FrameIndex{ 0 };
+        };
+
+        // Adds the time the mutex is held to the telemetry if lock timing is enabled
+        template<typename Mutex>
+        class LockGuard {
+        public:
+            LockGuard(Mutex& M, DescriptorTelemetry& Telemetry) : m_Lock{ M }, m_Telemetry{ Telemetry } {
+                if (m_Telemetry.IsLockTimingEnabled())
+                    m_Start = std::chrono::steady_clock::now();
+            }
+            ~LockGuard() {
+                if (m_Start != std::chrono::steady_clock::time_point{})
+                    m_Telemetry.AddLockHeldTime(std::chrono::steady_clock::now() - m_Start);
+            }
+
+            LockGuard(const LockGuard&) = delete;
+            LockGuard& operator=(const LockGuard&) = delete;
+
+        private:
+            std::lock_guard<Mutex>                m_Lock;
+            DescriptorTelemetry&                  m_Telemetry;
+            std::chrono::steady_clock::time_point m_Start{};
+        };
+
+        explicit DescriptorTelemetry(uint32_t DescriptorSize) noexcept : m_DescriptorSize{ DescriptorSize } {}
+
+        DescriptorTelemetry(const DescriptorTelemetry&) = delete;
+        DescriptorTelemetry& operator=(const DescriptorTelemetry&) = delete;
+
+        void OnAllocate(uint32_t Count) noexcept;
+        // NumAllocations allocations of Count descriptors in total are freed
+        void OnFree(uint32_t Count, uint32_t NumAllocations = 1) noexcept;
+        void OnFailedAllocation() noexcept { m_NumFailedAllocations.fetch_add(1, std::memory_order_relaxed); }
+
+        void EnableLockTiming(bool Enable) noexcept { m_LockTiming.store(Enable, std::memory_order_relaxed); }
+        bool IsLockTimingEnabled() const noexcept { return m_LockTiming.load(std::memory_order_relaxed); }
+        void AddLockHeldTime(std::chrono::steady_clock::duration Duration) noexcept {
+            m_LockHeldNanoseconds.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Duration).count()),
+                std::memory_order_relaxed);
+        }
+
+        // The current frame so far
+        Snapshot GetSnapshot() const noexcept;
+        // Returns the finished frame and resets the per-frame counters
+        Snapshot EndFrame() noexcept;
+
+    private:
+        static void UpdateMax(std::atomic_uint64_t& Max, uint64_t Value) noexcept;
+
+        const uint32_t m_DescriptorSize;
+
+        std::atomic_bool     m_LockTiming{ false };
+
+        std::atomic_uint64_t m_NumAllocations{ 0 };
+        std::atomic_uint64_t m_NumFrees{ 0 };
+        std::atomic_uint64_t m_NumFailedAllocations{ 0 };
+        std::atomic_uint64_t m_LockHeldNanoseconds{ 0 };
+        std::atomic_uint64_t m_FramePeakDescriptorsInUse{ 0 };
+
+        // Signed, a free may be counted on another thread before the allocation it frees
+        std::atomic_int64_t  m_NumDescriptorsInUse{ 0 };
+        std::atomic_uint64_t m_PeakDescriptorsInUse{ 0 };
+        std::atomic_uint64_t m_FrameIndex{ 0 };
+    };
+
+    // Receives the telemetry of every allocator once per frame, e.g. DescriptorHeapMngr::ReportTelemetry()
+    class IDescriptorTelemetrySink {
+    public:
+        virtual ~IDescriptorTelemetrySink() = default;
+        virtual void OnFrame(std::string_view AllocatorName, const DescriptorTelemetry::Snapshot& Snapshot) = 0;
+    };
+}
@@ -43,9 +43,16 @@ namespace Ubpa::UDX12 {
         void ReleaseAllocations();
 
         virtual uint32_t GetDescriptorSize() const noexcept override final { return m_ParentGPUHeap->GetDescriptorSize(); }
+        // The suballocations of a frame are freed together by ReleaseAllocations()
+        virtual DescriptorTelemetry* GetTelemetry() noexcept override final { return &m_Telemetry; }
 
         size_t GetSuballocationCount() const noexcept { return m_Suballocations.size(); }
 
+        uint32_t GetCurrDescriptorCount()         const noexcept { return m_CurrDescriptorCount; }
+        uint32_t GetPeakDescriptorCount()         const noexcept { return m_PeakDescriptorCount; }
+        uint32_t GetCurrSuballocationsTotalSize() const noexcept { return m_CurrSuballocationsTotalSize; }
+        uint32_t GetPeakSuballocationsTotalSize() const noexcept { return m_PeakSuballocationsTotalSize; }
+
     private:
         // Parent GPU descriptor heap that is used to allocate chunks
         GPUDescriptorHeap* m_ParentGPUHeap;
@@ -62,5 +69,8 @@ namespace Ubpa::UDX12 {
         uint32_t m_PeakDescriptorCount         = 0;
         uint32_t m_CurrSuballocationsTotalSize = 0;
         uint32_t m_PeakSuballocationsTotalSize = 0;
+        uint32_t m_CurrAllocationCount         = 0;
+
+        DescriptorTelemetry m_Telemetry;
     };
 }
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "DynamicSuballocMngr.h"
+
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <unordered_map>
+
+namespace Ubpa::UDX12 {
+    // The class hands every thread its own DynamicSuballocMngr bound to one GPU descriptor heap,
+    // so threads (e.g. the workers of FG::Executor) allocate dynamic descriptors without a shared lock.
+    //
+    //   thread 0 -> m_ThreadMngrs[id 0] | X X X X | | X X O O |
+    //   thread 1 -> m_ThreadMngrs[id 1] | X X X O |                       all are released by one
+    //   thread 2 -> m_ThreadMngrs[id 2] | X X X X | | X X X X | | X O O O |  ReleaseAllocations()
+    //
+    // The manager of a thread is created on its first GetThreadMngr() and lives as long as the pool.
+    // A thread-local cache remembers the last (pool, manager) pair, so the lookup takes the mutex only
+    // when a thread switches pools.
+    class DynamicSuballocMngrPool {
+    public:
+        struct Stats {
+            size_t   NumThreadMngrs;
+            // Sum over the threads in one frame, max over frames
+            uint32_t PeakDescriptorCount;
+            uint32_t PeakSuballocationsTotalSize;
+            // Max over the threads
+            uint32_t MaxThreadPeakDescriptorCount;
+            uint32_t MaxThreadPeakSuballocationsTotalSize;
+        };
+
+        DynamicSuballocMngrPool(GPUDescriptorHeap* ParentGPUHeap,
+                                uint32_t           DynamicChunkSize,
+                                std::string        PoolName);
+
+        DynamicSuballocMngrPool            (const DynamicSuballocMngrPool&) = delete;
+        DynamicSuballocMngrPool            (DynamicSuballocMngrPool&&)      = delete;
+        DynamicSuballocMngrPool& operator= (const DynamicSuballocMngrPool&) = delete;
+        DynamicSuballocMngrPool& operator= (DynamicSuballocMngrPool&&)      = delete;
+
+        ~DynamicSuballocMngrPool();
+
+        // The manager of the calling thread, only this thread may allocate with it
+        DynamicSuballocMngr&     GetThreadMngr();
+        DescriptorHeapAllocation Allocate(uint32_t Count) { return GetThreadMngr().Allocate(Count); }
+
+        // Releases the allocations of all threads at the end of the frame,
+        // must not run concurrently with allocations
+        void  ReleaseAllocations();
+
+        // Must not run concurrently with allocations
+        Stats GetStats();
+
+    private:
+        GPUDescriptorHeap* m_ParentGPUHeap;
+        uint32_t           m_DynamicChunkSize;
+        std::string        m_PoolName;
+
+        // Unique in the process (unlike the address), keys the thread-local cache
+        const uint64_t     m_PoolId;
+
+        std::mutex                                                                m_Mutex;
+        std::unordered_map<std::thread::id, std::unique_ptr<DynamicSuballocMngr>> m_ThreadMngrs;
+
+        uint32_t m_PeakDescriptorCount         = 0;
+        uint32_t m_PeakSuballocationsTotalSize = 0;
+    };
+}
@@ -8,6 +8,11 @@
 #include "IDescriptorAllocator.h"
 #include "DescriptorHeapAllocation.h"
 #include "DescriptorHeapAllocMngr.h"
+#include "DescriptorReleaseQueue.h"
+#include "DescriptorRingAllocMngr.h"
+#include "DescriptorTelemetry.h"
+
+#include <memory>
 
 namespace Ubpa::UDX12 {
 	// GPU descriptor heap provides storage for shader-visible descriptors
@@ -42,6 +47,10 @@ namespace Ubpa::UDX12 {
     // |                                                                                                                               |
     // |_______________________________________________________________________________________________________________________________|
     //
+    // With DynamicBackend::Ring, the dynamic space is a DescriptorRingAllocMngr instead: chunks are claimed
+    // lock-free at the head of the ring and whole frames are released at once when their fence completes.
+    // SetFrameFenceValue() and ReleaseStaleAllocations() must then be called every frame.
+    //
     //  ________________________________________________               ________________________________________________
     // |Device Context 1                                |             |Device Context 2                                |
     // |                                                |             |                                                |
@@ -51,32 +60,62 @@ namespace Ubpa::UDX12 {
     //
     class GPUDescriptorHeap final : public IDescriptorAllocator {
     public:
+        // Allocator of the dynamic space
+        enum class DynamicBackend {
+            AllocMngr, // DescriptorHeapAllocMngr, chunks are freed individually
+            Ring       // DescriptorRingAllocMngr, chunks are released with their frame
+        };
+
+        // PendingFrees makes Free() of static descriptors lock-free, see DescriptorHeapAllocMngr::EnablePendingFrees().
+        // Worth it when many threads free static descriptors, e.g. at the end of passes
         GPUDescriptorHeap(ID3D12Device*               pDevice,
                           uint32_t                    NumDescriptorsInHeap,
                           uint32_t                    NumDynamicDescriptors,
                           D3D12_DESCRIPTOR_HEAP_TYPE  Type,
-                          D3D12_DESCRIPTOR_HEAP_FLAGS Flags);
+                          D3D12_DESCRIPTOR_HEAP_FLAGS Flags,
+                          VarSizeAllocMngr::Backend   Backend    = VarSizeAllocMngr::Backend::Tree,
+                          DynamicBackend              DynBackend = DynamicBackend::AllocMngr,
+                          UINT                        NodeMask   = 1,
+                          bool                        PendingFrees = false);
 
         GPUDescriptorHeap            (const GPUDescriptorHeap&) = delete;
         GPUDescriptorHeap            (GPUDescriptorHeap&&)      = delete;
         GPUDescriptorHeap& operator= (const GPUDescriptorHeap&) = delete;
         GPUDescriptorHeap& operator= (GPUDescriptorHeap&&)      = delete;
 
-        virtual DescriptorHeapAllocation Allocate(uint32_t count) override final
-        { return m_HeapAllocationManager.Allocate(count); }
+        ~GPUDescriptorHeap();
 
-        DescriptorHeapAllocation AllocateDynamic(uint32_t count)
-        { return m_DynamicAllocationsManager.Allocate(count); }
+        virtual DescriptorHeapAllocation Allocate(uint32_t count) override final;
+
+        DescriptorHeapAllocation AllocateDynamic(uint32_t count);
 
         virtual void     Free(DescriptorHeapAllocation&&) override final;
+        // Frees the allocations with one lock per allocation manager, e.g. all dynamic chunks at the end of the frame
+        void             FreeBatch(std::span<DescriptorHeapAllocation> Allocations);
+
+        // If deferred release is enabled, Free() and FreeBatch() (and so DynamicSuballocMngr::ReleaseAllocations())
+        // only tag the allocations with the current frame fence value, ReleaseStaleAllocations() frees them.
+        // The dynamic ring (if any) is always released by these fence values.
+        void EnableDeferredRelease(bool Enable) noexcept { m_DeferredRelease = Enable; }
+        void SetFrameFenceValue(uint64_t FenceValue);
+        void ReleaseStaleAllocations(uint64_t CompletedFenceValue);
+        // With PendingFrees, static descriptors are freed lock-free and returned to the free blocks by the next
+        // static allocation, FlushPendingFrees() returns them at once. No-op otherwise
+        void FlushPendingFrees() { m_HeapAllocationManager.Flush(); }
         virtual uint32_t GetDescriptorSize() const override final { return m_DescriptorSize; }
+        // Static and dynamic allocations together, the locks are inside the allocation managers (no lock timing)
+        virtual DescriptorTelemetry* GetTelemetry() noexcept override final { return &m_Telemetry; }
 
         const D3D12_DESCRIPTOR_HEAP_DESC& GetHeapDesc() const noexcept { return m_HeapDesc; }
         uint32_t                          GetMaxStaticDescriptors() const noexcept { return m_HeapAllocationManager.GetMaxDescriptors(); }
-        uint32_t                          GetMaxDynamicDescriptors() const noexcept { return m_DynamicAllocationsManager.GetMaxDescriptors(); }
+        uint32_t                          GetMaxDynamicDescriptors() const noexcept {
+            return m_DynamicRing ? m_DynamicRing->GetMaxDescriptors() : m_DynamicAllocationsManager.GetMaxDescriptors();
+        }
         ID3D12DescriptorHeap*             GetDescriptorHeap() const noexcept { return m_pd3d12DescriptorHeap.p; }
 
     protected:
+        void FreeBatchNow(std::span<DescriptorHeapAllocation> Allocations);
+
         ID3D12Device* m_Device;
 
         const D3D12_DESCRIPTOR_HEAP_DESC m_HeapDesc;
@@ -86,11 +125,20 @@ namespace Ubpa::UDX12 {
 
         static constexpr size_t StaticHeapAllocatonManagerID  = 0;
         static constexpr size_t DynamicHeapAllocatonManagerID = 1;
+        static constexpr size_t DynamicRingAllocatonManagerID = 2;
 
         // Allocation manager for static/mutable part
         DescriptorHeapAllocMngr m_HeapAllocationManager;
 
-        // Allocation manager for dynamic part
+        // Allocation manager for dynamic part (empty if the dynamic ring is used)
         DescriptorHeapAllocMngr m_DynamicAllocationsManager;
+
+        // Ring allocator for dynamic part, only with DynamicBackend::Ring
+        std::unique_ptr<DescriptorRingAllocMngr> m_DynamicRing;
+
+        std::atomic_bool       m_DeferredRelease{ false };
+        DescriptorReleaseQueue m_ReleaseQueue;
+
+        DescriptorTelemetry m_Telemetry;
     };
 }
\ No newline at end of file
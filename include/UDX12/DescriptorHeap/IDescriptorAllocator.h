@@ -9,6 +9,7 @@
 namespace Ubpa::UDX12 {
     class DescriptorHeapAllocation;
     class DescriptorHeapAllocMngr;
+    class DescriptorTelemetry;
     class RenderpDevice;
 
     class IDescriptorAllocator {
@@ -17,5 +18,7 @@ namespace Ubpa::UDX12 {
         virtual DescriptorHeapAllocation Allocate(uint32_t Count) = 0;
         virtual void Free(DescriptorHeapAllocation&& Allocation) = 0;
         virtual uint32_t GetDescriptorSize() const = 0;
+        // Counters of the allocator, nullptr if it has none
+        virtual DescriptorTelemetry* GetTelemetry() noexcept { return nullptr; }
     };
 }
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "DescriptorHeapAllocation.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace Ubpa::UDX12 {
+    class CPUDescriptorHeap;
+    class GPUDescriptorHeap;
+
+    // Deduplicating sampler storage, identical D3D12_SAMPLER_DESC requests share one sampler.
+    // Every sampler is created once in the CPU sampler heap (the source of descriptor table copies) and copied
+    // to one descriptor in the static part of the shader-visible sampler heap (bound directly):
+    //
+    //   desc (hashed) -> { CPU allocation, GPU allocation }
+    //                            |                 ^
+    //                            '--- copied ------'
+    //
+    // Samplers are never evicted (command lists may reference them), so the number of distinct samplers
+    // is capped at Capacity, by default the D3D12 shader-visible sampler heap limit (2048).
+    // All methods are thread-safe.
+    class SamplerCache {
+    public:
+        struct Sampler {
+            // Null if the cache is full
+            D3D12_CPU_DESCRIPTOR_HANDLE CpuHandle{ 0 };
+            D3D12_GPU_DESCRIPTOR_HANDLE GpuHandle{ 0 };
+
+            bool IsNull() const noexcept { return CpuHandle.ptr == 0; }
+        };
+
+        struct Stats {
+            size_t NumSamplers{ 0 };
+            size_t NumHits{ 0 };
+            size_t NumMisses{ 0 }; // CreateSampler calls
+            size_t NumRejected{ 0 }; // requests that failed because the cache is full
+        };
+
+        SamplerCache(ID3D12Device*      pDevice,
+                     CPUDescriptorHeap& CpuHeap,
+                     GPUDescriptorHeap& GpuHeap,
+                     size_t             Capacity = D3D12_MAX_SHADER_VISIBLE_SAMPLER_HEAP_SIZE);
+
+        SamplerCache            (const SamplerCache&) = delete;
+        SamplerCache            (SamplerCache&&)      = delete;
+        SamplerCache& operator= (const SamplerCache&) = delete;
+        SamplerCache& operator= (SamplerCache&&)      = delete;
+
+        ~SamplerCache();
+
+        Sampler GetOrCreate(const D3D12_SAMPLER_DESC& Desc);
+
+        // Releases all samplers, the GPU must not reference them any more
+        void  Clear();
+        Stats GetStats();
+
+    private:
+        // Field by field, the float fields are compared and hashed by their bits with -0.0f taken as +0.0f
+        struct DescEqual {
+            bool operator()(const D3D12_SAMPLER_DESC& lhs, const D3D12_SAMPLER_DESC& rhs) const noexcept;
+        };
+        struct DescHasher {
+            size_t operator()(const D3D12_SAMPLER_DESC& Desc) const noexcept;
+        };
+        struct Entry {
+            DescriptorHeapAllocation CpuAllocation;
+            DescriptorHeapAllocation GpuAllocation;
+        };
+
+        ID3D12Device*      m_pDevice;
+        CPUDescriptorHeap& m_CpuHeap;
+        GPUDescriptorHeap& m_GpuHeap;
+        size_t             m_Capacity;
+
+        std::mutex                                                         m_Mutex;
+        std::unordered_map<D3D12_SAMPLER_DESC, Entry, DescHasher, DescEqual> m_Samplers;
+        Stats                                                              m_Stats;
+    };
+}
@@ -1,13 +1,34 @@
 #pragma once
 
+#include "DescriptorHeap/BindlessTable.h"
 #include "DescriptorHeap/CPUDescriptorHeap.h"
+#include "DescriptorHeap/DescriptorCopyBatch.h"
+#include "DescriptorHeap/DescriptorHandle.h"
 #include "DescriptorHeap/DescriptorHeapAllocation.h"
 #include "DescriptorHeap/DescriptorHeapAllocMngr.h"
+#include "DescriptorHeap/DescriptorHeapRegistry.h"
+#include "DescriptorHeap/DescriptorTelemetry.h"
+#include "DescriptorHeap/DescriptorReleaseQueue.h"
 #include "DescriptorHeap/DynamicSuballocMngr.h"
+#include "DescriptorHeap/DynamicSuballocMngrPool.h"
 #include "DescriptorHeap/GPUDescriptorHeap.h"
 #include "DescriptorHeap/IDescriptorAllocator.h"
+#include "DescriptorHeap/SamplerCache.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
 
 namespace Ubpa::UDX12 {
+	// Owns the CSU/RTV/DSV/sampler CPU heaps, the CSU/sampler GPU heaps and the sampler cache of one adapter node.
+	// Instance() is the default manager (node mask 1, domain 0). Multi-adapter or multi-queue setups
+	// create independent managers with Instance(nodeMask, domain), so the pools of different nodes
+	// (or of different usage domains on one node, e.g. one per queue) never contend:
+	//
+	//   (nodeMask 1, domain 0) -> Instance()       (nodeMask 2, domain 0) -> node 1 heaps
+	//   (nodeMask 1, domain 1) -> compute heaps    (nodeMask 4, domain 0) -> node 2 heaps
+	//
+	// Managers can also be owned directly.
 	class DescriptorHeapMngr {
 	public:
 		static DescriptorHeapMngr& Instance() noexcept {
@@ -15,30 +36,73 @@ namespace Ubpa::UDX12 {
 			return instance;
 		}
 
+		// The manager of (nodeMask, domain), created (not initialized) on first use.
+		// Instance(1, 0) is Instance(), domain is application-defined
+		static DescriptorHeapMngr& Instance(UINT nodeMask, uint32_t domain = 0);
+		// Clears and destroys the managers created by Instance(nodeMask, domain)
+		static void DestroyInstances();
+
+		DescriptorHeapMngr() = default;
+		~DescriptorHeapMngr();
+
+		DescriptorHeapMngr(const DescriptorHeapMngr&) = delete;
+		DescriptorHeapMngr& operator=(const DescriptorHeapMngr&) = delete;
+
+		// nodeMask selects the adapter node of all heaps (a single bit, see ID3D12Device::GetNodeCount())
+		// numSamplers is the size of the shader-visible sampler heap and the capacity of the sampler cache
+		// pendingFrees makes the frees of static GPU descriptors lock-free, see GPUDescriptorHeap
 		void Init(
 			ID3D12Device* device,
 			uint32_t numCpuCSU,
 			uint32_t numCpuRTV,
 			uint32_t numCpuDSV,
 			uint32_t numGpuCSU_static,
-			uint32_t numGpuCSU_dynamic
+			uint32_t numGpuCSU_dynamic,
+			bool dynamicRing = false, // see GPUDescriptorHeap::DynamicBackend::Ring
+			UINT nodeMask = 1,
+			uint32_t numSamplers = D3D12_MAX_SHADER_VISIBLE_SAMPLER_HEAP_SIZE,
+			bool pendingFrees = false
 		);
 
+		bool IsInit() const noexcept { return isInit; }
+		UINT GetNodeMask() const noexcept { assert(isInit); return nodeMask; }
+
 		CPUDescriptorHeap* GetCSUCpuDH() const noexcept { assert(isInit); return CSU_CpuDH; }
 		CPUDescriptorHeap* GetRTVCpuDH() const noexcept { assert(isInit); return RTV_CpuDH; }
 		CPUDescriptorHeap* GetDSVCpuDH() const noexcept { assert(isInit); return DSV_CpuDH; }
 		GPUDescriptorHeap* GetCSUGpuDH() const noexcept { assert(isInit); return CSU_GpuDH; }
+		CPUDescriptorHeap* GetSamplerCpuDH() const noexcept { assert(isInit); return Sampler_CpuDH; }
+		GPUDescriptorHeap* GetSamplerGpuDH() const noexcept { assert(isInit); return Sampler_GpuDH; }
+		// e.g. cmdList.SetDescriptorHeaps(GetCSUGpuDH()->GetDescriptorHeap(), GetSamplerGpuDH()->GetDescriptorHeap())
+		SamplerCache*      GetSamplerCache() const noexcept { assert(isInit); return samplerCache; }
+
+		// Deferred release of all heaps
+		// e.g. per frame : SetFrameFenceValue(fence value signaled after the frame)
+		//                  ReleaseStaleAllocations(completed fence value)
+		void EnableDeferredRelease(bool enable) noexcept;
+		void SetFrameFenceValue(uint64_t fenceValue);
+		void ReleaseStaleAllocations(uint64_t completedFenceValue);
+
+		// Trimming of the CPU heaps, TrimIdleHeaps() is called once per frame
+		void SetTrimPolicy(const CPUDescriptorHeap::TrimPolicy& policy);
+		void TrimIdleHeaps();
+
+		// Ends the telemetry frame of all heaps and sends the snapshots to the sink, called once per frame.
+		// The heaps are named CpuCSU, CpuRTV, CpuDSV, CpuSampler, GpuCSU and GpuSampler
+		void ReportTelemetry(IDescriptorTelemetrySink& sink);
+		void EnableLockTiming(bool enable) noexcept;
 
 		void Clear();
 
 	private:
-		DescriptorHeapMngr() = default;
-		~DescriptorHeapMngr();
-
 		bool isInit{ false };
+		UINT nodeMask{ 1 };
 		CPUDescriptorHeap* CSU_CpuDH{ nullptr };
 		CPUDescriptorHeap* RTV_CpuDH{ nullptr };
 		CPUDescriptorHeap* DSV_CpuDH{ nullptr };
 		GPUDescriptorHeap* CSU_GpuDH{ nullptr };
+		CPUDescriptorHeap* Sampler_CpuDH{ nullptr };
+		GPUDescriptorHeap* Sampler_GpuDH{ nullptr };
+		SamplerCache* samplerCache{ nullptr };
 	};
 }
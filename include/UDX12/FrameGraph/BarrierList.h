@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Rsrc.h"
+
+#include <vector>
+#include <span>
+
+namespace Ubpa::UDX12::FG {
+	// resource barriers and discards of a pass, resolved by RsrcMngr before recording
+	// and replayed into the command list of the pass by a worker thread
+	//
+	//   barriers : | alias | trans | trans | trans |
+	//   discards :                 ^ (2, rsrc)         a discard is recorded after the barriers before it
+	//
+	// consecutive barriers are submitted by one ResourceBarrier call
+	class BarrierList {
+	public:
+		// skipped if before == after
+		void Transition(Rsrc* pRsrc, RsrcState before, RsrcState after);
+		void Aliasing(Rsrc* pRsrcBefore, Rsrc* pRsrcAfter);
+		void Discard(Rsrc* pRsrc);
+
+		void Clear() noexcept;
+		bool Empty() const noexcept { return barriers.empty() && discards.empty(); }
+
+		std::span<const D3D12_RESOURCE_BARRIER> GetBarriers() const noexcept { return barriers; }
+
+		void Record(ID3D12GraphicsCommandList* cmdList) const;
+
+	private:
+		std::vector<D3D12_RESOURCE_BARRIER> barriers;
+		// (number of barriers before the discard, resource)
+		std::vector<std::pair<size_t, Rsrc*>> discards;
+	};
+}
@@ -1,11 +1,13 @@
 #pragma once
 
 #include "Rsrc.h"
+#include "BarrierList.h"
 
 #include <UFG/Compiler.hpp>
 #include <UThreadPool/UThreadPool.hpp>
 
 #include <functional>
+#include <deque>
 
 namespace Ubpa::UDX12::FG {
 	class RsrcMngr;
@@ -14,7 +16,23 @@ namespace Ubpa::UDX12::FG {
 	public:
 		using PassFunction = unique_function<void(ID3D12GraphicsCommandList*, const PassRsrcs&) const>;
 
+		// consecutive passes (in the compiled order) are recorded into a shared command list
+		// as long as the sum of their costs does not exceed targetCostPerCmdList,
+		// a pass whose cost exceeds the target gets a command list of its own
+		// - the default (cost 1 per pass, target 1) records every pass into its own command list
+		// - there are at least minNumCmdLists command lists (if there are enough passes) : the target is lowered
+		//   to the total cost / minNumCmdLists and the last passes are split if the costs still give fewer lists,
+		//   command lists are recorded in parallel, the passes of a command list are recorded in order
+		// - a pass sharing a command list inherits the pipeline state of the previous pass,
+		//   so it should set all the states it uses
+		struct BatchPolicy {
+			size_t targetCostPerCmdList{ 1 };
+			size_t minNumCmdLists{ 1 };
+		};
+
 		Executor(ID3D12Device* device, size_t num_threads = std::thread::hardware_concurrency());
+		// waits for the GPU to finish the submitted command lists
+		~Executor();
 
 		Executor& RegisterPassFunc(size_t passNodeIdx, PassFunction func);
 
@@ -24,6 +42,17 @@ namespace Ubpa::UDX12::FG {
 
 		Executor& RegisterCopyPassFunc(const UFG::FrameGraph& fg, size_t passNodeIdx);
 
+		// estimated recording cost of the pass (1 by default), kept across frames
+		Executor& RegisterPassCost(size_t passNodeIdx, size_t cost);
+
+		Executor& SetBatchPolicy(BatchPolicy policy) noexcept {
+			batchPolicy = policy;
+			return *this;
+		}
+		const BatchPolicy& GetBatchPolicy() const noexcept { return batchPolicy; }
+
+		// reset the command allocators whose command lists are completed by the GPU,
+		// Execute does it as well
 		void NewFrame();
 
 		void Execute(
@@ -32,11 +61,43 @@ namespace Ubpa::UDX12::FG {
 			RsrcMngr& rsrcMngr
 		);
 
+		// signaled on the command queue after each Execute
+		ID3D12Fence* GetFence() const noexcept { return fence.Get(); }
+		UINT64 GetLastFenceValue() const noexcept { return fenceValue; }
+
 	private:
 		ThreadPool threadpool;
 		ID3D12Device* device;
 		std::unordered_map<size_t, PassFunction> passFuncs;
-		std::vector<ComPtr<ID3D12CommandAllocator>> free_allocators;
-		std::vector<ComPtr<ID3D12CommandAllocator>> used_allocators;
+		std::unordered_map<size_t, size_t> passCosts;
+		BatchPolicy batchPolicy;
+
+		// command lists are reset right after the submission,
+		// command allocators are reset after the GPU completes the fence value of their submission
+		struct CmdListPool {
+			std::vector<ComPtr<ID3D12GraphicsCommandList>> free_cmdlists;
+			std::vector<ComPtr<ID3D12CommandAllocator>> free_allocators;
+			std::deque<std::pair<UINT64, ComPtr<ID3D12CommandAllocator>>> inflight_allocators;
+		};
+		ComPtr<ID3D12GraphicsCommandList> RequestCmdList(D3D12_COMMAND_LIST_TYPE type);
+		void ReclaimAllocators();
+
+		std::unordered_map<D3D12_COMMAND_LIST_TYPE, CmdListPool> cmdListPools;
+		ComPtr<ID3D12Fence> fence;
+		UINT64 fenceValue{ 0 };
+
+		// the first pass order of every command list, and the number of passes at the end
+		std::vector<size_t> cmdlistBegins;
+
+		// command lists and allocators of the frame
+		std::vector<ComPtr<ID3D12GraphicsCommandList>> frame_cmdlists;
+		std::vector<ComPtr<ID3D12CommandAllocator>> frame_allocators;
+
+		// per pass (index by order) functions, resources and barriers of the frame, kept to reuse the storage
+		std::vector<size_t> order2pass;
+		std::vector<PassFunction> orderedPassFuncs;
+		std::vector<PassRsrcs> passRsrcs;
+		std::vector<BarrierList> preBarriers;
+		std::vector<BarrierList> postBarriers;
 	};
 }
@@ -249,10 +249,10 @@ namespace Ubpa::UDX12::FG {
 	using Rsrc = ID3D12Resource;
 	using RsrcPtr = ComPtr<Rsrc>;
 	using RsrcState = D3D12_RESOURCE_STATES;
-	struct RsrcImplDesc_SRV_NULL {};
-	struct RsrcImplDesc_UAV_NULL {};
-	struct RsrcImplDesc_RTV_Null {};
-	struct RsrcImplDesc_DSV_Null {};
+	struct RsrcImplDesc_SRV_NULL { bool operator==(const RsrcImplDesc_SRV_NULL&) const noexcept = default; };
+	struct RsrcImplDesc_UAV_NULL { bool operator==(const RsrcImplDesc_UAV_NULL&) const noexcept = default; };
+	struct RsrcImplDesc_RTV_Null { bool operator==(const RsrcImplDesc_RTV_Null&) const noexcept = default; };
+	struct RsrcImplDesc_DSV_Null { bool operator==(const RsrcImplDesc_DSV_Null&) const noexcept = default; };
 	using RsrcImplDesc = std::variant<
 		D3D12_CONSTANT_BUFFER_VIEW_DESC,
 		D3D12_SHADER_RESOURCE_VIEW_DESC,
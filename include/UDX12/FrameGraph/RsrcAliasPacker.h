@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <span>
+
+#include <cstdint>
+#include <cstddef>
+
+namespace Ubpa::UDX12::FG {
+	// places transient resources in one heap, resources whose lifetimes overlap never overlap in memory
+	// - a lifetime is the inclusive range of pass orders [first, last] in which the resource is alive
+	// - it is greedy interval graph coloring where a color is a memory range:
+	//   resources are placed from the largest to the smallest,
+	//   each one at the lowest aligned offset that is free during its whole lifetime
+	//
+	//   offset ^
+	//          |  +-------+
+	//          |  |   C   |              C can't alias A or B, its lifetime overlaps both of them
+	//          |  +---+---+---+-------+
+	//          |  | A |   | B |   D   |  B and D reuse the memory of A
+	//          +--+---+---+---+-------+--> pass order
+	//
+	// - no D3D12 calls, it runs headlessly on synthetic lifetimes
+	class RsrcAliasPacker {
+	public:
+		struct Item {
+			size_t first;       // pass order of the construction
+			size_t last;        // pass order of the destruction (inclusive)
+			uint64_t size;
+			uint64_t alignment; // power of two
+		};
+
+		static bool Overlap(const Item& lhs, const Item& rhs) noexcept {
+			return lhs.first <= rhs.last && rhs.first <= lhs.last;
+		}
+
+		// fills offsets (indexed like items), returns the size of the heap
+		uint64_t Pack(std::span<const Item> items, std::vector<uint64_t>& offsets);
+
+	private:
+		// memory range of a placed item, reused across Pack calls
+		struct Range {
+			uint64_t begin;
+			uint64_t end;
+		};
+
+		std::vector<size_t> order;
+		std::vector<Range> busy;
+	};
+}
@@ -1,11 +1,16 @@
 #pragma once
 
 #include "Rsrc.h"
+#include "RsrcViewCache.h"
+#include "RsrcAliasPacker.h"
+#include "BarrierList.h"
 
 #include "../GCmdList.h"
 #include "../Device.h"
 #include "../DescriptorHeapMngr.h"
 
+#include <UFG/Compiler.hpp>
+
 #include <unordered_set>
 
 namespace Ubpa::UFG {
@@ -15,8 +20,19 @@ namespace Ubpa::UFG {
 namespace Ubpa::UDX12::FG {
 	// manage per pass resources
 	// CBV, SRV, UAV, RTV, DSV
+	// - views of temporal resources are cached across frames (RsrcViewCache) and copied into the per frame handles,
+	//   views of imported resources are created every frame (their lifetime is unknown, the address may be reused)
+	// - in the aliasing mode, reusable temporal resources are placed resources in shared heaps,
+	//   resources whose lifetimes (pass orders) don't overlap share memory (RsrcAliasPacker)
 	class RsrcMngr {
 	public:
+		struct AliasingStats {
+			size_t numAliasedRsrcs{ 0 };
+			size_t numPlans{ 0 };          // heaps and placed resources are recreated when the plan changes
+			UINT64 numHeapBytes{ 0 };      // total size of the shared heaps
+			UINT64 numUnaliasedBytes{ 0 }; // total size of the aliased resources
+		};
+
 		RsrcMngr(ID3D12Device* device);
 		~RsrcMngr();
 
@@ -32,10 +48,38 @@ namespace Ubpa::UDX12::FG {
 		// call by Ubpa::UDX12::FG::Executor
 		void DHReserve();
 
+		// off by default, call it before Executor::Execute
+		// the pool of committed resources is still used for imported and unreusable resources
+		RsrcMngr& EnableAliasing(bool enable) {
+			aliasingEnabled = enable;
+			return *this;
+		}
+		bool IsAliasingEnabled() const noexcept { return aliasingEnabled; }
+
+		// compute the lifetimes of the temporal resources and place them in the shared heaps,
+		// the heaps and placed resources of last frame are reused if the plan is unchanged
+		// call by Ubpa::UDX12::FG::Executor
+		void PlanAliasing(const UFG::Compiler::Result& crst);
+
+		const AliasingStats& GetAliasingStats() const noexcept { return aliasingStats; }
+
 		// allocate handles in descriptor heap for each resource nodes
 		// call by Ubpa::UDX12::FG::Executor
 		void AllocateHandle();
 
+		struct PlanCacheStats {
+			size_t numHits{ 0 };
+			size_t numMisses{ 0 };
+		};
+
+		// DHReserve + AllocateHandle + PlanAliasing
+		// if the compiled graph and the registrations (except the imported views and the handles)
+		// are the same as last frame's, the handle assignment and the aliasing plan of last frame are replayed
+		// call by Ubpa::UDX12::FG::Executor
+		void PreparePlan(const UFG::Compiler::Result& crst);
+
+		const PlanCacheStats& GetPlanCacheStats() const noexcept { return planCacheStats; }
+
 		// import, create or reuse buffer for the resource node
 		// call by Ubpa::UDX12::FG::Executor
 		void Construct(size_t rsrcNodeIdx);
@@ -43,6 +87,8 @@ namespace Ubpa::UDX12::FG {
 		// recycle the buffer of the resource node
 		// call by Ubpa::UDX12::FG::Executor
 		void DestructCPU(size_t rsrcNodeIdx);
+		// the barriers are appended to the list instead of being recorded
+		void DestructGPU(BarrierList&, size_t rsrcNodeIdx);
 		void DestructGPU(ID3D12GraphicsCommandList*, size_t rsrcNodeIdx);
 
 		// move the resource view of the source resource node to the destination resource node
@@ -53,7 +99,10 @@ namespace Ubpa::UDX12::FG {
 		// - we will
 		//   1. change buffer state
 		//   2. init handle
+		// - the barriers are appended to the list instead of being recorded,
+		//   so the states of all passes can be resolved before the passes are recorded in parallel
 		// - call by Ubpa::UDX12::FG::Executor
+		PassRsrcs RequestPassRsrcs(BarrierList&, size_t passNodeIdx);
 		PassRsrcs RequestPassRsrcs(ID3D12GraphicsCommandList*, size_t passNodeIdx);
 
 		// mark the resource node as imported
@@ -98,6 +147,8 @@ namespace Ubpa::UDX12::FG {
 
 		DXGI_FORMAT GetResourceFormat(size_t rsrcNodeIdx) const;
 
+		const RsrcViewCache::Stats& GetViewCacheStats() const noexcept { return viewCache.GetStats(); }
+
 		// you should
 		// 1. use RegisterImportedRsrc or RegisterTemporalRsrc to mark each resource nodes
 		// 2. use RegisterPassRsrcs to mark each resource nodes for every passes
@@ -116,6 +167,15 @@ namespace Ubpa::UDX12::FG {
 		void DsvDHReserve(UINT num);
 		void RtvDHReserve(UINT num);
 
+		// the handle (in csuDH, rtvDH or dsvDH) of the desc is allocated or registered
+		static bool HaveHandle(const RsrcDescInfo& typeinfo, const RsrcImplDesc& desc);
+		void AssignHandle(RsrcDescInfo& typeinfo, const RsrcImplDesc& desc, UINT idx);
+
+		size_t HashPlanInputs(const UFG::Compiler::Result& crst) const;
+		bool IsPlanInputsEqual(const UFG::Compiler::Result& crst) const;
+		void SavePlan(const UFG::Compiler::Result& crst, size_t hash);
+		void ReplayPlan();
+
 		struct RsrcType {
 			D3D12_RESOURCE_DESC desc;
 			bool containClearvalue;
@@ -155,19 +215,106 @@ namespace Ubpa::UDX12::FG {
 
 		// rsrcNodeIdx -> typeinfo
 		std::unordered_map<size_t, RsrcDescInfo> typeinfoMap;
+
+		// aliasing mode
+		enum class AliasHeapClass : size_t {
+			Buffer,
+			RtDsTexture,
+			OtherTexture,
+			Num
+		};
+		struct AliasEntry {
+			size_t rsrcNodeIdx; // constructed resource node
+			RsrcType type;
+			D3D12_RESOURCE_STATES constructState;
+			RsrcAliasPacker::Item item;
+			AliasHeapClass heapClass;
+			bool operator==(const AliasEntry& rhs) const noexcept {
+				return rsrcNodeIdx == rhs.rsrcNodeIdx && type == rhs.type && constructState == rhs.constructState
+					&& item.first == rhs.item.first && item.last == rhs.item.last && heapClass == rhs.heapClass;
+			}
+		};
+
+		void CreateAliasedRsrcs();
+		void ReleaseAliasedRsrcs();
+
+		bool aliasingEnabled{ false };
+		AliasingStats aliasingStats;
+		RsrcAliasPacker aliasPacker;
+		// entries of the current plan, sorted by rsrcNodeIdx
+		std::vector<AliasEntry> aliasEntries;
+		std::vector<AliasEntry> newAliasEntries;
+		// indexed like aliasEntries, the state is kept across frames
+		std::vector<SRsrcView> aliasViews;
+		std::vector<RsrcPtr> aliasRsrcs;
+		std::vector<ComPtr<ID3D12Heap>> aliasHeaps;
+		// constructed rsrcNodeIdx -> index in aliasEntries
+		std::unordered_map<size_t, size_t> aliasIndices;
+		// aliased resource -> index in aliasEntries
+		std::unordered_map<Rsrc*, size_t> aliasRsrc2index;
+		// constructed this frame, the first pass using it emits the aliasing barrier
+		std::unordered_set<Rsrc*> aliasActivations;
+		// heaps and resources of the previous plan, released in the next NewFrame like the pool
+		std::vector<ComPtr<ID3D12Heap>> staleAliasHeaps;
+		std::vector<RsrcPtr> staleAliasRsrcs;
+
+		// (rsrcNodeIdx, desc) of RegisterRsrcHandle and RegisterRsrcTable, AllocateHandle skips them
+		std::vector<std::tuple<size_t, RsrcImplDesc>> registeredDescs;
+
+		// handle assignment of AllocateHandle
+		struct HandleAssignment {
+			size_t rsrcNodeIdx;
+			RsrcImplDesc desc;
+			UINT idx;
+		};
+
+		// last frame's inputs and results of PreparePlan
+		struct CachedPlan {
+			bool valid{ false };
+			size_t hash{ 0 };
+
+			// inputs
+			bool aliasingEnabled{ false };
+			UFG::Compiler::Result crst;
+			std::unordered_map<size_t, std::unordered_map<size_t, std::tuple<RsrcState, std::vector<RsrcImplDesc>>>> passNodeIdx2rsrcMap;
+			std::vector<std::tuple<size_t, RsrcImplDesc>> registeredDescs;
+			std::unordered_map<size_t, RsrcType> temporals;
+			std::unordered_map<size_t, bool> temporalReusable;
+			std::unordered_map<size_t, D3D12_RESOURCE_STATES> temporalConstructStates;
+			std::vector<size_t> importeds;
+
+			// results
+			std::vector<size_t> rsrcNodes;
+			std::vector<HandleAssignment> handles;
+			std::vector<UINT> csuDHfree;
+			std::vector<UINT> csuDHused;
+			std::vector<UINT> rtvDHfree;
+			std::vector<UINT> rtvDHused;
+			std::vector<UINT> dsvDHfree;
+			std::vector<UINT> dsvDHused;
+		};
+		CachedPlan plan;
+		PlanCacheStats planCacheStats;
+
+		// (temporal resource, desc) -> view
+		RsrcViewCache viewCache;
+		// cached view -> per frame handle, flushed by RequestPassRsrcs
+		UDX12::DescriptorCopyBatch csuCopyBatch;
+		UDX12::DescriptorCopyBatch rtvCopyBatch;
+		UDX12::DescriptorCopyBatch dsvCopyBatch;
 		
 		UDX12::DynamicSuballocMngr* csuDynamicDH{ nullptr };
 
 		UDX12::DescriptorHeapAllocation csuDH;
 		std::vector<UINT> csuDHfree;
-		std::unordered_set<UINT> csuDHused;
+		std::vector<UINT> csuDHused;
 
 		UDX12::DescriptorHeapAllocation rtvDH;
 		std::vector<UINT> rtvDHfree;
-		std::unordered_set<UINT> rtvDHused;
+		std::vector<UINT> rtvDHused;
 
 		UDX12::DescriptorHeapAllocation dsvDH;
 		std::vector<UINT> dsvDHfree;
-		std::unordered_set<UINT> dsvDHused;
+		std::vector<UINT> dsvDHused;
 	};
 }
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Rsrc.h"
+
+#include "../DescriptorHeapMngr.h"
+
+#include <list>
+
+namespace Ubpa::UDX12::FG {
+	// persistent (resource, view desc) -> CPU descriptor cache
+	// - the views live in the CPU descriptor heaps of DescriptorHeapMngr across frames,
+	//   so a steady-state frame copies descriptors instead of creating views
+	// - least recently used views are evicted when the cache is full,
+	//   all views of a resource are evicted when the resource is destroyed (call Evict)
+	// - the views returned since the last EndBatch() are pinned, their descriptors are still to be copied,
+	//   so they are never evicted and the cache grows past capacity if a batch needs more views
+	//
+	//   lru : | pinned (current batch) | ... | least recently used |
+	//           ^                                   ^
+	//           GetOrCreate moves a hit here        evicted when size >= capacity and not pinned
+	class RsrcViewCache {
+	public:
+		struct Stats {
+			size_t numViews{ 0 };
+			size_t numHits{ 0 };
+			size_t numMisses{ 0 }; // Create*View calls
+			size_t numEvictions{ 0 };
+			size_t numOverflows{ 0 }; // misses that grew the cache past capacity, all views were pinned
+		};
+
+		// capacity should exceed the number of views of one pass, else the cache grows past it (Stats::numOverflows),
+		// RsrcMngr copies the views of a pass after all of them are requested
+		RsrcViewCache(ID3D12Device* device, size_t capacity = 4096);
+
+		// the CPU descriptor of the view, the view is created on a miss
+		// - the BufferLocation of a CBV desc is replaced by the GPU virtual address of the resource
+		// - the view is pinned until EndBatch()
+		D3D12_CPU_DESCRIPTOR_HANDLE GetOrCreate(Rsrc* pRsrc, const RsrcImplDesc& desc);
+
+		// unpins the views returned so far, call it after their descriptors are copied
+		void EndBatch() noexcept { ++curBatch; }
+
+		// evict all views of the resource, call it before the resource is destroyed
+		// - the views must not be pinned
+		void Evict(Rsrc* pRsrc);
+
+		void Clear();
+
+		const Stats& GetStats() const noexcept { return stats; }
+
+	private:
+		struct Key {
+			Rsrc* pRsrc;
+			RsrcImplDesc desc;
+			bool operator==(const Key& rhs) const noexcept;
+		};
+		struct KeyHasher {
+			size_t operator()(const Key& key) const noexcept;
+		};
+		struct Entry {
+			Key key;
+			UDX12::DescriptorHeapAllocation allocation;
+			size_t batch; // pinned if batch == curBatch
+		};
+		using EntryIter = std::list<Entry>::iterator;
+
+		void Erase(EntryIter iter);
+
+		ID3D12Device* device;
+		size_t capacity;
+		size_t curBatch{ 0 };
+
+		std::list<Entry> lru;
+		std::unordered_map<Key, EntryIter, KeyHasher> key2entry;
+		// resource -> its views, to evict them together
+		std::unordered_map<Rsrc*, std::vector<EntryIter>> rsrc2entries;
+
+		Stats stats;
+	};
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+#include <cstddef>
+
+namespace Ubpa::UDX12 {
+    // Array of values that answers "the first index whose value is not less than x" in O(log n).
+    // Used to index the largest free block of every pooled descriptor heap.
+    //
+    //                      [1] max = 9                 root
+    //                    /             \               inner node : max of its children
+    //           [2] max = 4           [3] max = 9
+    //           /       \             /        \       ---
+    //       [4] 4     [5] 1       [6] 9      [7] 0         leaves : values[0..4), padded with 0
+    //
+    // FindFirstNotLess(5) goes down from the root and takes the left child whenever its max is large enough
+    // ([1] -> [3] -> [6]), so it returns 2.
+    //
+    class MaxSegmentTree {
+    public:
+        static constexpr size_t InvalidIndex = static_cast<size_t>(-1);
+
+        size_t Size() const noexcept { return numValues; }
+        size_t Get(size_t idx) const noexcept;
+        size_t GetMax() const noexcept { return nodes.empty() ? 0 : nodes[1]; }
+
+        // Appends a value, amortized O(log n)
+        void PushBack(size_t value);
+        void Set(size_t idx, size_t value) noexcept;
+
+        // The first index whose value is not less than minValue (InvalidIndex if there is no such index)
+        size_t FindFirstNotLess(size_t minValue) const noexcept;
+
+    private:
+        std::vector<size_t> nodes; // nodes[1] is the root, the leaves are nodes[numLeaves, 2 * numLeaves)
+        size_t numLeaves{ 0 };     // power of two
+        size_t numValues{ 0 };
+    };
+}
@@ -0,0 +1,144 @@
+// ref
+// 1. M. Masmano et al., TLSF: a New Dynamic Memory Allocator for Real-Time Systems
+// 2. http://www.gii.upv.es/tlsf/
+
+#pragma once
+
+#include <vector>
+#include <array>
+#include <utility>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Ubpa::UDX12 {
+    // Free block index used by the segregated-fit and TLSF backends of VarSizeAllocMngr.
+    //
+    // Free blocks are kept in intrusive doubly linked lists, one list per size class. The first level splits
+    // sizes into power-of-two ranges ([2^fl, 2^(fl+1))), the second level splits every range into 2^secondLevelBits
+    // equal parts. secondLevelBits == 0 gives plain power-of-two segregated fit, secondLevelBits > 0 gives
+    // two-level segregated fit (TLSF). One bitmap per level marks the non-empty classes, so the smallest class
+    // whose blocks are all large enough is found with two bit scans (O(1)).
+    //
+    //      flBitmap              0 1 1 0 1 0 ...
+    //                              | |   |
+    //      slBitmaps[fl]         ...   0 1 0 0       (secondLevelBits = 2)
+    //                                    |
+    //      heads[fl][sl]                [x]
+    //                                    |
+    //      blocks                     {16,21} -> {48,22}     {offset, size}
+    //
+    // Block records live in one contiguous array and dead records are recycled through an intrusive list.
+    // Two offset-indexed tables (first unit of a block -> record, last unit of a block -> record) locate
+    // the neighbours of a freed range for coalescing. Entries of the tables are never cleared, they are
+    // validated against the record they point to.
+    //
+    // Every class also tracks the size of its largest block and how many blocks have that size,
+    // so GetLargestBlockSize() is exact and Extract() only walks a class that is known to hold a fitting block.
+    // The maximum is recomputed by a walk over the class when its last block of that size is removed.
+    //
+    // Every container is sized at construction, so Insert(), Extract() and Free() never allocate.
+    // The tables cost 8 bytes per unit of capacity, which suits descriptor heaps (capacity is counted
+    // in descriptors) but not byte-granular ranges.
+    class SegFitFreeBlocks {
+    public:
+        static constexpr size_t InvalidOffset = static_cast<size_t>(-1);
+        static constexpr size_t MaxSecondLevelBits = 5;
+        static constexpr size_t NumFirstLevels = 64;
+
+        SegFitFreeBlocks() noexcept = default;
+        SegFitFreeBlocks(size_t capacity, size_t secondLevelBits = 0);
+        SegFitFreeBlocks(SegFitFreeBlocks&&) noexcept;
+
+        SegFitFreeBlocks& operator=(SegFitFreeBlocks&&) noexcept;
+
+        SegFitFreeBlocks(const SegFitFreeBlocks&) = delete;
+        SegFitFreeBlocks& operator=(const SegFitFreeBlocks&) = delete;
+
+        // Adds the block [offset, offset + size), the block must not be adjacent to another free block
+        void Insert(size_t offset, size_t size);
+
+        // Removes a free block whose size is not less than minSize
+        // and returns {offset, size} of the block ({InvalidOffset, 0} if there is no such block)
+        //
+        // The block is taken from the first non-empty class in which every block fits (O(1)).
+        // Only if there is no such class and the class of minSize holds a large enough block,
+        // that class is walked up to the first block that fits.
+        // Extract() fails only if minSize > GetLargestBlockSize().
+        std::pair<size_t, size_t> Extract(size_t minSize);
+
+        // Adds the range [offset, offset + size) and merges it with the adjacent free blocks
+        void Free(size_t offset, size_t size);
+
+        size_t GetNumBlocks() const noexcept { return numBlocks; }
+        size_t GetSecondLevelBits() const noexcept { return secondLevelBits; }
+
+        // number of blocks whose size is in [2^fl, 2^(fl+1))
+        size_t GetNumBlocksOfFirstLevel(size_t fl) const noexcept { return flNumBlocks[fl]; }
+
+        // size of the largest block (0 if there is no block)
+        size_t GetLargestBlockSize() const noexcept;
+
+        // number of blocks visited by the walks of Extract() over the class of minSize
+        size_t GetNumFallbackProbes() const noexcept { return numFallbackProbes; }
+
+        // calls func(offset, size) for every block, in no particular order
+        template<typename Func>
+        void ForEachBlock(Func&& func) const {
+            for (const auto& block : blocks) {
+                if (block.size != 0)
+                    func(block.offset, block.size);
+            }
+        }
+
+    private:
+        using Index = std::uint32_t;
+        static constexpr Index InvalidIndex = static_cast<Index>(-1);
+
+        struct Block {
+            size_t offset{ 0 };
+            size_t size{ 0 }; // 0 : dead record
+            Index prev{ InvalidIndex };
+            Index next{ InvalidIndex }; // next dead record if the record is dead
+        };
+
+        struct SizeClass {
+            size_t fl;
+            size_t sl;
+        };
+
+        // the class that contains blocks of the size
+        SizeClass ClassOf(size_t size) const noexcept;
+        // the first class in which every block is not less than size
+        SizeClass FitClassOf(size_t size) const noexcept;
+        size_t IndexOf(SizeClass cls) const noexcept { return (cls.fl << secondLevelBits) + cls.sl; }
+        Index& HeadOf(SizeClass cls) noexcept { return heads[IndexOf(cls)]; }
+
+        Index NewRecord();
+        void DeleteRecord(Index idx) noexcept;
+
+        void Link(Index idx) noexcept;
+        void Unlink(Index idx) noexcept;
+
+        // the free block that starts at offset (InvalidIndex if there is no such block)
+        Index FindBlockBeginAt(size_t offset) const noexcept;
+        // the free block that ends at end (InvalidIndex if there is no such block)
+        Index FindBlockEndAt(size_t end) const noexcept;
+
+        std::vector<Block> blocks;
+        std::vector<Index> begin2block;
+        std::vector<Index> last2block;
+
+        size_t secondLevelBits{ 0 };
+        std::vector<Index> heads;             // NumFirstLevels << secondLevelBits
+        std::vector<size_t> maxSizes;         // per class, 0 if the class is empty
+        std::vector<size_t> numMaxSizes;      // per class, number of blocks of maxSizes[class]
+        std::vector<std::uint32_t> slBitmaps; // NumFirstLevels
+        std::uint64_t flBitmap{ 0 };
+        std::array<size_t, NumFirstLevels> flNumBlocks{};
+
+        Index deadRecords{ InvalidIndex };
+        size_t numBlocks{ 0 };
+        size_t numFallbackProbes{ 0 };
+    };
+}
@@ -5,7 +5,13 @@
 
 #pragma once
 
+#include "SegFitFreeBlocks.h"
+
 #include <map>
+#include <vector>
+#include <array>
+#include <span>
+#include <string>
 
 namespace Ubpa::UDX12 {
     // The class handles free memory block management to accommodate variable-size allocation requests.
@@ -29,9 +35,22 @@ namespace Ubpa::UDX12 {
     //
     //                32 ------------------> 104 ---------->  {size = 32, &size2freeblock[3]}
     //
+    // The maps above form the default (tree) backend. The segregated-fit and TLSF backends (SegFitFreeBlocks) replace
+    // them with size-class lists over a contiguous record array, so they do not allocate after construction.
+    // The backend is chosen at construction, all of them share the same allocation and alignment semantics.
+    //
     class VarSizeAllocMngr {
     public:
-        VarSizeAllocMngr(size_t capacity);
+        enum class Backend {
+            Tree,          // std::map + std::multimap, best fit, O(log n)
+            SegregatedFit, // SegFitFreeBlocks with power-of-two classes, good fit
+            TLSF           // SegFitFreeBlocks with 2^TLSFSecondLevelBits subclasses per power of two, good fit, O(1) (see SegFitFreeBlocks::Extract())
+        };
+
+        static constexpr size_t TLSFSecondLevelBits = 4;
+        static constexpr size_t NumHistogramBins = SegFitFreeBlocks::NumFirstLevels;
+
+        VarSizeAllocMngr(size_t capacity, Backend backend = Backend::Tree);
         VarSizeAllocMngr(VarSizeAllocMngr&&) noexcept;
 
         VarSizeAllocMngr& operator=(VarSizeAllocMngr&&) noexcept;
@@ -53,23 +72,85 @@ namespace Ubpa::UDX12 {
             size_t size{ 0 };
         };
 
+        struct Request {
+            size_t size{ 0 };
+            size_t alignment{ 1 };
+        };
+
         Allocation Allocate(size_t size, size_t alignment);
 
+        // Processes the requests in order, allocations[i] is the result of requests[i] (invalid on failure)
+        //
+        // Consecutive requests are carved from the same free block while it is large enough,
+        // the remainder goes back to the free block index once instead of once per request.
+        // As a side effect, the allocations of a batch are usually adjacent, so FreeBatch() can merge them.
+        void AllocateBatch(std::span<const Request> requests, std::span<Allocation> allocations);
+
         void Free(Allocation&& allocation) {
             Free(allocation.unalignedOffset, allocation.size);
             allocation.Reset();
         }
         void Free(size_t offset, size_t size);
 
+        // Sorts the allocations by offset and merges the adjacent ones,
+        // so the free block index is updated once per merged range instead of once per allocation
+        //
+        //  |<--a0-->|<----a1---->|<-a2->| ~ ~ |<---a3--->|<-a4->|
+        //  |<----------- Free() ------->|     |<----Free()----->|
+        //
+        void FreeBatch(std::span<const Allocation> allocations);
+
+        // The histogram and the allocation counts are maintained on every operation,
+        // GetStats() itself only sums the histogram and looks up the largest free block
+        struct Stats {
+            size_t capacity{ 0 };
+            size_t freeSize{ 0 };
+            size_t largestFreeBlock{ 0 };
+            size_t numFreeBlocks{ 0 };
+            // freeBlockHistogram[i] : number of free blocks whose size is in [2^i, 2^(i+1))
+            std::array<size_t, NumHistogramBins> freeBlockHistogram{};
+            // 1 - largestFreeBlock / freeSize (0 if there is no free space)
+            // 0 : the free space is one block, close to 1 : the free space is scattered in small blocks
+            double fragmentation{ 0. };
+            size_t numAllocations{ 0 };
+            size_t peakNumAllocations{ 0 };
+        };
+
+        Stats GetStats() const noexcept;
+
+        // Free blocks sorted by offset
+        // - text : "[8, 24) [32, 56) [104, 136)"
+        // - json : {"capacity":136,"freeSize":72,"blocks":[{"offset":8,"size":16},...]}
+        std::string DumpFreeBlocks(bool json = false) const;
+
         bool IsFull() const noexcept { return freeSize == 0; };
         bool IsEmpty() const noexcept { return freeSize == capacity; };
         size_t GetCapacity() const noexcept { return capacity; }
         size_t GetFreeSize() const noexcept { return freeSize; }
         size_t GetUsedSize() const noexcept { return capacity - freeSize; }
+        size_t GetNumFreeBlocks() const noexcept;
+        size_t GetLargestFreeBlockSize() const noexcept;
+        size_t GetNumAllocations() const noexcept { return numAllocations; }
+        size_t GetPeakNumAllocations() const noexcept { return peakNumAllocations; }
+        Backend GetBackend() const noexcept { return backend; }
 
     private:
         void AddNewBlock(size_t Offset, size_t Size);
 
+        // Allocates size (aligned) + alignment padding from the front of the extracted block [blockOffset, blockOffset + blockSize),
+        // blockOffset and blockSize are updated to the remainder of the block
+        Allocation CarveBlock(size_t& blockOffset, size_t& blockSize, size_t size, size_t alignment);
+
+        // Removes a free block that is not smaller than minSize
+        // and returns {offset, size} of the block ({Allocation::InvalidOffset, 0} if there is no such block)
+        std::pair<size_t, size_t> ExtractBlock(size_t minSize);
+
+        // Returns the range to the free blocks, does not count allocations
+        void FreeRange(size_t offset, size_t size);
+
+        // Adds the range to the free blocks of the tree backend and merges it with the adjacent blocks
+        void FreeTreeBlock(size_t offset, size_t size);
+
         void ResetCurrAlignment() noexcept;
 
         struct FreeBlockInfo;
@@ -92,9 +173,17 @@ namespace Ubpa::UDX12 {
 
         TFreeBlocksByOffsetMap offset2freeblock;
         TFreeBlocksBySizeMap   size2freeblock;
+        std::array<size_t, NumHistogramBins> treeHistogram{}; // the segregated-fit backends count their own blocks
 
+        SegFitFreeBlocks segFitFreeBlocks;
+
+        Backend backend = Backend::Tree;
         size_t capacity = 0;
         size_t freeSize = 0;
         size_t curMinAlignment = 0; // min alignment of all free blocks
+        size_t numAllocations = 0;
+        size_t peakNumAllocations = 0;
+
+        std::vector<Allocation> batchScratch; // sorted copy of the FreeBatch() input
     };
 }
@@ -0,0 +1,86 @@
+#include <UDX12/DescriptorHeap/BindlessTable.h>
+
+#include <UDX12/DescriptorHeap/GPUDescriptorHeap.h>
+
+using namespace Ubpa;
+
+UDX12::BindlessTable::BindlessTable(ID3D12Device* pDevice, GPUDescriptorHeap& Heap, uint32_t NumIndices) :
+    m_Range{ Heap.Allocate(NumIndices) },
+    m_Writes{ pDevice, Heap.GetHeapDesc().Type }
+{
+    assert("The static part of the heap is too small for the table" && !m_Range.IsNull());
+    m_HeapOffset = static_cast<uint32_t>((m_Range.GetCpuHandle().ptr
+        - Heap.GetDescriptorHeap()->GetCPUDescriptorHandleForHeapStart().ptr) / m_Range.GetDescriptorSize());
+    m_FreeIndices.reserve(NumIndices);
+}
+
+UDX12::BindlessTable::~BindlessTable() {
+    // m_Range is freed by its destructor, through the deferred release of the heap if it is enabled
+    assert(m_Writes.GetNumPendingCopies() == 0 && "Writes are not flushed");
+}
+
+uint32_t UDX12::BindlessTable::Allocate() {
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+    if (!m_FreeIndices.empty()) {
+        auto Index = m_FreeIndices.back();
+        m_FreeIndices.pop_back();
+        return Index;
+    }
+
+    if (m_NumUsedIndices == m_Range.GetNumHandles())
+        return InvalidIndex;
+
+    return m_NumUsedIndices++;
+}
+
+uint32_t UDX12::BindlessTable::Allocate(D3D12_CPU_DESCRIPTOR_HANDLE Src) {
+    auto Index = Allocate();
+    if (Index != InvalidIndex)
+        Write(Index, Src);
+    return Index;
+}
+
+void UDX12::BindlessTable::Free(uint32_t Index) {
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    assert(Index < m_NumUsedIndices);
+    m_StaleIndices.push_back({ m_FenceValue, Index });
+}
+
+void UDX12::BindlessTable::Write(uint32_t Index, D3D12_CPU_DESCRIPTOR_HANDLE Src) {
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    m_Writes.Add(m_Range.GetCpuHandle(Index), Src);
+}
+
+UDX12::DescriptorCopyBatch::FlushStats UDX12::BindlessTable::FlushWrites() {
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    return m_Writes.Flush();
+}
+
+void UDX12::BindlessTable::SetFrameFenceValue(uint64_t FenceValue) {
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    assert("Fence values must not decrease" && FenceValue >= m_FenceValue);
+    m_FenceValue = FenceValue;
+}
+
+void UDX12::BindlessTable::ReleaseStaleIndices(uint64_t CompletedFenceValue) {
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+    if (m_StaleIndices.empty() || m_StaleIndices.front().FenceValue > CompletedFenceValue)
+        return;
+
+    // A recycled index may be written again before the next flush, the destinations of one flush must not overlap
+    if (m_Writes.GetNumPendingCopies() > 0)
+        m_Writes.Flush();
+
+    // Fence values are pushed in non-decreasing order
+    while (!m_StaleIndices.empty() && m_StaleIndices.front().FenceValue <= CompletedFenceValue) {
+        m_FreeIndices.push_back(m_StaleIndices.front().Index);
+        m_StaleIndices.pop_front();
+    }
+}
+
+uint32_t UDX12::BindlessTable::GetNumUsedIndices() {
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    return m_NumUsedIndices - static_cast<uint32_t>(m_FreeIndices.size());
+}
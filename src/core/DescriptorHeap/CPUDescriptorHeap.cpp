@@ -2,13 +2,21 @@
 
 #include <UDX12/DescriptorHeap/DescriptorHeapAllocation.h>
 
+#include <algorithm>
+#include <thread>
+#include <limits>
+
 using namespace Ubpa;
 
 UDX12::CPUDescriptorHeap::CPUDescriptorHeap(
     ID3D12Device*               pDevice,
     uint32_t                    NumDescriptorsInHeap,
     D3D12_DESCRIPTOR_HEAP_TYPE  Type,
-    D3D12_DESCRIPTOR_HEAP_FLAGS Flags)
+    D3D12_DESCRIPTOR_HEAP_FLAGS Flags,
+    VarSizeAllocMngr::Backend   Backend,
+    uint32_t                    CacheSize,
+    uint32_t                    NumSlabDescriptors,
+    UINT                        NodeMask)
     :
     m_pDevice{ pDevice },
     m_HeapDesc
@@ -16,63 +24,121 @@ UDX12::CPUDescriptorHeap::CPUDescriptorHeap(
         Type,
         NumDescriptorsInHeap,
         Flags,
-        1   // NodeMask
+        NodeMask
     },
-    m_DescriptorSize{ pDevice->GetDescriptorHandleIncrementSize(Type) }
+    m_DescriptorSize{ pDevice->GetDescriptorHandleIncrementSize(Type) },
+    m_Backend{ Backend },
+    m_NumSlabDescriptors{ NumSlabDescriptors },
+    m_CacheSize{ CacheSize },
+    m_Telemetry{ pDevice->GetDescriptorHandleIncrementSize(Type) }
 {
     // Create one pool
-    m_HeapPool.emplace_back(m_pDevice, *this, 0, m_HeapDesc);
-    m_AvailableHeaps.insert(0);
+    CreateHeap(0);
+
+    if (m_CacheSize > 0)
+        m_ThreadCaches = std::make_unique<ThreadCache[]>(NumThreadCaches);
 }
 
 UDX12::CPUDescriptorHeap::~CPUDescriptorHeap() {
+    // The GPU must be idle at this point
+    ReleaseStaleAllocations(std::numeric_limits<uint64_t>::max());
+    FlushThreadCaches();
+
     assert(m_CurrentSize == 0 && "Not all allocations released");
 
-    assert(m_AvailableHeaps.size() == m_HeapPool.size() && "Not all descriptor heap pools are released");
+    assert(m_LargestFreeBlocks.Size() == m_HeapPool.size());
 
 #ifndef NDEBUG
-    for (const auto& Heap : m_HeapPool)
-        assert(Heap.GetNumAvailableDescriptors() == Heap.GetMaxDescriptors() && "Not all descriptors in the descriptor pool are released");
+    for (const auto& Relocatable : m_Relocatables)
+        assert(Relocatable.Allocation.IsNull() && "Not all relocatable allocations released");
+    for (const auto& Heap : m_HeapPool) {
+        if (Heap)
+            assert(Heap->GetNumAvailableDescriptors() == Heap->GetMaxDescriptors() && "Not all descriptors in the descriptor pool are released");
+    }
 #endif // !NDEBUG
 }
 
+UDX12::CPUDescriptorHeap::ThreadCache* UDX12::CPUDescriptorHeap::TryLockThreadCache() noexcept {
+    auto& cache = m_ThreadCaches[std::hash<std::thread::id>{}(std::this_thread::get_id()) % NumThreadCaches];
+    if (cache.Busy.test_and_set(std::memory_order_acquire))
+        return nullptr;
+    return &cache;
+}
+
+void UDX12::CPUDescriptorHeap::FlushThreadCaches() {
+    if (!m_ThreadCaches)
+        return;
+
+    for (size_t i = 0; i < NumThreadCaches; i++) {
+        auto& cache = m_ThreadCaches[i];
+        while (cache.Busy.test_and_set(std::memory_order_acquire))
+            std::this_thread::yield();
+        for (auto& magazine : cache.Magazines) {
+            FreeBatchToPool(magazine);
+            magazine.clear();
+        }
+        cache.Busy.clear(std::memory_order_release);
+    }
+}
+
 UDX12::DescriptorHeapAllocation UDX12::CPUDescriptorHeap::Allocate(uint32_t count) {
-    std::lock_guard<std::mutex> lockGuard(m_HeapPoolMutex);
+    auto allocation = AllocateFromCache(count);
+    if (allocation.IsNull())
+        m_Telemetry.OnFailedAllocation();
+    else
+        m_Telemetry.OnAllocate(count);
+    return allocation;
+}
+
+UDX12::DescriptorHeapAllocation UDX12::CPUDescriptorHeap::AllocateFromCache(uint32_t count) {
+    if (m_CacheSize == 0 || count > MaxCachedCount)
+        return AllocateFromPool(count);
+
+    auto* pCache = TryLockThreadCache();
+    if (!pCache)
+        return AllocateFromPool(count);
+
+    auto& magazine = pCache->Magazines[count - 1];
+    if (magazine.empty()) {
+        // Refill half of the magazine, so that the following frees have room as well
+        magazine.resize((m_CacheSize + 1) / 2);
+        AllocateBatchFromPool(count, magazine);
+        while (!magazine.empty() && magazine.back().IsNull())
+            magazine.pop_back();
+    }
+
+    DescriptorHeapAllocation allocation;
+    if (!magazine.empty()) {
+        allocation = std::move(magazine.back());
+        magazine.pop_back();
+    }
+
+    pCache->Busy.clear(std::memory_order_release);
+    return allocation;
+}
+
+UDX12::DescriptorHeapAllocation UDX12::CPUDescriptorHeap::AllocateFromPool(uint32_t count) {
+    DescriptorTelemetry::LockGuard<std::mutex> lockGuard(m_HeapPoolMutex, m_Telemetry);
     // Note that every DescriptorHeapAllocationManager object instance is itslef
     // thread-safe. Nested mutexes cannot cause a deadlock
 
+    // Find the first descriptor heap manager that can handle the request. If its entry in the index
+    // is stale and the request fails, the entry is refreshed and the search goes on. If there is
+    // no such manager, create a new manager
     DescriptorHeapAllocation allocation;
-    // Go through all descriptor heap managers that have free descriptors
-    auto availableHeapIter = m_AvailableHeaps.begin();
-    while (availableHeapIter != m_AvailableHeaps.end()) {
-        auto nextIter = availableHeapIter;
-        ++nextIter;
-        // Try to allocate descriptor using the current descriptor heap manager
-        allocation = m_HeapPool[*availableHeapIter].Allocate(count);
-        // Remove the manager from the pool if it has no more available descriptors
-        if (m_HeapPool[*availableHeapIter].GetNumAvailableDescriptors() == 0)
-            m_AvailableHeaps.erase(*availableHeapIter);
-
-        // Terminate the loop if descriptor was successfully allocated, otherwise
-        // go to the next manager
+    for (auto heapIdx = m_LargestFreeBlocks.FindFirstNotLess(count); heapIdx != MaxSegmentTree::InvalidIndex;
+        heapIdx = m_LargestFreeBlocks.FindFirstNotLess(count))
+    {
+        allocation = m_HeapPool[heapIdx]->Allocate(count);
+        UpdateLargestFreeBlock(heapIdx);
         if (!allocation.IsNull())
             break;
-        availableHeapIter = nextIter;
     }
-
-    // If there were no available descriptor heap managers or no manager was able
-    // to suffice the allocation request, create a new manager
     if (allocation.IsNull()) {
-        // Make sure the heap is large enough to accomodate the requested number of descriptors
-        m_HeapDesc.NumDescriptors = std::max(m_HeapDesc.NumDescriptors, static_cast<UINT>(count));
-        // Create a new descriptor heap manager. Note that this constructor creates a new D3D12 descriptor
-        // heap and references the entire heap. Pool index is used as manager ID
-        m_HeapPool.emplace_back(m_pDevice, *this, m_HeapPool.size(), m_HeapDesc);
-        auto newHeapIter = m_AvailableHeaps.insert(m_HeapPool.size() - 1);
-        assert(newHeapIter.second);
-
-        // Use the new manager to allocate descriptor handles
-        allocation = m_HeapPool[*newHeapIter.first].Allocate(count);
+        auto heapIdx = CreateHeap(count);
+        allocation = m_HeapPool[heapIdx]->Allocate(count);
+        assert(!allocation.IsNull());
+        UpdateLargestFreeBlock(heapIdx);
     }
 
     m_CurrentSize += static_cast<uint32_t>(allocation.GetNumHandles());
@@ -81,12 +147,374 @@ UDX12::DescriptorHeapAllocation UDX12::CPUDescriptorHeap::Allocate(uint32_t coun
     return allocation;
 }
 
+void UDX12::CPUDescriptorHeap::AllocateBatchFromPool(uint32_t count, std::span<DescriptorHeapAllocation> allocations) {
+    DescriptorTelemetry::LockGuard<std::mutex> lockGuard(m_HeapPoolMutex, m_Telemetry);
+
+    m_BatchCounts.assign(allocations.size(), count);
+
+    // All requests have the same size, so once a manager fails a request, it fails the rest as well
+    // and the allocations of a manager form a prefix of the remaining span
+    size_t numAllocated = 0;
+    auto allocateFrom = [&](size_t heapIdx) {
+        auto rest = allocations.subspan(numAllocated);
+        m_HeapPool[heapIdx]->AllocateBatch(std::span<const uint32_t>{ m_BatchCounts }.first(rest.size()), rest);
+        while (numAllocated < allocations.size() && !allocations[numAllocated].IsNull())
+            ++numAllocated;
+        assert(std::all_of(allocations.begin() + numAllocated, allocations.end(),
+            [](const DescriptorHeapAllocation& allocation) { return allocation.IsNull(); }));
+    };
+
+    // A manager whose entry in the index is stale may allocate nothing, its entry is refreshed
+    // below, so it is not found again
+    while (numAllocated < allocations.size()) {
+        auto heapIdx = m_LargestFreeBlocks.FindFirstNotLess(count);
+        if (heapIdx == MaxSegmentTree::InvalidIndex)
+            heapIdx = CreateHeap(count);
+        allocateFrom(heapIdx);
+        UpdateLargestFreeBlock(heapIdx);
+    }
+
+    m_CurrentSize += static_cast<uint32_t>(numAllocated) * count;
+    m_MaxSize = std::max(m_MaxSize, m_CurrentSize);
+}
+
 void UDX12::CPUDescriptorHeap::Free(DescriptorHeapAllocation&& allocation) {
-    std::lock_guard<std::mutex> lockGuard(m_HeapPoolMutex);
+    if (allocation.IsNull())
+        return;
+    m_Telemetry.OnFree(allocation.GetNumHandles());
+
+    if (m_DeferredRelease) {
+        m_ReleaseQueue.Push(std::move(allocation));
+        return;
+    }
+
+    auto count = allocation.GetNumHandles();
+    if (m_CacheSize == 0 || count > MaxCachedCount) {
+        FreeToPool(std::move(allocation));
+        return;
+    }
+
+    auto* pCache = TryLockThreadCache();
+    if (!pCache) {
+        FreeToPool(std::move(allocation));
+        return;
+    }
+
+    auto& magazine = pCache->Magazines[count - 1];
+    if (magazine.size() >= m_CacheSize) {
+        // Return the older half, the recently freed descriptors are the ones most likely in CPU caches
+        auto numFlushed = magazine.size() - m_CacheSize / 2;
+        FreeBatchToPool(std::span{ magazine }.first(numFlushed));
+        magazine.erase(magazine.begin(), magazine.begin() + numFlushed);
+    }
+    magazine.push_back(std::move(allocation));
+
+    pCache->Busy.clear(std::memory_order_release);
+}
+
+void UDX12::CPUDescriptorHeap::ReleaseStaleAllocations(uint64_t completedFenceValue) {
+    m_ReleaseQueue.Release(completedFenceValue, [this](std::span<DescriptorHeapAllocation> allocations) {
+        FreeBatchToPool(allocations);
+    });
+}
+
+void UDX12::CPUDescriptorHeap::FreeBatchToPool(std::span<DescriptorHeapAllocation> allocations) {
+    if (allocations.empty())
+        return;
+
+    DescriptorTelemetry::LockGuard<std::mutex> lockGuard(m_HeapPoolMutex, m_Telemetry);
+
+    // Group the allocations by manager, so that every manager is locked once.
+    // Null allocations have the largest manager Id (-1), so they end up last and are skipped
+    std::sort(allocations.begin(), allocations.end(), [](const DescriptorHeapAllocation& lhs, const DescriptorHeapAllocation& rhs) {
+        return lhs.GetAllocationManagerId() < rhs.GetAllocationManagerId();
+    });
+
+    size_t begin = 0;
+    while (begin < allocations.size() && !allocations[begin].IsNull()) {
+        auto managerId = allocations[begin].GetAllocationManagerId();
+        size_t end = begin;
+        for (; end < allocations.size() && allocations[end].GetAllocationManagerId() == managerId; ++end)
+            m_CurrentSize -= static_cast<uint32_t>(allocations[end].GetNumHandles());
+        m_HeapPool[managerId]->FreeAllocations(allocations.subspan(begin, end - begin));
+        UpdateLargestFreeBlock(managerId);
+        begin = end;
+    }
+}
+
+void UDX12::CPUDescriptorHeap::FreeToPool(DescriptorHeapAllocation&& allocation) {
+    DescriptorTelemetry::LockGuard<std::mutex> lockGuard(m_HeapPoolMutex, m_Telemetry);
     auto                        managerId = allocation.GetAllocationManagerId();
     m_CurrentSize -= static_cast<uint32_t>(allocation.GetNumHandles());
-    m_HeapPool[managerId].FreeAllocation(std::move(allocation));
-    // Return the manager to the pool of available managers
-    assert(m_HeapPool[managerId].GetNumAvailableDescriptors() > 0);
-    m_AvailableHeaps.insert(managerId);
+    m_HeapPool[managerId]->FreeAllocation(std::move(allocation));
+    UpdateLargestFreeBlock(managerId);
+}
+
+size_t UDX12::CPUDescriptorHeap::CreateHeap(uint32_t count) {
+    // Make sure the heap is large enough to accomodate the requested number of descriptors
+    // (the slab part does not serve ranges)
+    if (count > 0)
+        m_HeapDesc.NumDescriptors = std::max(m_HeapDesc.NumDescriptors, static_cast<UINT>(count) + m_NumSlabDescriptors);
+    // Create a new descriptor heap manager. Note that this constructor creates a new D3D12 descriptor
+    // heap and references the entire heap. Pool index is used as manager ID, the first slot
+    // released by Compact() is reused
+    auto emptySlot = std::find(m_HeapPool.begin(), m_HeapPool.end(), nullptr);
+    size_t heapIdx = static_cast<size_t>(emptySlot - m_HeapPool.begin());
+    auto heap = std::make_unique<DescriptorHeapAllocMngr>(m_pDevice, *this, heapIdx, m_HeapDesc, m_Backend, m_NumSlabDescriptors);
+    if (emptySlot != m_HeapPool.end()) {
+        *emptySlot = std::move(heap);
+        m_NumRelocatableDescriptors[heapIdx] = 0;
+        m_NumIdleFrames[heapIdx] = 0;
+        UpdateLargestFreeBlock(heapIdx);
+    }
+    else {
+        m_HeapPool.push_back(std::move(heap));
+        m_NumRelocatableDescriptors.push_back(0);
+        m_NumIdleFrames.push_back(0);
+        m_LargestFreeBlocks.PushBack(m_HeapPool.back()->GetMaxAllocatableCount());
+    }
+    ++m_TrimStats.NumCreatedHeaps;
+    return heapIdx;
+}
+
+void UDX12::CPUDescriptorHeap::ReleaseHeap(size_t heapIdx) {
+    assert(GetNumUsedDescriptors(heapIdx) == 0 && m_NumRelocatableDescriptors[heapIdx] == 0);
+    m_HeapPool[heapIdx].reset();
+    m_LargestFreeBlocks.Set(heapIdx, 0);
+}
+
+size_t UDX12::CPUDescriptorHeap::GetNumHeaps() {
+    DescriptorTelemetry::LockGuard<std::mutex> lockGuard(m_HeapPoolMutex, m_Telemetry);
+    return static_cast<size_t>(std::count_if(m_HeapPool.begin(), m_HeapPool.end(),
+        [](const auto& heap) { return heap != nullptr; }));
+}
+
+UDX12::CPUDescriptorHeap::RelocatableId UDX12::CPUDescriptorHeap::AllocateRelocatable(uint32_t count, RelocationCallback callback) {
+    auto allocation = Allocate(count);
+    if (allocation.IsNull())
+        return InvalidRelocatableId;
+
+    DescriptorTelemetry::LockGuard<std::mutex> lockGuard(m_HeapPoolMutex, m_Telemetry);
+    m_NumRelocatableDescriptors[allocation.GetAllocationManagerId()] += count;
+
+    RelocatableId id;
+    if (!m_FreeRelocatableIds.empty()) {
+        id = m_FreeRelocatableIds.back();
+        m_FreeRelocatableIds.pop_back();
+    }
+    else {
+        id = static_cast<RelocatableId>(m_Relocatables.size());
+        m_Relocatables.emplace_back();
+    }
+    m_Relocatables[id] = { std::move(allocation), std::move(callback) };
+    return id;
+}
+
+void UDX12::CPUDescriptorHeap::FreeRelocatable(RelocatableId id) {
+    DescriptorHeapAllocation allocation;
+    {
+        DescriptorTelemetry::LockGuard<std::mutex> lockGuard(m_HeapPoolMutex, m_Telemetry);
+        assert(id < m_Relocatables.size() && !m_Relocatables[id].Allocation.IsNull());
+        auto& relocatable = m_Relocatables[id];
+        m_NumRelocatableDescriptors[relocatable.Allocation.GetAllocationManagerId()] -= relocatable.Allocation.GetNumHandles();
+        allocation = std::move(relocatable.Allocation);
+        relocatable.Callback = nullptr;
+        m_FreeRelocatableIds.push_back(id);
+    }
+    // Free() takes m_HeapPoolMutex
+    Free(std::move(allocation));
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE UDX12::CPUDescriptorHeap::GetRelocatableHandle(RelocatableId id, uint32_t offset) {
+    DescriptorTelemetry::LockGuard<std::mutex> lockGuard(m_HeapPoolMutex, m_Telemetry);
+    assert(id < m_Relocatables.size() && !m_Relocatables[id].Allocation.IsNull());
+    return m_Relocatables[id].Allocation.GetCpuHandle(offset);
+}
+
+bool UDX12::CPUDescriptorHeap::BeginHeapCompaction() {
+    assert(m_CompactionHeap == InvalidHeapIdx);
+
+    // Drain the heap with the fewest used descriptors among the heaps that only hold relocatable allocations,
+    // if the other heaps have enough room for them
+    size_t numHeaps = 0;
+    size_t numAvailable = 0;
+    size_t srcIdx = InvalidHeapIdx;
+    uint32_t srcNumUsed = std::numeric_limits<uint32_t>::max();
+    for (size_t i = 0; i < m_HeapPool.size(); i++) {
+        if (!m_HeapPool[i])
+            continue;
+        ++numHeaps;
+        numAvailable += m_HeapPool[i]->GetNumAvailableDescriptors();
+        auto numUsed = GetNumUsedDescriptors(i);
+        if (numUsed == m_NumRelocatableDescriptors[i] && numUsed < srcNumUsed) {
+            srcIdx = i;
+            srcNumUsed = numUsed;
+        }
+    }
+
+    if (numHeaps < 2 || srcIdx == InvalidHeapIdx)
+        return false;
+    if (numAvailable - m_HeapPool[srcIdx]->GetNumAvailableDescriptors() < srcNumUsed)
+        return false;
+
+    m_CompactionHeap = srcIdx;
+    UpdateLargestFreeBlock(srcIdx);
+
+    m_CompactionQueue.clear();
+    for (size_t id = 0; id < m_Relocatables.size(); id++) {
+        const auto& allocation = m_Relocatables[id].Allocation;
+        if (!allocation.IsNull() && allocation.GetAllocationManagerId() == srcIdx)
+            m_CompactionQueue.push_back(static_cast<RelocatableId>(id));
+    }
+
+    return true;
+}
+
+void UDX12::CPUDescriptorHeap::EndHeapCompaction() {
+    auto heapIdx = m_CompactionHeap;
+    m_CompactionHeap = InvalidHeapIdx;
+    m_CompactionQueue.clear();
+    if (m_HeapPool[heapIdx])
+        UpdateLargestFreeBlock(heapIdx);
+}
+
+UDX12::CPUDescriptorHeap::CompactionStats UDX12::CPUDescriptorHeap::Compact(std::chrono::microseconds budget) {
+    auto deadline = std::chrono::steady_clock::now() + budget;
+
+    CompactionStats stats;
+
+    // Cached allocations count as used, so they would keep their heaps alive
+    FlushThreadCaches();
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        RelocationCallback          callback;
+        D3D12_CPU_DESCRIPTOR_HANDLE oldHandle;
+        D3D12_CPU_DESCRIPTOR_HANDLE newHandle;
+        {
+            DescriptorTelemetry::LockGuard<std::mutex> lockGuard(m_HeapPoolMutex, m_Telemetry);
+
+            if (m_CompactionHeap == InvalidHeapIdx && !BeginHeapCompaction()) {
+                stats.Finished = true;
+                break;
+            }
+
+            auto srcIdx = m_CompactionHeap;
+            if (GetNumUsedDescriptors(srcIdx) == 0) {
+                ReleaseHeap(srcIdx);
+                EndHeapCompaction();
+                ++stats.NumReleasedHeaps;
+                continue;
+            }
+
+            if (m_CompactionQueue.empty()) {
+                // The rest are non-relocatable allocations that were cached or deferred at BeginHeapCompaction()
+                EndHeapCompaction();
+                continue;
+            }
+
+            auto id = m_CompactionQueue.back();
+            m_CompactionQueue.pop_back();
+            // The ID may have been freed (and reused) since the queue was built
+            auto& relocatable = m_Relocatables[id];
+            if (relocatable.Allocation.IsNull() || relocatable.Allocation.GetAllocationManagerId() != srcIdx)
+                continue;
+
+            auto count = relocatable.Allocation.GetNumHandles();
+            auto dstIdx = m_LargestFreeBlocks.FindFirstNotLess(count);
+            if (dstIdx == MaxSegmentTree::InvalidIndex) {
+                // Too fragmented, new heaps are not created for compaction
+                EndHeapCompaction();
+                stats.Finished = true;
+                break;
+            }
+
+            auto allocation = m_HeapPool[dstIdx]->Allocate(count);
+            assert(!allocation.IsNull());
+            UpdateLargestFreeBlock(dstIdx);
+
+            oldHandle = relocatable.Allocation.GetCpuHandle();
+            newHandle = allocation.GetCpuHandle();
+            m_pDevice->CopyDescriptorsSimple(count, newHandle, oldHandle, m_HeapDesc.Type);
+
+            // The move assignment doesn't free the old allocation
+            m_HeapPool[srcIdx]->FreeAllocation(std::move(relocatable.Allocation));
+            relocatable.Allocation = std::move(allocation);
+            m_NumRelocatableDescriptors[srcIdx] -= count;
+            m_NumRelocatableDescriptors[dstIdx] += count;
+
+            callback = relocatable.Callback;
+            ++stats.NumMovedAllocations;
+            stats.NumMovedDescriptors += count;
+        }
+
+        if (callback)
+            callback(oldHandle, newHandle);
+    }
+
+    return stats;
+}
+
+void UDX12::CPUDescriptorHeap::SetTrimPolicy(const TrimPolicy& policy) {
+    assert(policy.MinNumHeaps <= policy.MaxNumHeaps);
+    DescriptorTelemetry::LockGuard<std::mutex> lockGuard(m_HeapPoolMutex, m_Telemetry);
+    m_TrimPolicy = policy;
+}
+
+UDX12::CPUDescriptorHeap::TrimPolicy UDX12::CPUDescriptorHeap::GetTrimPolicy() {
+    DescriptorTelemetry::LockGuard<std::mutex> lockGuard(m_HeapPoolMutex, m_Telemetry);
+    return m_TrimPolicy;
+}
+
+UDX12::CPUDescriptorHeap::TrimStats UDX12::CPUDescriptorHeap::GetTrimStats() {
+    DescriptorTelemetry::LockGuard<std::mutex> lockGuard(m_HeapPoolMutex, m_Telemetry);
+    return m_TrimStats;
+}
+
+size_t UDX12::CPUDescriptorHeap::TrimIdleHeaps() {
+    DescriptorTelemetry::LockGuard<std::mutex> lockGuard(m_HeapPoolMutex, m_Telemetry);
+
+    if (m_TrimPolicy.NumIdleFrames == 0)
+        return 0;
+
+    size_t numHeaps = 0;
+    size_t numAvailable = 0;
+    for (size_t i = 0; i < m_HeapPool.size(); i++) {
+        if (!m_HeapPool[i])
+            continue;
+        ++numHeaps;
+        numAvailable += m_HeapPool[i]->GetNumAvailableDescriptors();
+        if (GetNumUsedDescriptors(i) == 0)
+            m_NumIdleFrames[i] = std::min(m_NumIdleFrames[i] + 1, m_TrimPolicy.NumIdleFrames);
+        else
+            m_NumIdleFrames[i] = 0;
+    }
+
+    // Release from the back, allocations are served by the heaps with the lowest IDs first
+    // (the heap being drained by Compact() is left to Compact())
+    size_t numReleased = 0;
+    for (size_t i = m_HeapPool.size(); i-- > 0 && numHeaps > m_TrimPolicy.MinNumHeaps;) {
+        if (!m_HeapPool[i] || i == m_CompactionHeap || GetNumUsedDescriptors(i) != 0)
+            continue;
+
+        bool overMax = numHeaps > m_TrimPolicy.MaxNumHeaps;
+        if (!overMax && m_NumIdleFrames[i] < m_TrimPolicy.NumIdleFrames)
+            continue;
+
+        uint32_t numDescriptors = m_HeapPool[i]->GetMaxDescriptors();
+        if (!overMax && numAvailable - numDescriptors < m_TrimPolicy.NumReserveDescriptors)
+            continue;
+
+        ReleaseHeap(i);
+        --numHeaps;
+        numAvailable -= numDescriptors;
+        ++numReleased;
+        m_TrimStats.NumTrimmedDescriptors += numDescriptors;
+    }
+
+    if (numReleased > 0) {
+        ++m_TrimStats.NumTrimEvents;
+        m_TrimStats.NumTrimmedHeaps += numReleased;
+    }
+
+    return numReleased;
 }
@@ -0,0 +1,87 @@
+#include <UDX12/DescriptorHeap/DescriptorCopyBatch.h>
+
+#include <algorithm>
+
+using namespace Ubpa;
+
+UDX12::DescriptorCopyBatch::DescriptorCopyBatch(ID3D12Device* pDevice, D3D12_DESCRIPTOR_HEAP_TYPE Type) :
+    m_pDevice       { pDevice },
+    m_Type          { Type },
+    m_DescriptorSize{ pDevice->GetDescriptorHandleIncrementSize(Type) }
+{
+}
+
+void UDX12::DescriptorCopyBatch::Add(D3D12_CPU_DESCRIPTOR_HANDLE Dst, D3D12_CPU_DESCRIPTOR_HANDLE Src, uint32_t NumDescriptors) {
+    assert(Dst.ptr != 0 && Src.ptr != 0);
+    if (NumDescriptors == 0)
+        return;
+    m_Copies.push_back({ Dst.ptr, Src.ptr, NumDescriptors });
+}
+
+void UDX12::DescriptorCopyBatch::Add(
+    const DescriptorHeapAllocation& Dst, uint32_t DstOffset,
+    const DescriptorHeapAllocation& Src, uint32_t SrcOffset,
+    uint32_t Count)
+{
+    assert(DstOffset + Count <= Dst.GetNumHandles() && SrcOffset + Count <= Src.GetNumHandles());
+    assert(Dst.GetDescriptorSize() == m_DescriptorSize && Src.GetDescriptorSize() == m_DescriptorSize);
+    if (Count == 0)
+        return;
+    Add(Dst.GetCpuHandle(DstOffset), Src.GetCpuHandle(SrcOffset), Count);
+}
+
+UDX12::DescriptorCopyBatch::FlushStats UDX12::DescriptorCopyBatch::Flush() {
+    FlushStats Stats;
+    if (m_Copies.empty())
+        return Stats;
+
+    std::sort(m_Copies.begin(), m_Copies.end(), [](const Copy& lhs, const Copy& rhs) { return lhs.Dst < rhs.Dst; });
+
+    m_DstStarts.clear();
+    m_DstSizes.clear();
+    m_SrcStarts.clear();
+    m_SrcSizes.clear();
+
+    SIZE_T DstEnd = 0;
+    SIZE_T SrcEnd = 0;
+    for (const auto& copy : m_Copies) {
+        assert((m_DstStarts.empty() || copy.Dst >= DstEnd) && "Destination ranges overlap");
+
+        SIZE_T Size = SIZE_T{ copy.NumDescriptors } * m_DescriptorSize;
+
+        if (!m_DstStarts.empty() && copy.Dst == DstEnd)
+            m_DstSizes.back() += copy.NumDescriptors;
+        else {
+            m_DstStarts.push_back({ copy.Dst });
+            m_DstSizes.push_back(copy.NumDescriptors);
+        }
+        DstEnd = copy.Dst + Size;
+
+        if (!m_SrcStarts.empty() && copy.Src == SrcEnd)
+            m_SrcSizes.back() += copy.NumDescriptors;
+        else {
+            m_SrcStarts.push_back({ copy.Src });
+            m_SrcSizes.push_back(copy.NumDescriptors);
+        }
+        SrcEnd = copy.Src + Size;
+
+        Stats.NumDescriptors += copy.NumDescriptors;
+    }
+
+    Stats.NumCopies    = m_Copies.size();
+    Stats.NumDstRanges = m_DstStarts.size();
+    Stats.NumSrcRanges = m_SrcStarts.size();
+
+    if (Stats.NumDstRanges == 1 && Stats.NumSrcRanges == 1) {
+        m_pDevice->CopyDescriptorsSimple(m_DstSizes[0], m_DstStarts[0], m_SrcStarts[0], m_Type);
+    }
+    else {
+        m_pDevice->CopyDescriptors(
+            static_cast<UINT>(m_DstStarts.size()), m_DstStarts.data(), m_DstSizes.data(),
+            static_cast<UINT>(m_SrcStarts.size()), m_SrcStarts.data(), m_SrcSizes.data(),
+            m_Type);
+    }
+
+    m_Copies.clear();
+    return Stats;
+}
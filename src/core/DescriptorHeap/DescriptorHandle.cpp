@@ -0,0 +1,42 @@
+#include <UDX12/DescriptorHeap/DescriptorHandle.h>
+
+using namespace Ubpa;
+
+UDX12::DescriptorHandle UDX12::DescriptorHandle::Detach(DescriptorHeapAllocation&& Allocation) {
+    DescriptorHandle handle;
+    if (Allocation.IsNull())
+        return handle;
+
+    handle.m_HeapIndex = DescriptorHeapRegistry::Instance().Register(Allocation.GetDescriptorHeap(), Allocation.GetAllocator());
+    const auto& entry = DescriptorHeapRegistry::Instance().Get(handle.m_HeapIndex);
+
+    assert(Allocation.GetCpuHandle().ptr >= entry.FirstCpuHandle.ptr);
+    handle.m_Offset              = static_cast<uint32_t>((Allocation.GetCpuHandle().ptr - entry.FirstCpuHandle.ptr) / entry.DescriptorSize);
+    handle.m_NumHandles          = Allocation.GetNumHandles();
+    handle.m_AllocationManagerId = Allocation.GetAllocationManagerId();
+    handle.m_Flags               = Allocation.IsShaderVisible() ? ShaderVisible : None;
+
+    // The descriptors are owned by the handle now
+    Allocation.Reset();
+
+    return handle;
+}
+
+UDX12::DescriptorHeapAllocation UDX12::DescriptorHandle::Attach() noexcept {
+    if (IsNull())
+        return {};
+
+    const auto& entry = DescriptorHeapRegistry::Instance().Get(m_HeapIndex);
+    DescriptorHeapAllocation allocation{
+        entry.pAllocator,
+        entry.pHeap,
+        GetCpuHandle(),
+        IsShaderVisible() ? GetGpuHandle() : D3D12_GPU_DESCRIPTOR_HANDLE{ 0 },
+        m_NumHandles,
+        m_AllocationManagerId
+    };
+
+    *this = {};
+
+    return allocation;
+}
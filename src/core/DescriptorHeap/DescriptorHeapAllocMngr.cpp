@@ -1,6 +1,9 @@
 #include <UDX12/DescriptorHeap/DescriptorHeapAllocMngr.h>
 
 #include <UDX12/DescriptorHeap/DescriptorHeapAllocation.h>
+#include <UDX12/DescriptorHeap/DescriptorHeapRegistry.h>
+
+#include <bit>
 
 using namespace Ubpa;
 
@@ -17,13 +20,28 @@ UDX12::DescriptorHeapAllocMngr::DescriptorHeapAllocMngr(DescriptorHeapAllocMngr&
     // Mutex is not movable
     //m_FreeBlockManagerMutex   { std::move(rhs.m_FreeBlockManagerMutex) },
     m_FreeBlockManager          { std::move(rhs.m_FreeBlockManager) },
-    m_pd3d12DescriptorHeap      { std::move(rhs.m_pd3d12DescriptorHeap) }
+    m_pd3d12DescriptorHeap      { std::move(rhs.m_pd3d12DescriptorHeap) },
+    m_SlabOffset                { rhs.m_SlabOffset },
+    m_NumSlabDescriptors        { rhs.m_NumSlabDescriptors },
+    m_SlabBitmap                { std::move(rhs.m_SlabBitmap) },
+    // Atomics are not movable
+    m_NumFreeSlabDescriptors    { rhs.m_NumFreeSlabDescriptors.load() },
+    m_SlabWordHint              { rhs.m_SlabWordHint.load() },
+    m_PendingFrees              { std::move(rhs.m_PendingFrees) },
+    m_PendingHead               { rhs.m_PendingHead.load() },
+    m_NumPendingDescriptors     { rhs.m_NumPendingDescriptors.load() }
 {
     rhs.m_NumDescriptorsInAllocation = 0; // Must be set to zero so that debug check in dtor passes
     rhs.m_ThisManagerId = static_cast<size_t>(-1);
     rhs.m_FirstCPUHandle.ptr = 0;
     rhs.m_FirstGPUHandle.ptr = 0;
     rhs.m_MaxAllocatedSize = 0;
+    rhs.m_SlabOffset = 0;
+    rhs.m_NumSlabDescriptors = 0;
+    rhs.m_NumFreeSlabDescriptors = 0;
+    rhs.m_SlabWordHint = 0;
+    rhs.m_PendingHead = InvalidPendingFree;
+    rhs.m_NumPendingDescriptors = 0;
 
 #ifndef NDEBUG
     m_AllocationsCounter.store(rhs.m_AllocationsCounter.load());
@@ -36,7 +54,9 @@ UDX12::DescriptorHeapAllocMngr::DescriptorHeapAllocMngr(
     ID3D12Device*                     pDevice,
     IDescriptorAllocator&             ParentAllocator,
     size_t                            ThisManagerId,
-    const D3D12_DESCRIPTOR_HEAP_DESC& HeapDesc)
+    const D3D12_DESCRIPTOR_HEAP_DESC& HeapDesc,
+    VarSizeAllocMngr::Backend         Backend,
+    uint32_t                          NumSlabDescriptors)
     :
     m_ParentAllocator            {ParentAllocator},
     m_pDevice                    {pDevice        },
@@ -44,7 +64,7 @@ UDX12::DescriptorHeapAllocMngr::DescriptorHeapAllocMngr(
     m_HeapDesc                   {HeapDesc       },
     m_DescriptorSize             {pDevice->GetDescriptorHandleIncrementSize(m_HeapDesc.Type)},
     m_NumDescriptorsInAllocation {HeapDesc.NumDescriptors},
-    m_FreeBlockManager           {HeapDesc.NumDescriptors}
+    m_FreeBlockManager           {HeapDesc.NumDescriptors, Backend}
 {
     m_FirstCPUHandle.ptr = 0;
     m_FirstGPUHandle.ptr = 0;
@@ -57,6 +77,8 @@ UDX12::DescriptorHeapAllocMngr::DescriptorHeapAllocMngr(
     m_FirstCPUHandle = m_pd3d12DescriptorHeap->GetCPUDescriptorHandleForHeapStart();
     if (m_HeapDesc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE)
         m_FirstGPUHandle = m_pd3d12DescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+
+    InitSlab(NumSlabDescriptors);
 }
 
 // Uses subrange of descriptors in the existing D3D12 descriptor heap
@@ -67,7 +89,9 @@ UDX12::DescriptorHeapAllocMngr::DescriptorHeapAllocMngr(
     size_t                ThisManagerId,
     ID3D12DescriptorHeap* pd3d12DescriptorHeap,
     uint32_t              FirstDescriptor,
-    uint32_t              NumDescriptors)
+    uint32_t              NumDescriptors,
+    VarSizeAllocMngr::Backend Backend,
+    uint32_t              NumSlabDescriptors)
     :
     m_ParentAllocator            {ParentAllocator},
     m_pDevice                    {pDevice},
@@ -75,7 +99,7 @@ UDX12::DescriptorHeapAllocMngr::DescriptorHeapAllocMngr(
     m_HeapDesc                   {pd3d12DescriptorHeap->GetDesc()},
     m_DescriptorSize             {pDevice->GetDescriptorHandleIncrementSize(m_HeapDesc.Type)},
     m_NumDescriptorsInAllocation {NumDescriptors},
-    m_FreeBlockManager           {NumDescriptors},
+    m_FreeBlockManager           {NumDescriptors, Backend},
     m_pd3d12DescriptorHeap       {pd3d12DescriptorHeap}
 {
     m_FirstCPUHandle = pd3d12DescriptorHeap->GetCPUDescriptorHandleForHeapStart();
@@ -85,21 +109,109 @@ UDX12::DescriptorHeapAllocMngr::DescriptorHeapAllocMngr(
         m_FirstGPUHandle = pd3d12DescriptorHeap->GetGPUDescriptorHandleForHeapStart();
         m_FirstGPUHandle.ptr += m_DescriptorSize * FirstDescriptor;
     }
+
+    InitSlab(NumSlabDescriptors);
+}
+
+void UDX12::DescriptorHeapAllocMngr::InitSlab(uint32_t NumSlabDescriptors) {
+    NumSlabDescriptors = std::min(NumSlabDescriptors, m_NumDescriptorsInAllocation);
+    if (NumSlabDescriptors == 0)
+        return;
+
+    // The slab range is one allocation of the variable-size manager for the lifetime of this manager
+    auto SlabRange = m_FreeBlockManager.Allocate(NumSlabDescriptors, 1);
+    assert(SlabRange.IsValid() && SlabRange.size == NumSlabDescriptors);
+
+    m_SlabOffset = SlabRange.unalignedOffset;
+    m_NumSlabDescriptors = NumSlabDescriptors;
+
+    //  word 0         word 1               last word
+    // | 0 0 ... 0 0 | 0 0 ... 0 0 | ... | 1 1 1 0 ... 0 |
+    //                                          '- bits past the slab are marked as used
+    uint32_t NumWords = (NumSlabDescriptors + 63) / 64;
+    m_SlabBitmap = std::make_unique<std::atomic_uint64_t[]>(NumWords);
+    for (uint32_t i = 0; i < NumWords; i++)
+        m_SlabBitmap[i].store(0, std::memory_order_relaxed);
+    if (uint32_t NumTailBits = NumSlabDescriptors % 64; NumTailBits != 0)
+        m_SlabBitmap[NumWords - 1].store(~std::uint64_t{ 0 } << NumTailBits, std::memory_order_relaxed);
+
+    m_NumFreeSlabDescriptors.store(NumSlabDescriptors, std::memory_order_relaxed);
+    m_SlabWordHint.store(0, std::memory_order_relaxed);
+}
+
+size_t UDX12::DescriptorHeapAllocMngr::TryAllocateFromSlab() noexcept {
+    if (m_NumFreeSlabDescriptors.load(std::memory_order_relaxed) == 0)
+        return VarSizeAllocMngr::Allocation::InvalidOffset;
+
+    uint32_t NumWords = (m_NumSlabDescriptors + 63) / 64;
+    uint32_t FirstWord = m_SlabWordHint.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < NumWords; i++) {
+        uint32_t WordIdx = FirstWord + i < NumWords ? FirstWord + i : FirstWord + i - NumWords;
+        auto& Word = m_SlabBitmap[WordIdx];
+        auto Bits = Word.load(std::memory_order_relaxed);
+        while (Bits != ~std::uint64_t{ 0 }) {
+            // lowest free descriptor in the word
+            auto Bit = std::countr_zero(~Bits);
+            if (Word.compare_exchange_weak(Bits, Bits | (std::uint64_t{ 1 } << Bit), std::memory_order_acquire, std::memory_order_relaxed)) {
+                m_NumFreeSlabDescriptors.fetch_sub(1, std::memory_order_relaxed);
+                m_SlabWordHint.store(WordIdx, std::memory_order_relaxed);
+                return m_SlabOffset + size_t{ WordIdx } * 64 + static_cast<size_t>(Bit);
+            }
+            // Bits is reloaded by the failed compare_exchange_weak()
+        }
+    }
+
+    return VarSizeAllocMngr::Allocation::InvalidOffset;
+}
+
+void UDX12::DescriptorHeapAllocMngr::FreeToSlab(size_t Offset) noexcept {
+    assert(IsInSlab(Offset));
+    auto Idx = Offset - m_SlabOffset;
+    auto WordIdx = static_cast<uint32_t>(Idx / 64);
+    auto Mask = std::uint64_t{ 1 } << (Idx % 64);
+    [[maybe_unused]] auto PrevBits = m_SlabBitmap[WordIdx].fetch_and(~Mask, std::memory_order_release);
+    assert("Slab descriptor is freed twice" && (PrevBits & Mask) != 0);
+    m_NumFreeSlabDescriptors.fetch_add(1, std::memory_order_relaxed);
+    m_SlabWordHint.store(WordIdx, std::memory_order_relaxed);
 }
 
 
 UDX12::DescriptorHeapAllocMngr::~DescriptorHeapAllocMngr()
 {
+    {
+        std::lock_guard<std::mutex> LockGuard(m_FreeBlockManagerMutex);
+        DrainPendingFrees();
+    }
+
     assert(m_AllocationsCounter == 0 && " allocations have not been released. If these allocations are referenced by release queue, the app will crash when DescriptorHeapAllocationManager::FreeAllocation() is called.");
+
+    if (m_NumSlabDescriptors > 0) {
+        assert("Not all slab descriptors were released" && m_NumFreeSlabDescriptors == m_NumSlabDescriptors);
+        m_FreeBlockManager.Free(m_SlabOffset, m_NumSlabDescriptors);
+    }
+
     assert("Not all descriptors were released" && m_FreeBlockManager.GetFreeSize() == m_NumDescriptorsInAllocation);
+
+    // DescriptorHandle objects may have registered the heap
+    if (m_pd3d12DescriptorHeap)
+        DescriptorHeapRegistry::Instance().Unregister(m_pd3d12DescriptorHeap);
 }
 
 UDX12::DescriptorHeapAllocation UDX12::DescriptorHeapAllocMngr::Allocate(uint32_t Count) {
     assert(Count > 0);
 
+    // Fast path, no lock
+    if (Count == 1 && m_NumSlabDescriptors > 0) {
+        auto Offset = TryAllocateFromSlab();
+        if (Offset != VarSizeAllocMngr::Allocation::InvalidOffset)
+            return MakeAllocation(Offset, 1);
+    }
+
     std::lock_guard<std::mutex> LockGuard(m_FreeBlockManagerMutex);
     // Methods of VariableSizeAllocationsManager class are not thread safe!
 
+    DrainPendingFrees();
+
     // Use variable-size GPU allocations manager to allocate the requested number of descriptors
     auto Allocation = m_FreeBlockManager.Allocate(Count, 1);
     if (!Allocation.IsValid())
@@ -107,16 +219,50 @@ UDX12::DescriptorHeapAllocation UDX12::DescriptorHeapAllocMngr::Allocate(uint32_
 
     assert(Allocation.size == Count);
 
+    m_MaxAllocatedSize = std::max(m_MaxAllocatedSize, m_FreeBlockManager.GetUsedSize());
+
+    return MakeAllocation(Allocation.unalignedOffset, Count);
+}
+
+void UDX12::DescriptorHeapAllocMngr::AllocateBatch(std::span<const uint32_t> Counts, std::span<DescriptorHeapAllocation> Allocations) {
+    assert(Counts.size() == Allocations.size());
+
+    std::lock_guard<std::mutex> LockGuard(m_FreeBlockManagerMutex);
+    // Methods of VariableSizeAllocationsManager class are not thread safe!
+
+    DrainPendingFrees();
+
+    m_BatchRequests.resize(Counts.size());
+    m_BatchAllocations.resize(Counts.size());
+    for (size_t i = 0; i < Counts.size(); i++) {
+        assert(Counts[i] > 0);
+        m_BatchRequests[i] = { Counts[i], 1 };
+    }
+
+    m_FreeBlockManager.AllocateBatch(m_BatchRequests, m_BatchAllocations);
+
+    for (size_t i = 0; i < Counts.size(); i++) {
+        const auto& Allocation = m_BatchAllocations[i];
+        if (!Allocation.IsValid()) {
+            Allocations[i] = {};
+            continue;
+        }
+        assert(Allocation.size == Counts[i]);
+        Allocations[i] = MakeAllocation(Allocation.unalignedOffset, Counts[i]);
+    }
+
+    m_MaxAllocatedSize = std::max(m_MaxAllocatedSize, m_FreeBlockManager.GetUsedSize());
+}
+
+UDX12::DescriptorHeapAllocation UDX12::DescriptorHeapAllocMngr::MakeAllocation(size_t Offset, uint32_t Count) {
     // Compute the first CPU and GPU descriptor handles in the allocation by
     // offseting the first CPU and GPU descriptor handle in the range
     auto CPUHandle = m_FirstCPUHandle;
-    CPUHandle.ptr += Allocation.unalignedOffset * m_DescriptorSize;
+    CPUHandle.ptr += Offset * m_DescriptorSize;
 
     auto GPUHandle = m_FirstGPUHandle; // Will be null if the heap is not GPU-visible
     if (m_HeapDesc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE)
-        GPUHandle.ptr += Allocation.unalignedOffset * m_DescriptorSize;
-
-    m_MaxAllocatedSize = std::max(m_MaxAllocatedSize, m_FreeBlockManager.GetUsedSize());
+        GPUHandle.ptr += Offset * m_DescriptorSize;
 
 #ifndef NDEBUG
     ++m_AllocationsCounter;
@@ -132,15 +278,24 @@ UDX12::DescriptorHeapAllocation UDX12::DescriptorHeapAllocMngr::Allocate(uint32_
 
 void UDX12::DescriptorHeapAllocMngr::FreeAllocation(DescriptorHeapAllocation&& allocation)
 {
-    assert(allocation.GetAllocationManagerId() == m_ThisManagerId && "Invalid descriptor heap manager Id");
-
+    // A null allocation has no manager Id
     if (allocation.IsNull())
         return;
 
-    std::lock_guard<std::mutex> LockGuard(m_FreeBlockManagerMutex);
+    assert(allocation.GetAllocationManagerId() == m_ThisManagerId && "Invalid descriptor heap manager Id");
+
     auto DescriptorOffset = (allocation.GetCpuHandle().ptr - m_FirstCPUHandle.ptr) / m_DescriptorSize;
-    // Methods of VariableSizeAllocationsManager class are not thread safe!
-    m_FreeBlockManager.Free(DescriptorOffset, allocation.GetNumHandles());
+    if (IsInSlab(DescriptorOffset)) {
+        assert(allocation.GetNumHandles() == 1);
+        FreeToSlab(DescriptorOffset);
+    }
+    else if (m_PendingFrees)
+        PushPendingFree(DescriptorOffset, allocation.GetNumHandles());
+    else {
+        std::lock_guard<std::mutex> LockGuard(m_FreeBlockManagerMutex);
+        // Methods of VariableSizeAllocationsManager class are not thread safe!
+        m_FreeBlockManager.Free(DescriptorOffset, allocation.GetNumHandles());
+    }
 
     // Clear the allocation
     allocation.Reset();
@@ -149,3 +304,98 @@ void UDX12::DescriptorHeapAllocMngr::FreeAllocation(DescriptorHeapAllocation&& a
     --m_AllocationsCounter;
 #endif // !NDEBUG
 }
+
+void UDX12::DescriptorHeapAllocMngr::FreeAllocations(std::span<DescriptorHeapAllocation> Allocations)
+{
+    std::lock_guard<std::mutex> LockGuard(m_FreeBlockManagerMutex);
+
+    m_BatchAllocations.clear();
+    TakePendingFrees();
+    for (auto& allocation : Allocations) {
+        // A null allocation has no manager Id
+        if (allocation.IsNull())
+            continue;
+        assert(allocation.GetAllocationManagerId() == m_ThisManagerId && "Invalid descriptor heap manager Id");
+
+        auto DescriptorOffset = (allocation.GetCpuHandle().ptr - m_FirstCPUHandle.ptr) / m_DescriptorSize;
+        if (IsInSlab(DescriptorOffset))
+            FreeToSlab(DescriptorOffset);
+        else
+            m_BatchAllocations.push_back({ DescriptorOffset, allocation.GetNumHandles() });
+
+        // Clear the allocation
+        allocation.Reset();
+
+#ifndef NDEBUG
+        --m_AllocationsCounter;
+#endif // !NDEBUG
+    }
+
+    // Methods of VariableSizeAllocationsManager class are not thread safe!
+    m_FreeBlockManager.FreeBatch(m_BatchAllocations);
+}
+
+void UDX12::DescriptorHeapAllocMngr::EnablePendingFrees() {
+    if (m_PendingFrees)
+        return;
+    m_PendingFrees = std::make_unique<uint64_t[]>(m_NumDescriptorsInAllocation);
+}
+
+void UDX12::DescriptorHeapAllocMngr::PushPendingFree(size_t Offset, uint32_t Count) noexcept {
+    auto Node = static_cast<uint32_t>(Offset);
+    m_NumPendingDescriptors.fetch_add(Count, std::memory_order_relaxed);
+
+    // Only the owner of the range writes its node, the release CAS publishes it to the drain
+    auto Head = m_PendingHead.load(std::memory_order_relaxed);
+    do {
+        m_PendingFrees[Node] = (static_cast<uint64_t>(Head) << 32) | Count;
+    } while (!m_PendingHead.compare_exchange_weak(Head, Node, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void UDX12::DescriptorHeapAllocMngr::TakePendingFrees() {
+    if (m_PendingHead.load(std::memory_order_relaxed) == InvalidPendingFree)
+        return;
+
+    // Nodes pushed after the exchange start a new stack, so there is no ABA problem
+    size_t NumDescriptors = 0;
+    for (auto Node = m_PendingHead.exchange(InvalidPendingFree, std::memory_order_acquire); Node != InvalidPendingFree;) {
+        auto Pending = m_PendingFrees[Node];
+        auto Count = static_cast<uint32_t>(Pending);
+        m_BatchAllocations.push_back({ Node, Count });
+        NumDescriptors += Count;
+        Node = static_cast<uint32_t>(Pending >> 32);
+    }
+    m_NumPendingDescriptors.fetch_sub(NumDescriptors, std::memory_order_relaxed);
+}
+
+void UDX12::DescriptorHeapAllocMngr::DrainPendingFrees() {
+    if (m_PendingHead.load(std::memory_order_relaxed) == InvalidPendingFree)
+        return;
+
+    m_BatchAllocations.clear();
+    TakePendingFrees();
+    m_FreeBlockManager.FreeBatch(m_BatchAllocations);
+}
+
+void UDX12::DescriptorHeapAllocMngr::Flush() {
+    std::lock_guard<std::mutex> LockGuard(m_FreeBlockManagerMutex);
+    DrainPendingFrees();
+}
+
+size_t UDX12::DescriptorHeapAllocMngr::GetMaxAllocatableCount() {
+    std::lock_guard<std::mutex> LockGuard(m_FreeBlockManagerMutex);
+    DrainPendingFrees();
+    return std::max<size_t>(m_FreeBlockManager.GetLargestFreeBlockSize(), m_NumFreeSlabDescriptors.load(std::memory_order_relaxed) > 0 ? 1 : 0);
+}
+
+UDX12::VarSizeAllocMngr::Stats UDX12::DescriptorHeapAllocMngr::GetFreeBlockStats() {
+    std::lock_guard<std::mutex> LockGuard(m_FreeBlockManagerMutex);
+    DrainPendingFrees();
+    return m_FreeBlockManager.GetStats();
+}
+
+std::string UDX12::DescriptorHeapAllocMngr::DumpFreeBlocks(bool json) {
+    std::lock_guard<std::mutex> LockGuard(m_FreeBlockManagerMutex);
+    DrainPendingFrees();
+    return m_FreeBlockManager.DumpFreeBlocks(json);
+}
@@ -0,0 +1,58 @@
+#include <UDX12/DescriptorHeap/DescriptorHeapRegistry.h>
+
+using namespace Ubpa;
+
+UDX12::DescriptorHeapRegistry::DescriptorHeapRegistry() :
+    m_Entries{ std::make_unique<Entry[]>(MaxNumHeaps) }
+{
+}
+
+uint16_t UDX12::DescriptorHeapRegistry::Register(ID3D12DescriptorHeap* pHeap, IDescriptorAllocator* pAllocator) {
+    assert(pHeap != nullptr && pAllocator != nullptr);
+
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+    auto target = m_Heap2Index.find(pHeap);
+    if (target != m_Heap2Index.end()) {
+        assert("The heap is registered with another allocator" && m_Entries[target->second].pAllocator == pAllocator);
+        return target->second;
+    }
+
+    uint16_t Index;
+    if (!m_FreeIndices.empty()) {
+        Index = m_FreeIndices.back();
+        m_FreeIndices.pop_back();
+    }
+    else {
+        assert("Too many registered descriptor heaps" && m_NumUsedIndices < MaxNumHeaps);
+        Index = m_NumUsedIndices++;
+    }
+
+    auto& entry = m_Entries[Index];
+    entry.pHeap          = pHeap;
+    entry.pAllocator     = pAllocator;
+    entry.FirstCpuHandle = pHeap->GetCPUDescriptorHandleForHeapStart();
+    entry.FirstGpuHandle = (pHeap->GetDesc().Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE)
+        ? pHeap->GetGPUDescriptorHandleForHeapStart() : D3D12_GPU_DESCRIPTOR_HANDLE{ 0 };
+    entry.DescriptorSize = pAllocator->GetDescriptorSize();
+
+    m_Heap2Index.emplace(pHeap, Index);
+    return Index;
+}
+
+void UDX12::DescriptorHeapRegistry::Unregister(ID3D12DescriptorHeap* pHeap) {
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+    auto target = m_Heap2Index.find(pHeap);
+    if (target == m_Heap2Index.end())
+        return;
+
+    m_Entries[target->second] = {};
+    m_FreeIndices.push_back(target->second);
+    m_Heap2Index.erase(target);
+}
+
+size_t UDX12::DescriptorHeapRegistry::GetNumHeaps() {
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    return m_Heap2Index.size();
+}
@@ -0,0 +1,21 @@
+#include <UDX12/DescriptorHeap/DescriptorReleaseQueue.h>
+
+using namespace Ubpa;
+
+void UDX12::DescriptorReleaseQueue::SetFenceValue(uint64_t FenceValue) noexcept {
+    assert("Fence values must not decrease" && FenceValue >= m_FenceValue);
+    m_FenceValue = FenceValue;
+}
+
+void UDX12::DescriptorReleaseQueue::Push(DescriptorHeapAllocation&& Allocation) {
+    if (Allocation.IsNull())
+        return;
+
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    m_Queue.push_back({ m_FenceValue.load(), std::move(Allocation) });
+}
+
+size_t UDX12::DescriptorReleaseQueue::GetSize() {
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    return m_Queue.size();
+}
@@ -0,0 +1,101 @@
+#include <UDX12/DescriptorHeap/DescriptorRingAllocMngr.h>
+
+#include <algorithm>
+
+using namespace Ubpa;
+
+UDX12::DescriptorRingAllocMngr::DescriptorRingAllocMngr(
+    ID3D12Device*         pDevice,
+    IDescriptorAllocator& ParentAllocator,
+    size_t                ThisManagerId,
+    ID3D12DescriptorHeap* pd3d12DescriptorHeap,
+    uint32_t              FirstDescriptor,
+    uint32_t              NumDescriptors)
+    :
+    m_ParentAllocator     {ParentAllocator},
+    m_ThisManagerId       {ThisManagerId},
+    m_DescriptorSize      {pDevice->GetDescriptorHandleIncrementSize(pd3d12DescriptorHeap->GetDesc().Type)},
+    m_ShaderVisible       {(pd3d12DescriptorHeap->GetDesc().Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE) != 0},
+    m_NumDescriptors      {NumDescriptors},
+    m_pd3d12DescriptorHeap{pd3d12DescriptorHeap}
+{
+    assert(m_ThisManagerId < std::numeric_limits<uint16_t>::max() && "ManagerID exceeds 16-bit range");
+
+    m_FirstCPUHandle = pd3d12DescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+    m_FirstCPUHandle.ptr += m_DescriptorSize * FirstDescriptor;
+
+    if (m_ShaderVisible) {
+        m_FirstGPUHandle = pd3d12DescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+        m_FirstGPUHandle.ptr += m_DescriptorSize * FirstDescriptor;
+    }
+}
+
+UDX12::DescriptorHeapAllocation UDX12::DescriptorRingAllocMngr::Allocate(uint32_t Count) {
+    assert(Count > 0);
+    if (Count > m_NumDescriptors)
+        return {};
+
+    uint64_t Head = m_Head.load(std::memory_order_relaxed);
+    uint64_t Begin;
+    for (;;) {
+        // Skip the rest of the range if the allocation does not fit before the end,
+        // the allocation then starts at the beginning of the next lap
+        uint64_t Offset = Head % m_NumDescriptors;
+        Begin = Offset + Count <= m_NumDescriptors ? Head : Head + (m_NumDescriptors - Offset);
+        uint64_t End = Begin + Count;
+
+        // m_Tail only moves forward, so a stale value can only reject an allocation that would fit
+        if (End - m_Tail.load(std::memory_order_acquire) > m_NumDescriptors)
+            return {};
+
+        if (m_Head.compare_exchange_weak(Head, End, std::memory_order_relaxed, std::memory_order_relaxed))
+            break;
+    }
+
+    uint64_t Offset = Begin % m_NumDescriptors;
+
+    auto CPUHandle = m_FirstCPUHandle;
+    CPUHandle.ptr += Offset * m_DescriptorSize;
+
+    auto GPUHandle = m_FirstGPUHandle; // Will be null if the heap is not GPU-visible
+    if (m_ShaderVisible)
+        GPUHandle.ptr += Offset * m_DescriptorSize;
+
+    return {
+        &m_ParentAllocator, m_pd3d12DescriptorHeap,
+        CPUHandle, GPUHandle, Count,
+        static_cast<uint16_t>(m_ThisManagerId)
+    };
+}
+
+void UDX12::DescriptorRingAllocMngr::BeginFrame(uint64_t FenceValue) {
+    std::lock_guard<std::mutex> LockGuard(m_FrameMutex);
+
+    // Before the first call, the open frame has no fence value yet. Closing it with 0 would release
+    // its allocations at the first ReleaseCompletedFrames(), so it stays open and takes FenceValue
+    uint64_t Head = m_Head.load(std::memory_order_relaxed);
+    uint64_t LastHead = m_ClosedFrames.empty() ? m_Tail.load(std::memory_order_relaxed) : m_ClosedFrames.back().Head;
+    if (m_FrameBegun && Head != LastHead)
+        m_ClosedFrames.push_back({ m_FrameFenceValue, Head });
+    assert((!m_FrameBegun || FenceValue >= m_FrameFenceValue) && "fence values must not decrease");
+    m_FrameBegun = true;
+    m_FrameFenceValue = FenceValue;
+
+    m_MaxUsedSize = std::max(m_MaxUsedSize, GetUsedSize());
+}
+
+void UDX12::DescriptorRingAllocMngr::ReleaseCompletedFrames(uint64_t CompletedFenceValue) {
+    std::lock_guard<std::mutex> LockGuard(m_FrameMutex);
+
+    if (m_ClosedFrames.empty() || m_ClosedFrames.front().FenceValue > CompletedFenceValue)
+        return;
+
+    uint64_t Tail;
+    do {
+        Tail = m_ClosedFrames.front().Head;
+        m_ClosedFrames.pop_front();
+    } while (!m_ClosedFrames.empty() && m_ClosedFrames.front().FenceValue <= CompletedFenceValue);
+
+    // Descriptors before the new tail may be reused by Allocate() from now on
+    m_Tail.store(Tail, std::memory_order_release);
+}
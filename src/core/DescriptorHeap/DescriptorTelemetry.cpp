@@ -0,0 +1,55 @@
+#include <UDX12/DescriptorHeap/DescriptorTelemetry.h>
+
+#include <algorithm>
+
+using namespace Ubpa;
+
+void UDX12::DescriptorTelemetry::UpdateMax(std::atomic_uint64_t& Max, uint64_t Value) noexcept {
+    auto Current = Max.load(std::memory_order_relaxed);
+    while (Value > Current && !Max.compare_exchange_weak(Current, Value, std::memory_order_relaxed))
+        ;
+}
+
+void UDX12::DescriptorTelemetry::OnAllocate(uint32_t Count) noexcept {
+    m_NumAllocations.fetch_add(1, std::memory_order_relaxed);
+    auto InUse = m_NumDescriptorsInUse.fetch_add(Count, std::memory_order_relaxed) + Count;
+    if (InUse > 0) {
+        UpdateMax(m_FramePeakDescriptorsInUse, static_cast<uint64_t>(InUse));
+        UpdateMax(m_PeakDescriptorsInUse, static_cast<uint64_t>(InUse));
+    }
+}
+
+void UDX12::DescriptorTelemetry::OnFree(uint32_t Count, uint32_t NumAllocations) noexcept {
+    m_NumFrees.fetch_add(NumAllocations, std::memory_order_relaxed);
+    m_NumDescriptorsInUse.fetch_sub(Count, std::memory_order_relaxed);
+}
+
+UDX12::DescriptorTelemetry::Snapshot UDX12::DescriptorTelemetry::GetSnapshot() const noexcept {
+    Snapshot snapshot;
+    snapshot.NumAllocations            = m_NumAllocations.load(std::memory_order_relaxed);
+    snapshot.NumFrees                  = m_NumFrees.load(std::memory_order_relaxed);
+    snapshot.NumFailedAllocations      = m_NumFailedAllocations.load(std::memory_order_relaxed);
+    snapshot.LockHeldNanoseconds       = m_LockHeldNanoseconds.load(std::memory_order_relaxed);
+    snapshot.FramePeakDescriptorsInUse = m_FramePeakDescriptorsInUse.load(std::memory_order_relaxed);
+    snapshot.NumDescriptorsInUse       = static_cast<uint64_t>(std::max<int64_t>(m_NumDescriptorsInUse.load(std::memory_order_relaxed), 0));
+    snapshot.NumBytesInUse             = snapshot.NumDescriptorsInUse * m_DescriptorSize;
+    snapshot.PeakDescriptorsInUse      = m_PeakDescriptorsInUse.load(std::memory_order_relaxed);
+    snapshot.FrameIndex                = m_FrameIndex.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+UDX12::DescriptorTelemetry::Snapshot UDX12::DescriptorTelemetry::EndFrame() noexcept {
+    Snapshot snapshot;
+    snapshot.NumAllocations            = m_NumAllocations.exchange(0, std::memory_order_relaxed);
+    snapshot.NumFrees                  = m_NumFrees.exchange(0, std::memory_order_relaxed);
+    snapshot.NumFailedAllocations      = m_NumFailedAllocations.exchange(0, std::memory_order_relaxed);
+    snapshot.LockHeldNanoseconds       = m_LockHeldNanoseconds.exchange(0, std::memory_order_relaxed);
+    snapshot.NumDescriptorsInUse       = static_cast<uint64_t>(std::max<int64_t>(m_NumDescriptorsInUse.load(std::memory_order_relaxed), 0));
+    // The next frame starts at the current usage
+    snapshot.FramePeakDescriptorsInUse = std::max(m_FramePeakDescriptorsInUse.exchange(snapshot.NumDescriptorsInUse, std::memory_order_relaxed),
+                                                  snapshot.NumDescriptorsInUse);
+    snapshot.NumBytesInUse             = snapshot.NumDescriptorsInUse * m_DescriptorSize;
+    snapshot.PeakDescriptorsInUse      = m_PeakDescriptorsInUse.load(std::memory_order_relaxed);
+    snapshot.FrameIndex                = m_FrameIndex.fetch_add(1, std::memory_order_relaxed);
+    return snapshot;
+}
@@ -9,7 +9,8 @@ UDX12::DynamicSuballocMngr::DynamicSuballocMngr(
     noexcept :
     m_ParentGPUHeap   { ParentGPUHeap },
     m_DynamicChunkSize{ DynamicChunkSize },
-    m_ManagerName     { std::move(ManagerName) }
+    m_ManagerName     { std::move(ManagerName) },
+    m_Telemetry       { ParentGPUHeap->GetDescriptorSize() }
 {
     assert(ParentGPUHeap != nullptr);
 }
@@ -21,10 +22,13 @@ UDX12::DynamicSuballocMngr::~DynamicSuballocMngr() {
 void UDX12::DynamicSuballocMngr::ReleaseAllocations() {
     // Clear the list and dispose all allocated chunks of GPU descriptor heap.
     // The chunks will be added to release queues and eventually returned to the
-    // parent GPU heap.
-    for (auto& Allocation : m_Suballocations)
-        m_ParentGPUHeap->Free(std::move(Allocation));
+    // parent GPU heap. The chunks are freed as one batch, so adjacent chunks
+    // are merged before they reach the free block manager.
+    m_ParentGPUHeap->FreeBatch(m_Suballocations);
     m_Suballocations.clear();
+    if (m_CurrAllocationCount > 0)
+        m_Telemetry.OnFree(m_CurrDescriptorCount, m_CurrAllocationCount);
+    m_CurrAllocationCount = 0;
     m_CurrDescriptorCount = 0;
     m_CurrSuballocationsTotalSize = 0;
 }
@@ -40,8 +44,10 @@ UDX12::DescriptorHeapAllocation UDX12::DynamicSuballocMngr::Allocate(uint32_t Co
         // Request a new chunk from the parent GPU descriptor heap
         auto suballocationSize = std::max(m_DynamicChunkSize, Count);
         auto NewDynamicSubAllocation = m_ParentGPUHeap->AllocateDynamic(suballocationSize);
-        if (NewDynamicSubAllocation.IsNull())
+        if (NewDynamicSubAllocation.IsNull()) {
+            m_Telemetry.OnFailedAllocation();
             return {};
+        }
         m_Suballocations.emplace_back(std::move(NewDynamicSubAllocation));
         m_CurrentSuballocationOffset = 0;
 
@@ -65,6 +71,8 @@ UDX12::DescriptorHeapAllocation UDX12::DynamicSuballocMngr::Allocate(uint32_t Co
     m_CurrentSuballocationOffset += Count;
     m_CurrDescriptorCount += Count;
     m_PeakDescriptorCount = std::max(m_PeakDescriptorCount, m_CurrDescriptorCount);
+    ++m_CurrAllocationCount;
+    m_Telemetry.OnAllocate(Count);
 
     return allocation;
 }
\ No newline at end of file
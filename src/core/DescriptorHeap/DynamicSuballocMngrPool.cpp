@@ -0,0 +1,80 @@
+#include <UDX12/DescriptorHeap/DynamicSuballocMngrPool.h>
+
+#include <atomic>
+#include <algorithm>
+#include <string>
+
+using namespace Ubpa;
+
+namespace Ubpa::UDX12::details {
+    static std::atomic_uint64_t NextDynamicSuballocMngrPoolId{ 1 };
+
+    struct ThreadMngrCache {
+        uint64_t             PoolId{ 0 };
+        DynamicSuballocMngr* Mngr{ nullptr };
+    };
+    static thread_local ThreadMngrCache LastThreadMngr;
+}
+
+UDX12::DynamicSuballocMngrPool::DynamicSuballocMngrPool(
+    GPUDescriptorHeap* ParentGPUHeap,
+    uint32_t           DynamicChunkSize,
+    std::string        PoolName)
+    :
+    m_ParentGPUHeap   { ParentGPUHeap },
+    m_DynamicChunkSize{ DynamicChunkSize },
+    m_PoolName        { std::move(PoolName) },
+    m_PoolId          { details::NextDynamicSuballocMngrPoolId.fetch_add(1, std::memory_order_relaxed) }
+{
+    assert(ParentGPUHeap != nullptr);
+}
+
+UDX12::DynamicSuballocMngrPool::~DynamicSuballocMngrPool() {
+    ReleaseAllocations();
+}
+
+UDX12::DynamicSuballocMngr& UDX12::DynamicSuballocMngrPool::GetThreadMngr() {
+    auto& Cache = details::LastThreadMngr;
+    if (Cache.PoolId == m_PoolId)
+        return *Cache.Mngr;
+
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    auto& Mngr = m_ThreadMngrs[std::this_thread::get_id()];
+    if (!Mngr) {
+        Mngr = std::make_unique<DynamicSuballocMngr>(
+            m_ParentGPUHeap, m_DynamicChunkSize, m_PoolName + " thread " + std::to_string(m_ThreadMngrs.size() - 1));
+    }
+    Cache = { m_PoolId, Mngr.get() };
+    return *Mngr;
+}
+
+void UDX12::DynamicSuballocMngrPool::ReleaseAllocations() {
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+    // The counts only grow within a frame, so the sum before the release is the peak of the frame
+    uint32_t DescriptorCount         = 0;
+    uint32_t SuballocationsTotalSize = 0;
+    for (const auto& [id, Mngr] : m_ThreadMngrs) {
+        DescriptorCount         += Mngr->GetCurrDescriptorCount();
+        SuballocationsTotalSize += Mngr->GetCurrSuballocationsTotalSize();
+        Mngr->ReleaseAllocations();
+    }
+    m_PeakDescriptorCount         = std::max(m_PeakDescriptorCount, DescriptorCount);
+    m_PeakSuballocationsTotalSize = std::max(m_PeakSuballocationsTotalSize, SuballocationsTotalSize);
+}
+
+UDX12::DynamicSuballocMngrPool::Stats UDX12::DynamicSuballocMngrPool::GetStats() {
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+    Stats Rst{ m_ThreadMngrs.size(), 0, 0, 0, 0 };
+    // Include the current frame
+    for (const auto& [id, Mngr] : m_ThreadMngrs) {
+        Rst.PeakDescriptorCount                 += Mngr->GetCurrDescriptorCount();
+        Rst.PeakSuballocationsTotalSize         += Mngr->GetCurrSuballocationsTotalSize();
+        Rst.MaxThreadPeakDescriptorCount         = std::max(Rst.MaxThreadPeakDescriptorCount, Mngr->GetPeakDescriptorCount());
+        Rst.MaxThreadPeakSuballocationsTotalSize = std::max(Rst.MaxThreadPeakSuballocationsTotalSize, Mngr->GetPeakSuballocationsTotalSize());
+    }
+    Rst.PeakDescriptorCount         = std::max(Rst.PeakDescriptorCount, m_PeakDescriptorCount);
+    Rst.PeakSuballocationsTotalSize = std::max(Rst.PeakSuballocationsTotalSize, m_PeakSuballocationsTotalSize);
+    return Rst;
+}
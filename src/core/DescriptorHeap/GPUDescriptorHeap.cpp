@@ -1,5 +1,8 @@
 #include <UDX12/DescriptorHeap/GPUDescriptorHeap.h>
 
+#include <algorithm>
+#include <limits>
+
 using namespace Ubpa;
 
 UDX12::GPUDescriptorHeap::GPUDescriptorHeap(
@@ -7,7 +10,11 @@ UDX12::GPUDescriptorHeap::GPUDescriptorHeap(
     uint32_t                    NumDescriptorsInHeap,
     uint32_t                    NumDynamicDescriptors,
     D3D12_DESCRIPTOR_HEAP_TYPE  Type,
-    D3D12_DESCRIPTOR_HEAP_FLAGS Flags)
+    D3D12_DESCRIPTOR_HEAP_FLAGS Flags,
+    VarSizeAllocMngr::Backend   Backend,
+    DynamicBackend              DynBackend,
+    UINT                        NodeMask,
+    bool                        PendingFrees)
     :
     m_Device{device},
     m_HeapDesc
@@ -15,7 +22,7 @@ UDX12::GPUDescriptorHeap::GPUDescriptorHeap(
         Type,
         NumDescriptorsInHeap + NumDynamicDescriptors,
         Flags,
-        1 // UINT NodeMask;
+        NodeMask
     },
     m_pd3d12DescriptorHeap
     {
@@ -27,12 +34,59 @@ UDX12::GPUDescriptorHeap::GPUDescriptorHeap(
         }()
     },
     m_DescriptorSize           {device->GetDescriptorHandleIncrementSize(Type)},
-    m_HeapAllocationManager    {device, *this, StaticHeapAllocatonManagerID, m_pd3d12DescriptorHeap, 0, NumDescriptorsInHeap},
-    m_DynamicAllocationsManager{device, *this, DynamicHeapAllocatonManagerID, m_pd3d12DescriptorHeap, NumDescriptorsInHeap, NumDynamicDescriptors}
+    m_HeapAllocationManager    {device, *this, StaticHeapAllocatonManagerID, m_pd3d12DescriptorHeap, 0, NumDescriptorsInHeap, Backend},
+    m_DynamicAllocationsManager{device, *this, DynamicHeapAllocatonManagerID, m_pd3d12DescriptorHeap, NumDescriptorsInHeap,
+                                DynBackend == DynamicBackend::Ring ? 0 : NumDynamicDescriptors, Backend},
+    m_Telemetry                {device->GetDescriptorHandleIncrementSize(Type)}
 {
+    if (PendingFrees)
+        m_HeapAllocationManager.EnablePendingFrees();
+
+    if (DynBackend == DynamicBackend::Ring) {
+        m_DynamicRing = std::make_unique<DescriptorRingAllocMngr>(
+            device, *this, DynamicRingAllocatonManagerID, m_pd3d12DescriptorHeap, NumDescriptorsInHeap, NumDynamicDescriptors);
+    }
+}
+
+UDX12::GPUDescriptorHeap::~GPUDescriptorHeap() {
+    // The GPU must be idle at this point
+    ReleaseStaleAllocations(std::numeric_limits<uint64_t>::max());
+}
+
+UDX12::DescriptorHeapAllocation UDX12::GPUDescriptorHeap::Allocate(uint32_t count) {
+    auto allocation = m_HeapAllocationManager.Allocate(count);
+    if (allocation.IsNull())
+        m_Telemetry.OnFailedAllocation();
+    else
+        m_Telemetry.OnAllocate(count);
+    return allocation;
+}
+
+UDX12::DescriptorHeapAllocation UDX12::GPUDescriptorHeap::AllocateDynamic(uint32_t count) {
+    auto allocation = m_DynamicRing ? m_DynamicRing->Allocate(count) : m_DynamicAllocationsManager.Allocate(count);
+    if (allocation.IsNull())
+        m_Telemetry.OnFailedAllocation();
+    else
+        m_Telemetry.OnAllocate(count);
+    return allocation;
 }
 
 void UDX12::GPUDescriptorHeap::Free(DescriptorHeapAllocation&& allocation) {
+    if (allocation.IsNull())
+        return;
+    m_Telemetry.OnFree(allocation.GetNumHandles());
+
+    // Ring allocations are released with their frame
+    if (allocation.GetAllocationManagerId() == DynamicRingAllocatonManagerID) {
+        allocation.Reset();
+        return;
+    }
+
+    if (m_DeferredRelease) {
+        m_ReleaseQueue.Push(std::move(allocation));
+        return;
+    }
+
     auto MgrId = allocation.GetAllocationManagerId();
     assert((MgrId == StaticHeapAllocatonManagerID || MgrId == DynamicHeapAllocatonManagerID)
         && "Unexpected allocation manager ID");
@@ -42,3 +96,73 @@ void UDX12::GPUDescriptorHeap::Free(DescriptorHeapAllocation&& allocation) {
     else // MgrId == DynamicHeapAllocatonManagerID
         m_DynamicAllocationsManager.FreeAllocation(std::move(allocation));
 }
+
+void UDX12::GPUDescriptorHeap::FreeBatch(std::span<DescriptorHeapAllocation> Allocations) {
+    uint32_t NumAllocations = 0;
+    uint32_t NumDescriptors = 0;
+    for (const auto& allocation : Allocations) {
+        if (allocation.IsNull())
+            continue;
+        ++NumAllocations;
+        NumDescriptors += allocation.GetNumHandles();
+    }
+    if (NumAllocations > 0)
+        m_Telemetry.OnFree(NumDescriptors, NumAllocations);
+
+    if (m_DeferredRelease) {
+        for (auto& allocation : Allocations) {
+            if (allocation.IsNull())
+                continue;
+            if (allocation.GetAllocationManagerId() == DynamicRingAllocatonManagerID)
+                allocation.Reset();
+            else
+                m_ReleaseQueue.Push(std::move(allocation));
+        }
+        return;
+    }
+
+    FreeBatchNow(Allocations);
+}
+
+void UDX12::GPUDescriptorHeap::SetFrameFenceValue(uint64_t FenceValue) {
+    m_ReleaseQueue.SetFenceValue(FenceValue);
+    if (m_DynamicRing)
+        m_DynamicRing->BeginFrame(FenceValue);
+}
+
+void UDX12::GPUDescriptorHeap::ReleaseStaleAllocations(uint64_t CompletedFenceValue) {
+    m_ReleaseQueue.Release(CompletedFenceValue, [this](std::span<DescriptorHeapAllocation> Allocations) {
+        FreeBatchNow(Allocations);
+    });
+    if (m_DynamicRing)
+        m_DynamicRing->ReleaseCompletedFrames(CompletedFenceValue);
+}
+
+void UDX12::GPUDescriptorHeap::FreeBatchNow(std::span<DescriptorHeapAllocation> Allocations) {
+    // Null allocations have no manager Id, they are moved to the end and left alone
+    auto NullBegin = std::partition(Allocations.begin(), Allocations.end(), [](const DescriptorHeapAllocation& allocation) {
+        return !allocation.IsNull();
+    });
+    Allocations = Allocations.first(static_cast<size_t>(NullBegin - Allocations.begin()));
+
+    // [static allocations | dynamic allocations | ring allocations]
+    auto DynamicBegin = std::partition(Allocations.begin(), Allocations.end(), [](const DescriptorHeapAllocation& allocation) {
+        auto MgrId = allocation.GetAllocationManagerId();
+        assert((MgrId == StaticHeapAllocatonManagerID || MgrId == DynamicHeapAllocatonManagerID || MgrId == DynamicRingAllocatonManagerID)
+            && "Unexpected allocation manager ID");
+        return MgrId == StaticHeapAllocatonManagerID;
+    });
+    auto RingBegin = std::partition(DynamicBegin, Allocations.end(), [](const DescriptorHeapAllocation& allocation) {
+        return allocation.GetAllocationManagerId() == DynamicHeapAllocatonManagerID;
+    });
+
+    size_t NumStatic  = static_cast<size_t>(DynamicBegin - Allocations.begin());
+    size_t NumDynamic = static_cast<size_t>(RingBegin - DynamicBegin);
+    if (NumStatic > 0)
+        m_HeapAllocationManager.FreeAllocations(Allocations.first(NumStatic));
+    if (NumDynamic > 0)
+        m_DynamicAllocationsManager.FreeAllocations(Allocations.subspan(NumStatic, NumDynamic));
+    // Ring allocations are released with their frame
+    for (auto& allocation : Allocations.subspan(NumStatic + NumDynamic))
+        allocation.Reset();
+}
@@ -0,0 +1,115 @@
+#include <UDX12/DescriptorHeap/SamplerCache.h>
+
+#include <UDX12/DescriptorHeap/CPUDescriptorHeap.h>
+#include <UDX12/DescriptorHeap/GPUDescriptorHeap.h>
+
+#include <bit>
+#include <cstdint>
+
+using namespace Ubpa;
+
+// -0.0f and +0.0f are the same sampler, so both compare and hash as +0.0f
+static uint32_t FloatBits(float Value) noexcept {
+    return std::bit_cast<uint32_t>(Value == 0.0f ? 0.0f : Value);
+}
+
+static void HashCombine(size_t& Seed, uint32_t Value) noexcept {
+    Seed ^= std::hash<uint32_t>{}(Value) + 0x9e3779b9 + (Seed << 6) + (Seed >> 2);
+}
+
+bool UDX12::SamplerCache::DescEqual::operator()(const D3D12_SAMPLER_DESC& lhs, const D3D12_SAMPLER_DESC& rhs) const noexcept {
+    return lhs.Filter         == rhs.Filter
+        && lhs.AddressU       == rhs.AddressU
+        && lhs.AddressV       == rhs.AddressV
+        && lhs.AddressW       == rhs.AddressW
+        && FloatBits(lhs.MipLODBias) == FloatBits(rhs.MipLODBias)
+        && lhs.MaxAnisotropy  == rhs.MaxAnisotropy
+        && lhs.ComparisonFunc == rhs.ComparisonFunc
+        && FloatBits(lhs.BorderColor[0]) == FloatBits(rhs.BorderColor[0])
+        && FloatBits(lhs.BorderColor[1]) == FloatBits(rhs.BorderColor[1])
+        && FloatBits(lhs.BorderColor[2]) == FloatBits(rhs.BorderColor[2])
+        && FloatBits(lhs.BorderColor[3]) == FloatBits(rhs.BorderColor[3])
+        && FloatBits(lhs.MinLOD) == FloatBits(rhs.MinLOD)
+        && FloatBits(lhs.MaxLOD) == FloatBits(rhs.MaxLOD);
+}
+
+size_t UDX12::SamplerCache::DescHasher::operator()(const D3D12_SAMPLER_DESC& Desc) const noexcept {
+    size_t Seed = 0;
+    HashCombine(Seed, static_cast<uint32_t>(Desc.Filter));
+    HashCombine(Seed, static_cast<uint32_t>(Desc.AddressU));
+    HashCombine(Seed, static_cast<uint32_t>(Desc.AddressV));
+    HashCombine(Seed, static_cast<uint32_t>(Desc.AddressW));
+    HashCombine(Seed, FloatBits(Desc.MipLODBias));
+    HashCombine(Seed, Desc.MaxAnisotropy);
+    HashCombine(Seed, static_cast<uint32_t>(Desc.ComparisonFunc));
+    for (float Channel : Desc.BorderColor)
+        HashCombine(Seed, FloatBits(Channel));
+    HashCombine(Seed, FloatBits(Desc.MinLOD));
+    HashCombine(Seed, FloatBits(Desc.MaxLOD));
+    return Seed;
+}
+
+UDX12::SamplerCache::SamplerCache(
+    ID3D12Device*      pDevice,
+    CPUDescriptorHeap& CpuHeap,
+    GPUDescriptorHeap& GpuHeap,
+    size_t             Capacity)
+    :
+    m_pDevice{ pDevice },
+    m_CpuHeap{ CpuHeap },
+    m_GpuHeap{ GpuHeap },
+    m_Capacity{ Capacity }
+{
+    assert(m_GpuHeap.GetHeapDesc().Type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+    assert(m_Capacity <= D3D12_MAX_SHADER_VISIBLE_SAMPLER_HEAP_SIZE);
+}
+
+UDX12::SamplerCache::~SamplerCache() {
+    Clear();
+}
+
+UDX12::SamplerCache::Sampler UDX12::SamplerCache::GetOrCreate(const D3D12_SAMPLER_DESC& Desc) {
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+
+    auto target = m_Samplers.find(Desc);
+    if (target != m_Samplers.end()) {
+        ++m_Stats.NumHits;
+        return { target->second.CpuAllocation.GetCpuHandle(), target->second.GpuAllocation.GetGpuHandle() };
+    }
+
+    if (m_Samplers.size() >= m_Capacity) {
+        ++m_Stats.NumRejected;
+        return {};
+    }
+
+    Entry entry;
+    entry.CpuAllocation = m_CpuHeap.Allocate(1);
+    entry.GpuAllocation = m_GpuHeap.Allocate(1);
+    if (entry.CpuAllocation.IsNull() || entry.GpuAllocation.IsNull()) {
+        // The static part of the sampler heap is smaller than the capacity
+        ++m_Stats.NumRejected;
+        return {};
+    }
+
+    m_pDevice->CreateSampler(&Desc, entry.CpuAllocation.GetCpuHandle());
+    m_pDevice->CopyDescriptorsSimple(1, entry.GpuAllocation.GetCpuHandle(), entry.CpuAllocation.GetCpuHandle(),
+        D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+    ++m_Stats.NumMisses;
+
+    Sampler sampler{ entry.CpuAllocation.GetCpuHandle(), entry.GpuAllocation.GetGpuHandle() };
+    m_Samplers.emplace(Desc, std::move(entry));
+    m_Stats.NumSamplers = m_Samplers.size();
+    return sampler;
+}
+
+void UDX12::SamplerCache::Clear() {
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    // The allocations are freed by their destructors
+    m_Samplers.clear();
+    m_Stats.NumSamplers = 0;
+}
+
+UDX12::SamplerCache::Stats UDX12::SamplerCache::GetStats() {
+    std::lock_guard<std::mutex> LockGuard(m_Mutex);
+    return m_Stats;
+}
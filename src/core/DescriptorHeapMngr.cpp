@@ -2,56 +2,207 @@
 
 using namespace Ubpa;
 
+namespace Ubpa::UDX12::details {
+	struct DescriptorHeapMngrInstances {
+		std::mutex mutex;
+		// key : (nodeMask << 32) | domain
+		std::map<uint64_t, std::unique_ptr<DescriptorHeapMngr>> mngrs;
+	};
+
+	static DescriptorHeapMngrInstances& GetDescriptorHeapMngrInstances() {
+		static DescriptorHeapMngrInstances instances;
+		return instances;
+	}
+}
+
+UDX12::DescriptorHeapMngr& UDX12::DescriptorHeapMngr::Instance(UINT nodeMask, uint32_t domain) {
+	if (nodeMask == 1 && domain == 0)
+		return Instance();
+
+	auto& instances = details::GetDescriptorHeapMngrInstances();
+	std::lock_guard<std::mutex> lockGuard(instances.mutex);
+	auto& mngr = instances.mngrs[(static_cast<uint64_t>(nodeMask) << 32) | domain];
+	if (!mngr)
+		mngr = std::make_unique<DescriptorHeapMngr>();
+	return *mngr;
+}
+
+void UDX12::DescriptorHeapMngr::DestroyInstances() {
+	auto& instances = details::GetDescriptorHeapMngrInstances();
+	std::lock_guard<std::mutex> lockGuard(instances.mutex);
+	instances.mngrs.clear();
+}
+
 void UDX12::DescriptorHeapMngr::Init(
 	ID3D12Device* device,
 	uint32_t numCpuCSU,
 	uint32_t numCpuRTV,
 	uint32_t numCpuDSV,
 	uint32_t numGpuCSU_static,
-	uint32_t numGpuCSU_dynamic
+	uint32_t numGpuCSU_dynamic,
+	bool dynamicRing,
+	UINT nodeMask,
+	uint32_t numSamplers,
+	bool pendingFrees
 ) {
 	assert(!isInit);
+	assert("The node mask must have a single bit of an existing node" &&
+		nodeMask != 0 && (nodeMask & (nodeMask - 1)) == 0 && (nodeMask >> device->GetNodeCount()) == 0);
+
+	this->nodeMask = nodeMask;
 
 	CSU_CpuDH = new CPUDescriptorHeap{
 		device,
 		numCpuCSU,
 		D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
-		D3D12_DESCRIPTOR_HEAP_FLAG_NONE };
+		D3D12_DESCRIPTOR_HEAP_FLAG_NONE,
+		VarSizeAllocMngr::Backend::Tree,
+		0, // CacheSize
+		0, // NumSlabDescriptors
+		nodeMask };
 
 	RTV_CpuDH = new CPUDescriptorHeap{
 		device,
 		numCpuRTV,
 		D3D12_DESCRIPTOR_HEAP_TYPE_RTV,
-		D3D12_DESCRIPTOR_HEAP_FLAG_NONE };
+		D3D12_DESCRIPTOR_HEAP_FLAG_NONE,
+		VarSizeAllocMngr::Backend::Tree,
+		0, // CacheSize
+		0, // NumSlabDescriptors
+		nodeMask };
 
 	DSV_CpuDH = new CPUDescriptorHeap{
 		device,
 		numCpuDSV,
 		D3D12_DESCRIPTOR_HEAP_TYPE_DSV,
-		D3D12_DESCRIPTOR_HEAP_FLAG_NONE };
+		D3D12_DESCRIPTOR_HEAP_FLAG_NONE,
+		VarSizeAllocMngr::Backend::Tree,
+		0, // CacheSize
+		0, // NumSlabDescriptors
+		nodeMask };
 
 	CSU_GpuDH = new GPUDescriptorHeap{
 		device,
 		numGpuCSU_static,
 		numGpuCSU_dynamic,
 		D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
-		D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE };
+		D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE,
+		VarSizeAllocMngr::Backend::Tree,
+		dynamicRing ? GPUDescriptorHeap::DynamicBackend::Ring : GPUDescriptorHeap::DynamicBackend::AllocMngr,
+		nodeMask,
+		pendingFrees };
+
+	Sampler_CpuDH = new CPUDescriptorHeap{
+		device,
+		numSamplers,
+		D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER,
+		D3D12_DESCRIPTOR_HEAP_FLAG_NONE,
+		VarSizeAllocMngr::Backend::Tree,
+		0, // CacheSize
+		0, // NumSlabDescriptors
+		nodeMask };
+
+	// Samplers have no dynamic part
+	Sampler_GpuDH = new GPUDescriptorHeap{
+		device,
+		numSamplers,
+		0,
+		D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER,
+		D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE,
+		VarSizeAllocMngr::Backend::Tree,
+		GPUDescriptorHeap::DynamicBackend::AllocMngr,
+		nodeMask,
+		pendingFrees };
+
+	samplerCache = new SamplerCache{ device, *Sampler_CpuDH, *Sampler_GpuDH, numSamplers };
 
 	isInit = true;
 }
 
+void UDX12::DescriptorHeapMngr::EnableDeferredRelease(bool enable) noexcept {
+	assert(isInit);
+	CSU_CpuDH->EnableDeferredRelease(enable);
+	RTV_CpuDH->EnableDeferredRelease(enable);
+	DSV_CpuDH->EnableDeferredRelease(enable);
+	CSU_GpuDH->EnableDeferredRelease(enable);
+	Sampler_CpuDH->EnableDeferredRelease(enable);
+	Sampler_GpuDH->EnableDeferredRelease(enable);
+}
+
+void UDX12::DescriptorHeapMngr::SetFrameFenceValue(uint64_t fenceValue) {
+	assert(isInit);
+	CSU_CpuDH->SetFrameFenceValue(fenceValue);
+	RTV_CpuDH->SetFrameFenceValue(fenceValue);
+	DSV_CpuDH->SetFrameFenceValue(fenceValue);
+	CSU_GpuDH->SetFrameFenceValue(fenceValue);
+	Sampler_CpuDH->SetFrameFenceValue(fenceValue);
+	Sampler_GpuDH->SetFrameFenceValue(fenceValue);
+}
+
+void UDX12::DescriptorHeapMngr::ReleaseStaleAllocations(uint64_t completedFenceValue) {
+	assert(isInit);
+	CSU_CpuDH->ReleaseStaleAllocations(completedFenceValue);
+	RTV_CpuDH->ReleaseStaleAllocations(completedFenceValue);
+	DSV_CpuDH->ReleaseStaleAllocations(completedFenceValue);
+	CSU_GpuDH->ReleaseStaleAllocations(completedFenceValue);
+	Sampler_CpuDH->ReleaseStaleAllocations(completedFenceValue);
+	Sampler_GpuDH->ReleaseStaleAllocations(completedFenceValue);
+}
+
+void UDX12::DescriptorHeapMngr::SetTrimPolicy(const CPUDescriptorHeap::TrimPolicy& policy) {
+	assert(isInit);
+	CSU_CpuDH->SetTrimPolicy(policy);
+	RTV_CpuDH->SetTrimPolicy(policy);
+	DSV_CpuDH->SetTrimPolicy(policy);
+	Sampler_CpuDH->SetTrimPolicy(policy);
+}
+
+void UDX12::DescriptorHeapMngr::TrimIdleHeaps() {
+	assert(isInit);
+	CSU_CpuDH->TrimIdleHeaps();
+	RTV_CpuDH->TrimIdleHeaps();
+	DSV_CpuDH->TrimIdleHeaps();
+	Sampler_CpuDH->TrimIdleHeaps();
+}
+
+void UDX12::DescriptorHeapMngr::ReportTelemetry(IDescriptorTelemetrySink& sink) {
+	assert(isInit);
+	sink.OnFrame("CpuCSU", CSU_CpuDH->GetTelemetry()->EndFrame());
+	sink.OnFrame("CpuRTV", RTV_CpuDH->GetTelemetry()->EndFrame());
+	sink.OnFrame("CpuDSV", DSV_CpuDH->GetTelemetry()->EndFrame());
+	sink.OnFrame("CpuSampler", Sampler_CpuDH->GetTelemetry()->EndFrame());
+	sink.OnFrame("GpuCSU", CSU_GpuDH->GetTelemetry()->EndFrame());
+	sink.OnFrame("GpuSampler", Sampler_GpuDH->GetTelemetry()->EndFrame());
+}
+
+void UDX12::DescriptorHeapMngr::EnableLockTiming(bool enable) noexcept {
+	assert(isInit);
+	CSU_CpuDH->GetTelemetry()->EnableLockTiming(enable);
+	RTV_CpuDH->GetTelemetry()->EnableLockTiming(enable);
+	DSV_CpuDH->GetTelemetry()->EnableLockTiming(enable);
+	Sampler_CpuDH->GetTelemetry()->EnableLockTiming(enable);
+}
+
 void UDX12::DescriptorHeapMngr::Clear() {
 	isInit = false;
 
+	// The cache frees its samplers to the sampler heaps
+	delete samplerCache;
+
 	delete CSU_CpuDH;
 	delete RTV_CpuDH;
 	delete DSV_CpuDH;
 	delete CSU_GpuDH;
+	delete Sampler_CpuDH;
+	delete Sampler_GpuDH;
 
+	samplerCache = nullptr;
 	CSU_CpuDH = nullptr;
 	RTV_CpuDH = nullptr;
 	DSV_CpuDH = nullptr;
 	CSU_GpuDH = nullptr;
+	Sampler_CpuDH = nullptr;
+	Sampler_GpuDH = nullptr;
 }
 
 UDX12::DescriptorHeapMngr::~DescriptorHeapMngr() {
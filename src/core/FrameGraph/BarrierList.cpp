@@ -0,0 +1,39 @@
+#include <UDX12/FrameGraph/BarrierList.h>
+
+using namespace Ubpa::UDX12::FG;
+using namespace Ubpa::UDX12;
+using namespace Ubpa;
+
+void BarrierList::Transition(Rsrc* pRsrc, RsrcState before, RsrcState after) {
+	if (before == after)
+		return;
+
+	barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(pRsrc, before, after));
+}
+
+void BarrierList::Aliasing(Rsrc* pRsrcBefore, Rsrc* pRsrcAfter) {
+	barriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(pRsrcBefore, pRsrcAfter));
+}
+
+void BarrierList::Discard(Rsrc* pRsrc) {
+	discards.emplace_back(barriers.size(), pRsrc);
+}
+
+void BarrierList::Clear() noexcept {
+	barriers.clear();
+	discards.clear();
+}
+
+void BarrierList::Record(ID3D12GraphicsCommandList* cmdList) const {
+	size_t numRecorded = 0;
+	for (const auto& [numBarriers, pRsrc] : discards) {
+		if (numBarriers > numRecorded) {
+			cmdList->ResourceBarrier(static_cast<UINT>(numBarriers - numRecorded), barriers.data() + numRecorded);
+			numRecorded = numBarriers;
+		}
+		cmdList->DiscardResource(pRsrc, nullptr);
+	}
+
+	if (barriers.size() > numRecorded)
+		cmdList->ResourceBarrier(static_cast<UINT>(barriers.size() - numRecorded), barriers.data() + numRecorded);
+}
@@ -2,24 +2,82 @@
 
 #include <UDX12/FrameGraph/RsrcMngr.h>
 
+#include <algorithm>
+
 using namespace Ubpa::UDX12::FG;
 using namespace Ubpa::UDX12;
 using namespace Ubpa;
 
 Executor::Executor(ID3D12Device* device, size_t num_threads) :
-	device{ device }, threadpool{ num_threads } {}
+	device{ device }, threadpool{ num_threads }
+{
+	ThrowIfFailed(device->CreateFence(fenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)));
+}
+
+Executor::~Executor() {
+	// a null event blocks until the fence value is completed
+	if (fence->GetCompletedValue() < fenceValue)
+		ThrowIfFailed(fence->SetEventOnCompletion(fenceValue, nullptr));
+}
 
 Executor& Executor::RegisterPassFunc(size_t passNodeIdx, PassFunction func) {
 	passFuncs[passNodeIdx] = std::move(func);
 	return *this;
 }
 
+Executor& Executor::RegisterPassCost(size_t passNodeIdx, size_t cost) {
+	passCosts[passNodeIdx] = cost;
+	return *this;
+}
+
 void Executor::NewFrame() {
-	for (auto allocator : used_allocators) {
-		allocator->Reset();
-		free_allocators.push_back(allocator);
+	ReclaimAllocators();
+}
+
+void Executor::ReclaimAllocators() {
+	const UINT64 completedValue = fence->GetCompletedValue();
+	for (auto& [type, pool] : cmdListPools) {
+		// fence values are pushed in increasing order
+		while (!pool.inflight_allocators.empty() && pool.inflight_allocators.front().first <= completedValue) {
+			auto& allocator = pool.inflight_allocators.front().second;
+			ThrowIfFailed(allocator->Reset());
+			pool.free_allocators.push_back(std::move(allocator));
+			pool.inflight_allocators.pop_front();
+		}
+	}
+}
+
+ComPtr<ID3D12GraphicsCommandList> Executor::RequestCmdList(D3D12_COMMAND_LIST_TYPE type) {
+	auto& pool = cmdListPools[type];
+
+	if (pool.free_allocators.empty()) {
+		ComPtr<ID3D12CommandAllocator> allocator;
+		ThrowIfFailed(device->CreateCommandAllocator(
+			type,
+			IID_PPV_ARGS(&allocator)));
+		pool.free_allocators.push_back(std::move(allocator));
+	}
+
+	ComPtr<ID3D12CommandAllocator> allocator = std::move(pool.free_allocators.back());
+	pool.free_allocators.pop_back();
+
+	ComPtr<ID3D12GraphicsCommandList> cmdlist;
+	if (pool.free_cmdlists.empty()) {
+		ThrowIfFailed(device->CreateCommandList(
+			0,
+			type,
+			allocator.Get(),           // Associated command allocator
+			nullptr,                   // Initial PipelineStateObject
+			IID_PPV_ARGS(&cmdlist)));
+	}
+	else {
+		cmdlist = std::move(pool.free_cmdlists.back());
+		pool.free_cmdlists.pop_back();
+		ThrowIfFailed(cmdlist->Reset(allocator.Get(), nullptr));
 	}
-	used_allocators.clear();
+
+	frame_allocators.push_back(std::move(allocator));
+	return cmdlist;
 }
 
 Executor& Executor::RegisterCopyPassFunc(size_t passNodeIdx,
@@ -53,40 +111,70 @@ void Executor::Execute(
 	const UFG::Compiler::Result& crst,
 	RsrcMngr& rsrcMngr
 ) {
-	rsrcMngr.DHReserve();
-	rsrcMngr.AllocateHandle();
+	rsrcMngr.PreparePlan(crst);
 
-	const size_t cmdlist_num = crst.sorted_passes.size();
-	if (cmdlist_num == 0)
+	const size_t pass_num = crst.sorted_passes.size();
+	if (pass_num == 0)
 		return;
-	
-	// index by order (not pass index)
-	std::vector<ID3D12GraphicsCommandList*> cmdlists(cmdlist_num, nullptr);
-	std::mutex mutex_cnt;
-	size_t cnt = 0;
-	std::condition_variable cv_cnt;
 
-	std::mutex mutex_rsrcMngr;
+	order2pass.resize(pass_num);
+	for (auto pass : crst.sorted_passes)
+		order2pass[crst.pass2order[pass]] = pass;
 
-	for (size_t i = 0; i < cmdlist_num; ++i) {
-		if (free_allocators.empty()) {
-			Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
-			ThrowIfFailed(device->CreateCommandAllocator(
-				D3D12_COMMAND_LIST_TYPE_DIRECT,
-				IID_PPV_ARGS(&allocator)));
-			free_allocators.push_back(std::move(allocator));
+	// group consecutive passes into command lists
+	auto costOf = [&](size_t pass) {
+		auto target = passCosts.find(pass);
+		return target == passCosts.end() ? static_cast<size_t>(1) : target->second;
+	};
+	size_t targetCost = std::max<size_t>(batchPolicy.targetCostPerCmdList, 1);
+	const size_t minNumCmdLists = std::clamp<size_t>(batchPolicy.minNumCmdLists, 1, pass_num);
+	if (minNumCmdLists > 1) {
+		size_t totalCost = 0;
+		for (auto pass : crst.sorted_passes)
+			totalCost += costOf(pass);
+		targetCost = std::clamp<size_t>(totalCost / minNumCmdLists, 1, targetCost);
+	}
+	cmdlistBegins.clear();
+	cmdlistBegins.push_back(0);
+	size_t cost = costOf(order2pass[0]);
+	for (size_t order = 1; order < pass_num; ++order) {
+		const size_t passCost = costOf(order2pass[order]);
+		// close the command list before the pass exceeds the target,
+		// or when every remaining pass has to begin a command list to reach minNumCmdLists
+		const size_t numMissingCmdLists = minNumCmdLists - std::min(minNumCmdLists, cmdlistBegins.size());
+		if (cost + passCost > targetCost || pass_num - order <= numMissingCmdLists) {
+			cmdlistBegins.push_back(order);
+			cost = 0;
 		}
+		cost += passCost;
+	}
+	cmdlistBegins.push_back(pass_num);
+	const size_t cmdlist_num = cmdlistBegins.size() - 1;
 
-		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator = free_allocators.back();
-		free_allocators.pop_back();
-		used_allocators.push_back(allocator);
+	ReclaimAllocators();
 
-		ThrowIfFailed(device->CreateCommandList(
-			0,
-			D3D12_COMMAND_LIST_TYPE_DIRECT,
-			allocator.Get(),           // Associated command allocator
-			nullptr,                   // Initial PipelineStateObject
-			IID_PPV_ARGS(&cmdlists[i])));
+	std::vector<ID3D12GraphicsCommandList*> cmdlists(cmdlist_num, nullptr);
+	frame_cmdlists.clear();
+	frame_allocators.clear();
+	for (size_t i = 0; i < cmdlist_num; ++i) {
+		frame_cmdlists.push_back(RequestCmdList(D3D12_COMMAND_LIST_TYPE_DIRECT));
+		cmdlists[i] = frame_cmdlists.back().Get();
+	}
+
+	// resolve the resource states of all passes up front (index by order),
+	// the barrier lists are immutable while the passes are recorded
+	orderedPassFuncs.resize(pass_num);
+	passRsrcs.resize(pass_num);
+	preBarriers.resize(pass_num);
+	postBarriers.resize(pass_num);
+	for (size_t i = 0; i < pass_num; ++i) {
+		if (auto target = passFuncs.find(order2pass[i]); target != passFuncs.end())
+			orderedPassFuncs[i] = std::move(target->second);
+		else
+			orderedPassFuncs[i] = PassFunction{};
+		passRsrcs[i].clear();
+		preBarriers[i].Clear();
+		postBarriers[i].Clear();
 	}
 
 	if (auto target = crst.pass2info.find(static_cast<size_t>(-1)); target != crst.pass2info.end()) {
@@ -103,73 +191,77 @@ void Executor::Execute(
 
 		for (auto rsrc : info.destruct_resources){
 			rsrcMngr.DestructCPU(rsrc);
-			rsrcMngr.DestructGPU(cmdlists.front(), rsrc);
+			rsrcMngr.DestructGPU(preBarriers.front(), rsrc);
 		}
 	}
 
-	{
-		// let worker threads wait for the main thread
-		std::lock_guard<std::mutex> guard(mutex_rsrcMngr);
-		for (auto pass : crst.sorted_passes) {
-			const auto& passInfo = crst.pass2info.at(pass);
-			for (auto rsrc : passInfo.construct_resources)
-				rsrcMngr.Construct(rsrc);
-			auto cmdlist = cmdlists[crst.pass2order[pass]];// cmdlists[pass]
-			auto passRsrcs = rsrcMngr.RequestPassRsrcs(cmdlist, pass);
-
-			for (auto rsrc : passInfo.move_resources) {
-				auto src = rsrc;
-				auto dst = crst.moves_src2dst.at(src);
-				rsrcMngr.Move(dst, src);
-			}
+	for (auto pass : crst.sorted_passes) {
+		const size_t order = crst.pass2order[pass];
+		const auto& passInfo = crst.pass2info.at(pass);
+		for (auto rsrc : passInfo.construct_resources)
+			rsrcMngr.Construct(rsrc);
+		passRsrcs[order] = rsrcMngr.RequestPassRsrcs(preBarriers[order], pass);
 
-			for (auto rsrc : passInfo.destruct_resources)
-				rsrcMngr.DestructCPU(rsrc);
-
-			PassFunction passfunc;
-			if (auto target = passFuncs.find(pass); target != passFuncs.end())
-				passfunc = std::move(target->second);
-
-			threadpool.BasicEnqueue(
-				[
-					rsrcs = std::move(passRsrcs), func = std::move(passfunc), cmdlist, pass, cmdlist_num,
-					&crst, &mutex_cnt, &cnt, &cv_cnt, &rsrcMngr, &mutex_rsrcMngr
-				]
-				() {
-					if(func)
-						func(cmdlist, rsrcs);
-
-					const auto& passinfo = crst.pass2info.at(pass);
-					if (!passinfo.destruct_resources.empty()) {
-						// 1. wait main thread
-						// 2. avoid data race with other worker threads
-						std::lock_guard<std::mutex> guard(mutex_rsrcMngr);
-						for (auto rsrc : passinfo.destruct_resources)
-							rsrcMngr.DestructGPU(cmdlist, rsrc);
-					}
-
-					cmdlist->Close();
-
-					{ // add cnt
-						std::lock_guard<std::mutex> lk(mutex_cnt);
-						++cnt;
-						if (cnt == cmdlist_num)
-							cv_cnt.notify_one();
-					}
-				}
-			);
+		for (auto rsrc : passInfo.move_resources) {
+			auto src = rsrc;
+			auto dst = crst.moves_src2dst.at(src);
+			rsrcMngr.Move(dst, src);
+		}
+
+		for (auto rsrc : passInfo.destruct_resources) {
+			rsrcMngr.DestructCPU(rsrc);
+			rsrcMngr.DestructGPU(postBarriers[order], rsrc);
 		}
 	}
-	
+
+	// every command list owns its passes' barriers, so the command lists are recorded
+	// in parallel without touching the resource manager
+	std::mutex mutex_cnt;
+	size_t cnt = 0;
+	std::condition_variable cv_cnt;
+
+	for (size_t i = 0; i < cmdlist_num; ++i) {
+		threadpool.BasicEnqueue(
+			[
+				this, cmdlist = cmdlists[i], begin = cmdlistBegins[i], end = cmdlistBegins[i + 1], cmdlist_num,
+				&mutex_cnt, &cnt, &cv_cnt
+			]
+			() {
+				for (size_t order = begin; order < end; ++order) {
+					preBarriers[order].Record(cmdlist);
+
+					if (orderedPassFuncs[order])
+						orderedPassFuncs[order](cmdlist, passRsrcs[order]);
+
+					postBarriers[order].Record(cmdlist);
+				}
+
+				cmdlist->Close();
+
+				{ // add cnt
+					std::lock_guard<std::mutex> lk(mutex_cnt);
+					++cnt;
+					if (cnt == cmdlist_num)
+						cv_cnt.notify_one();
+				}
+			}
+		);
+	}
 
 	{
 		std::unique_lock<std::mutex> lk(mutex_cnt);
-		if (cnt != cmdlist_num) {
-			cv_cnt.wait(lk);
-			assert(cnt == cmdlist_num);
-		}
+		cv_cnt.wait(lk, [&]() { return cnt == cmdlist_num; });
 	}
 	cmdQueue->ExecuteCommandLists((UINT)cmdlists.size(), (ID3D12CommandList* const*)cmdlists.data());
-	for (auto* cmdlist : cmdlists)
-		cmdlist->Release();
+	for (auto& func : orderedPassFuncs)
+		func = PassFunction{};
+	ThrowIfFailed(cmdQueue->Signal(fence.Get(), ++fenceValue));
+
+	auto& pool = cmdListPools[D3D12_COMMAND_LIST_TYPE_DIRECT];
+	for (auto& cmdlist : frame_cmdlists)
+		pool.free_cmdlists.push_back(std::move(cmdlist));
+	for (auto& allocator : frame_allocators)
+		pool.inflight_allocators.emplace_back(fenceValue, std::move(allocator));
+	frame_cmdlists.clear();
+	frame_allocators.clear();
 }
@@ -0,0 +1,51 @@
+#include <UDX12/FrameGraph/RsrcAliasPacker.h>
+
+#include <algorithm>
+#include <cassert>
+
+using namespace Ubpa::UDX12::FG;
+
+uint64_t RsrcAliasPacker::Pack(std::span<const Item> items, std::vector<uint64_t>& offsets) {
+	offsets.assign(items.size(), 0);
+
+	// largest first, the small resources fill the gaps
+	order.resize(items.size());
+	for (size_t i = 0; i < items.size(); i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+		if (items[lhs].size != items[rhs].size)
+			return items[lhs].size > items[rhs].size;
+		return items[lhs].first < items[rhs].first;
+	});
+
+	uint64_t heapSize = 0;
+	for (size_t k = 0; k < order.size(); k++) {
+		const auto& item = items[order[k]];
+		assert(item.first <= item.last);
+		assert(item.alignment != 0 && (item.alignment & (item.alignment - 1)) == 0);
+
+		// memory of the placed items alive at the same time
+		busy.clear();
+		for (size_t j = 0; j < k; j++) {
+			const auto& placed = items[order[j]];
+			if (Overlap(item, placed))
+				busy.push_back({ offsets[order[j]], offsets[order[j]] + placed.size });
+		}
+		std::sort(busy.begin(), busy.end(), [](const Range& lhs, const Range& rhs) {
+			return lhs.begin < rhs.begin;
+		});
+
+		// first fit
+		uint64_t offset = 0;
+		for (const auto& range : busy) {
+			if (offset + item.size <= range.begin)
+				break;
+			offset = std::max(offset, (range.end + item.alignment - 1) & ~(item.alignment - 1));
+		}
+
+		offsets[order[k]] = offset;
+		heapSize = std::max(heapSize, offset + item.size);
+	}
+
+	return heapSize;
+}
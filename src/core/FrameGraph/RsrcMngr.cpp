@@ -11,7 +11,28 @@ using namespace std;
 
 #include <DirectXColors.h>
 
-RsrcMngr::RsrcMngr(ID3D12Device* device) : device{ device } {
+static size_t HashRsrcImplDesc(const RsrcImplDesc& desc) {
+	size_t rst = desc.index();
+	std::visit([&](const auto& desc) {
+		using T = std::decay_t<decltype(desc)>;
+		if constexpr (!std::is_same_v<T, RsrcImplDesc_SRV_NULL>
+			&& !std::is_same_v<T, RsrcImplDesc_UAV_NULL>
+			&& !std::is_same_v<T, RsrcImplDesc_RTV_Null>
+			&& !std::is_same_v<T, RsrcImplDesc_DSV_Null>)
+		{
+			detail::hash_combine(rst, desc);
+		}
+	}, desc);
+	return rst;
+}
+
+RsrcMngr::RsrcMngr(ID3D12Device* device) :
+	device{ device },
+	viewCache{ device },
+	csuCopyBatch{ device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV },
+	rtvCopyBatch{ device, D3D12_DESCRIPTOR_HEAP_TYPE_RTV },
+	dsvCopyBatch{ device, D3D12_DESCRIPTOR_HEAP_TYPE_DSV }
+{
 	csuDynamicDH = new DynamicSuballocMngr{
 		DescriptorHeapMngr::Instance().GetCSUGpuDH(),
 		256,
@@ -30,12 +51,17 @@ RsrcMngr::~RsrcMngr() {
 }
 
 void RsrcMngr::NewFrame() {
+	staleAliasHeaps.clear();
+	staleAliasRsrcs.clear();
+	aliasActivations.clear();
+
 	for (const auto& [type, rsrc] : unreusableRsrcs)
 		pool[type].push_back(rsrc);
 
 	for (auto& [type, rsrcs] : pool) {
 		rsrcs.erase(std::remove_if(rsrcs.begin(), rsrcs.end(), [&](const auto& rsrc) {
 			if (!usedRsrcs.contains(rsrc.pRsrc)) {
+				viewCache.Evict(rsrc.pRsrc);
 				rsrcKeeper.erase(rsrc.pRsrc);
 				return true;
 			}
@@ -61,13 +87,13 @@ void RsrcMngr::NewFrame() {
 	actives.clear();
 	usedRsrcs.clear();
 	unreusableRsrcs.clear();
+	registeredDescs.clear();
 
-	for (const auto& idx : csuDHused)
-		csuDHfree.push_back(idx);
-	for (const auto& idx : rtvDHused)
-		rtvDHfree.push_back(idx);
-	for (const auto& idx : dsvDHused)
-		dsvDHfree.push_back(idx);
+	// the indices are returned in reverse order, so the free lists are as before AllocateHandle
+	// and the next AllocateHandle assigns the same indices (like a replayed plan)
+	csuDHfree.insert(csuDHfree.end(), csuDHused.rbegin(), csuDHused.rend());
+	rtvDHfree.insert(rtvDHfree.end(), rtvDHused.rbegin(), rtvDHused.rend());
+	dsvDHfree.insert(dsvDHfree.end(), dsvDHused.rbegin(), dsvDHused.rend());
 
 	csuDHused.clear();
 	rtvDHused.clear();
@@ -80,9 +106,167 @@ void RsrcMngr::NewFrame() {
 
 void RsrcMngr::Clear() {
 	NewFrame();
+	viewCache.Clear();
 	rsrcKeeper.clear();
 	pool.clear();
 	unreusableRsrcs.clear();
+	ReleaseAliasedRsrcs();
+	staleAliasHeaps.clear();
+	staleAliasRsrcs.clear();
+	plan.valid = false;
+}
+
+void RsrcMngr::PlanAliasing(const UFG::Compiler::Result& crst) {
+	if (!aliasingEnabled) {
+		if (!aliasEntries.empty())
+			ReleaseAliasedRsrcs();
+		return;
+	}
+
+	// the pre-pass (-1) runs before the first pass
+	auto orderOf = [&](size_t pass) {
+		return pass == static_cast<size_t>(-1) ? 0 : crst.pass2order[pass];
+	};
+
+	// destructed resource node -> pass order
+	std::unordered_map<size_t, size_t> destructOrders;
+	for (const auto& [pass, passInfo] : crst.pass2info) {
+		for (auto rsrcNodeIdx : passInfo.destruct_resources)
+			destructOrders.emplace(rsrcNodeIdx, orderOf(pass));
+	}
+
+	const size_t lastOrder = crst.sorted_passes.empty() ? 0 : crst.sorted_passes.size() - 1;
+
+	newAliasEntries.clear();
+	for (const auto& [pass, passInfo] : crst.pass2info) {
+		for (auto rsrcNodeIdx : passInfo.construct_resources) {
+			if (IsImported(rsrcNodeIdx))
+				continue;
+			// an unreusable resource is kept to the next frame
+			if (auto target = temporalReusable.find(rsrcNodeIdx); target != temporalReusable.end() && !target->second)
+				continue;
+
+			// the resource is destructed by the last resource node of its move chain
+			size_t node = rsrcNodeIdx;
+			for (auto target = crst.moves_src2dst.find(node); target != crst.moves_src2dst.end(); target = crst.moves_src2dst.find(node))
+				node = target->second;
+			size_t last = lastOrder;
+			if (auto target = destructOrders.find(node); target != destructOrders.end())
+				last = target->second;
+
+			D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON;
+			if (auto target = temporalConstructStates.find(rsrcNodeIdx); target != temporalConstructStates.end())
+				state = target->second;
+
+			const auto& type = temporals.at(rsrcNodeIdx);
+			const auto allocationInfo = device->GetResourceAllocationInfo(0, 1, &type.desc);
+
+			AliasHeapClass heapClass;
+			if (type.desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+				heapClass = AliasHeapClass::Buffer;
+			else if ((type.desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0)
+				heapClass = AliasHeapClass::RtDsTexture;
+			else
+				heapClass = AliasHeapClass::OtherTexture;
+
+			newAliasEntries.push_back(AliasEntry{
+				.rsrcNodeIdx = rsrcNodeIdx,
+				.type = type,
+				.constructState = state,
+				.item = { orderOf(pass), last, allocationInfo.SizeInBytes, allocationInfo.Alignment },
+				.heapClass = heapClass
+			});
+		}
+	}
+	std::sort(newAliasEntries.begin(), newAliasEntries.end(), [](const AliasEntry& lhs, const AliasEntry& rhs) {
+		return lhs.rsrcNodeIdx < rhs.rsrcNodeIdx;
+	});
+
+	// steady state : same graph, same resources
+	if (newAliasEntries == aliasEntries)
+		return;
+
+	ReleaseAliasedRsrcs();
+	aliasEntries.swap(newAliasEntries);
+	CreateAliasedRsrcs();
+}
+
+void RsrcMngr::CreateAliasedRsrcs() {
+	// resource heap tier 1 can't mix buffers, RT/DS textures and other textures in one heap
+	constexpr D3D12_HEAP_FLAGS heapFlags[static_cast<size_t>(AliasHeapClass::Num)] = {
+		D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS,
+		D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES,
+		D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES
+	};
+
+	aliasViews.resize(aliasEntries.size());
+	aliasRsrcs.resize(aliasEntries.size());
+	aliasHeaps.resize(static_cast<size_t>(AliasHeapClass::Num));
+
+	std::vector<RsrcAliasPacker::Item> items;
+	std::vector<size_t> indices; // index in aliasEntries
+	std::vector<uint64_t> offsets;
+	for (size_t c = 0; c < static_cast<size_t>(AliasHeapClass::Num); c++) {
+		items.clear();
+		indices.clear();
+		UINT64 alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		for (size_t i = 0; i < aliasEntries.size(); i++) {
+			if (aliasEntries[i].heapClass != static_cast<AliasHeapClass>(c))
+				continue;
+			items.push_back(aliasEntries[i].item);
+			indices.push_back(i);
+			alignment = std::max<UINT64>(alignment, aliasEntries[i].item.alignment);
+		}
+		if (items.empty())
+			continue;
+
+		const UINT64 heapSize = (aliasPacker.Pack(items, offsets) + alignment - 1) & ~(alignment - 1);
+		const auto heapDesc = CD3DX12_HEAP_DESC(heapSize, D3D12_HEAP_TYPE_DEFAULT, alignment, heapFlags[c]);
+		ThrowIfFailed(device->CreateHeap(&heapDesc, IID_PPV_ARGS(aliasHeaps[c].GetAddressOf())));
+		aliasingStats.numHeapBytes += heapSize;
+
+		for (size_t k = 0; k < indices.size(); k++) {
+			const size_t i = indices[k];
+			const auto& entry = aliasEntries[i];
+			ThrowIfFailed(device->CreatePlacedResource(
+				aliasHeaps[c].Get(),
+				offsets[k],
+				&entry.type.desc,
+				entry.constructState,
+				entry.type.containClearvalue ? &entry.type.clearvalue : nullptr,
+				IID_PPV_ARGS(aliasRsrcs[i].GetAddressOf())));
+			aliasViews[i] = { aliasRsrcs[i].Get(), entry.constructState };
+			aliasIndices.emplace(entry.rsrcNodeIdx, i);
+			aliasRsrc2index.emplace(aliasRsrcs[i].Get(), i);
+			aliasingStats.numUnaliasedBytes += entry.item.size;
+		}
+	}
+
+	aliasingStats.numAliasedRsrcs = aliasEntries.size();
+	aliasingStats.numPlans++;
+}
+
+void RsrcMngr::ReleaseAliasedRsrcs() {
+	for (auto& ptr : aliasRsrcs) {
+		viewCache.Evict(ptr.Get());
+		staleAliasRsrcs.push_back(std::move(ptr));
+	}
+	for (auto& heap : aliasHeaps) {
+		if (heap)
+			staleAliasHeaps.push_back(std::move(heap));
+	}
+
+	aliasEntries.clear();
+	aliasViews.clear();
+	aliasRsrcs.clear();
+	aliasHeaps.clear();
+	aliasIndices.clear();
+	aliasRsrc2index.clear();
+	aliasActivations.clear();
+
+	aliasingStats.numAliasedRsrcs = 0;
+	aliasingStats.numHeapBytes = 0;
+	aliasingStats.numUnaliasedBytes = 0;
 }
 
 void RsrcMngr::CSUDHReserve(UINT num) {
@@ -236,6 +420,10 @@ void RsrcMngr::Construct(size_t rsrcNodeIdx) {
 
 	if (IsImported(rsrcNodeIdx))
 		view = importeds.at(rsrcNodeIdx);
+	else if (auto target = aliasIndices.find(rsrcNodeIdx); target != aliasIndices.end()) {
+		view = aliasViews[target->second];
+		aliasActivations.insert(view.pRsrc);
+	}
 	else {
 		const auto& type = temporals[rsrcNodeIdx];
 		auto& frees = pool[type];
@@ -267,7 +455,9 @@ void RsrcMngr::Construct(size_t rsrcNodeIdx) {
 
 void RsrcMngr::DestructCPU(size_t rsrcNodeIdx) {
 	auto view = actives.at(rsrcNodeIdx);
-	if (!IsImported(rsrcNodeIdx)) {
+	if (auto target = aliasRsrc2index.find(view.pRsrc); target != aliasRsrc2index.end())
+		aliasViews[target->second].state = view.state;
+	else if (!IsImported(rsrcNodeIdx)) {
 		const auto& rsrcType = temporals.at(rsrcNodeIdx);
 		if (auto target = temporalReusable.find(rsrcNodeIdx); target == temporalReusable.end() || target->second)
 			pool[rsrcType].push_back(view);
@@ -284,16 +474,21 @@ void RsrcMngr::DestructCPU(size_t rsrcNodeIdx) {
 	*/
 }
 
-void RsrcMngr::DestructGPU(ID3D12GraphicsCommandList* cmdList, size_t rsrcNodeIdx) {
+void RsrcMngr::DestructGPU(BarrierList& barriers, size_t rsrcNodeIdx) {
 	auto view = actives.at(rsrcNodeIdx);
 	if (IsImported(rsrcNodeIdx)) {
 		auto orig_state = importeds.at(rsrcNodeIdx).state;
-		if (view.state != orig_state)
-			DirectX::TransitionResource(cmdList, view.pRsrc, view.state, orig_state);
+		barriers.Transition(view.pRsrc, view.state, orig_state);
 	}
 	actives.erase(rsrcNodeIdx);
 }
 
+void RsrcMngr::DestructGPU(ID3D12GraphicsCommandList* cmdList, size_t rsrcNodeIdx) {
+	BarrierList barriers;
+	DestructGPU(barriers, rsrcNodeIdx);
+	barriers.Record(cmdList);
+}
+
 void RsrcMngr::Move(size_t dstRsrcNodeIdx, size_t srcRsrcNodeIdx) {
 	assert(dstRsrcNodeIdx != srcRsrcNodeIdx);
 	assert(actives.find(dstRsrcNodeIdx) == actives.end());
@@ -441,6 +636,7 @@ RsrcMngr& RsrcMngr::RegisterRsrcHandle(
 	D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle,
 	bool inited)
 {
+	registeredDescs.emplace_back(rsrcNodeIdx, desc);
 	auto& typeinfo = typeinfoMap[rsrcNodeIdx];
 	std::visit([&](const auto& desc) {
 		using T = std::decay_t<decltype(desc)>;
@@ -495,6 +691,7 @@ RsrcMngr& RsrcMngr::RegisterRsrcTable(const std::string& ID, const std::vector<s
 	auto allocation = csuDynamicDH->Allocate(static_cast<uint32_t>(rsrcNodeIndices.size()));
 	for (uint32_t i = 0; i < rsrcNodeIndices.size(); i++) {
 		const auto& [rsrcNodeIdx, desc] = rsrcNodeIndices[i];
+		registeredDescs.emplace_back(rsrcNodeIdx, desc);
 		auto& typeinfo = typeinfoMap[rsrcNodeIdx];
 		auto cpuHandle = allocation.GetCpuHandle(i);
 		auto gpuHandle = allocation.GetGpuHandle(i);
@@ -565,121 +762,305 @@ DXGI_FORMAT RsrcMngr::GetResourceFormat(size_t rsrcNodeIdx) const {
 		return DXGI_FORMAT_UNKNOWN;
 }
 
+bool RsrcMngr::HaveHandle(const RsrcDescInfo& typeinfo, const RsrcImplDesc& desc) {
+	return std::visit([&](const auto& desc) {
+		using T = std::decay_t<decltype(desc)>;
+		if constexpr (std::is_same_v<T, D3D12_CONSTANT_BUFFER_VIEW_DESC>)
+			return typeinfo.desc2info_cbv.find(desc) != typeinfo.desc2info_cbv.end();
+		else if constexpr (std::is_same_v<T, D3D12_SHADER_RESOURCE_VIEW_DESC>)
+			return typeinfo.desc2info_srv.find(desc) != typeinfo.desc2info_srv.end();
+		else if constexpr (std::is_same_v<T, RsrcImplDesc_SRV_NULL>)
+			return !typeinfo.null_info_srv.empty();
+		else if constexpr (std::is_same_v<T, D3D12_UNORDERED_ACCESS_VIEW_DESC>)
+			return typeinfo.desc2info_uav.find(desc) != typeinfo.desc2info_uav.end();
+		else if constexpr (std::is_same_v<T, RsrcImplDesc_UAV_NULL>)
+			return !typeinfo.null_info_uav.empty();
+		else if constexpr (std::is_same_v<T, D3D12_RENDER_TARGET_VIEW_DESC>)
+			return typeinfo.desc2info_rtv.find(desc) != typeinfo.desc2info_rtv.end();
+		else if constexpr (std::is_same_v<T, RsrcImplDesc_RTV_Null>)
+			return typeinfo.HaveNullRtv();
+		else if constexpr (std::is_same_v<T, D3D12_DEPTH_STENCIL_VIEW_DESC>)
+			return typeinfo.desc2info_dsv.find(desc) != typeinfo.desc2info_dsv.end();
+		else if constexpr (std::is_same_v<T, RsrcImplDesc_DSV_Null>)
+			return typeinfo.HaveNullDsv();
+		else
+			static_assert(always_false_v<T>, "non-exhaustive visitor!");
+	}, desc);
+}
+
+void RsrcMngr::AssignHandle(RsrcDescInfo& typeinfo, const RsrcImplDesc& desc, UINT idx) {
+	std::visit([&](const auto& desc) {
+		using T = std::decay_t<decltype(desc)>;
+		// CBV
+		if constexpr (std::is_same_v<T, D3D12_CONSTANT_BUFFER_VIEW_DESC>) {
+			typeinfo.desc2info_cbv[desc][RsrcDescInfo::CpuGpuInfo::DefaultID]
+				= { csuDH.GetCpuHandle(idx), csuDH.GetGpuHandle(idx), false };
+		}
+		// SRV
+		else if constexpr (std::is_same_v<T, D3D12_SHADER_RESOURCE_VIEW_DESC>) {
+			typeinfo.desc2info_srv[desc][RsrcDescInfo::CpuGpuInfo::DefaultID]
+				= { csuDH.GetCpuHandle(idx), csuDH.GetGpuHandle(idx), false };
+		}
+		else if constexpr (std::is_same_v<T, RsrcImplDesc_SRV_NULL>) {
+			typeinfo.null_info_srv[RsrcDescInfo::CpuGpuInfo::DefaultID]
+				= { csuDH.GetCpuHandle(idx), csuDH.GetGpuHandle(idx), false };
+		}
+		// UAV
+		else if constexpr (std::is_same_v<T, D3D12_UNORDERED_ACCESS_VIEW_DESC>) {
+			typeinfo.desc2info_uav[desc][RsrcDescInfo::CpuGpuInfo::DefaultID]
+				= { csuDH.GetCpuHandle(idx), csuDH.GetGpuHandle(idx), false };
+		}
+		else if constexpr (std::is_same_v<T, RsrcImplDesc_UAV_NULL>) {
+			typeinfo.null_info_uav[RsrcDescInfo::CpuGpuInfo::DefaultID]
+				= { csuDH.GetCpuHandle(idx), csuDH.GetGpuHandle(idx), false };
+		}
+		// RTV
+		else if constexpr (std::is_same_v<T, D3D12_RENDER_TARGET_VIEW_DESC>)
+			typeinfo.desc2info_rtv[desc] = { rtvDH.GetCpuHandle(idx), false };
+		else if constexpr (std::is_same_v<T, RsrcImplDesc_RTV_Null>)
+			typeinfo.null_info_rtv = { rtvDH.GetCpuHandle(idx), false };
+		// DSV
+		else if constexpr (std::is_same_v<T, D3D12_DEPTH_STENCIL_VIEW_DESC>)
+			typeinfo.desc2info_dsv[desc] = { dsvDH.GetCpuHandle(idx), false };
+		else if constexpr (std::is_same_v<T, RsrcImplDesc_DSV_Null>)
+			typeinfo.null_info_dsv = { dsvDH.GetCpuHandle(idx), false };
+		else
+			static_assert(always_false_v<T>, "non-exhaustive visitor!");
+	}, desc);
+}
+
 void RsrcMngr::AllocateHandle() {
+	// recorded for PreparePlan
+	plan.valid = false;
+	plan.rsrcNodes.clear();
+	plan.handles.clear();
+
 	for (const auto& [passNodeIdx, rsrcs] : passNodeIdx2rsrcMap) {
 		for (const auto& [rsrcNodeIdx, state_descs] : rsrcs) {
 			const auto& [state, descs] = state_descs;
 			auto& typeinfo = typeinfoMap[rsrcNodeIdx];
+			plan.rsrcNodes.push_back(rsrcNodeIdx);
 			for (const auto& desc : descs) {
+				if (HaveHandle(typeinfo, desc))
+					continue;
+
+				std::vector<UINT>* frees;
+				std::vector<UINT>* useds;
 				std::visit([&](const auto& desc) {
 					using T = std::decay_t<decltype(desc)>;
-					// CBV
-					if constexpr (std::is_same_v<T, D3D12_CONSTANT_BUFFER_VIEW_DESC>) {
-						if (typeinfo.desc2info_cbv.find(desc) != typeinfo.desc2info_cbv.end())
-							return;
-						auto idx = csuDHfree.back();
-						csuDHfree.pop_back();
-						csuDHused.insert(idx);
-						typeinfo.desc2info_cbv[desc][RsrcDescInfo::CpuGpuInfo::DefaultID]
-							= {csuDH.GetCpuHandle(idx), csuDH.GetGpuHandle(idx), false};
-					}
-					// SRV
-					else if constexpr (std::is_same_v<T, D3D12_SHADER_RESOURCE_VIEW_DESC>
-						|| std::is_same_v<T, RsrcImplDesc_SRV_NULL>)
-					{
-						if constexpr (std::is_same_v<T, D3D12_SHADER_RESOURCE_VIEW_DESC>) {
-							if (typeinfo.desc2info_srv.find(desc) != typeinfo.desc2info_srv.end())
-								return;
-						}
-						else { // std::is_same_v<T, RsrcImplDesc_SRV_NULL>
-							if (!typeinfo.null_info_srv.empty())
-								return;
-						}
-						auto idx = csuDHfree.back();
-						csuDHfree.pop_back();
-						csuDHused.insert(idx);
-						if constexpr (std::is_same_v<T, D3D12_SHADER_RESOURCE_VIEW_DESC>){
-							typeinfo.desc2info_srv[desc][RsrcDescInfo::CpuGpuInfo::DefaultID]
-								= { csuDH.GetCpuHandle(idx), csuDH.GetGpuHandle(idx), false };
-						}
-						else {
-							typeinfo.null_info_srv[RsrcDescInfo::CpuGpuInfo::DefaultID]
-								= { csuDH.GetCpuHandle(idx), csuDH.GetGpuHandle(idx), false };
-						}
-					}
-					// UAV
-					else if constexpr (std::is_same_v<T, D3D12_UNORDERED_ACCESS_VIEW_DESC>
-						|| std::is_same_v<T, RsrcImplDesc_UAV_NULL>)
-					{
-						if constexpr (std::is_same_v<T, D3D12_UNORDERED_ACCESS_VIEW_DESC>) {
-							if (typeinfo.desc2info_uav.find(desc) != typeinfo.desc2info_uav.end())
-								return;
-						}
-						else { // std::is_same_v<T, RsrcImplDesc_UAV_NULL>
-							if (!typeinfo.null_info_uav.empty())
-								return;
-						}
-						auto idx = csuDHfree.back();
-						csuDHfree.pop_back();
-						csuDHused.insert(idx);
-						if constexpr (std::is_same_v<T, D3D12_UNORDERED_ACCESS_VIEW_DESC>) {
-							typeinfo.desc2info_uav[desc][RsrcDescInfo::CpuGpuInfo::DefaultID]
-								= { csuDH.GetCpuHandle(idx), csuDH.GetGpuHandle(idx), false };
-						}
-						else{
-							typeinfo.null_info_uav[RsrcDescInfo::CpuGpuInfo::DefaultID]
-								= { csuDH.GetCpuHandle(idx), csuDH.GetGpuHandle(idx), false };
-						}
-					}
-					// RTV
-					else if constexpr (std::is_same_v<T, D3D12_RENDER_TARGET_VIEW_DESC>
+					if constexpr (std::is_same_v<T, D3D12_RENDER_TARGET_VIEW_DESC>
 						|| std::is_same_v<T, RsrcImplDesc_RTV_Null>)
 					{
-						if constexpr (std::is_same_v<T, D3D12_RENDER_TARGET_VIEW_DESC>) {
-							if (typeinfo.desc2info_rtv.find(desc) != typeinfo.desc2info_rtv.end())
-								return;
-						}
-						else { // std::is_same_v<T, RsrcImplDesc_RTV_Null>
-							if (typeinfo.HaveNullRtv())
-								return;
-						}
-						auto idx = rtvDHfree.back();
-						rtvDHfree.pop_back();
-						rtvDHused.insert(idx);
-						if constexpr (std::is_same_v<T, D3D12_RENDER_TARGET_VIEW_DESC>)
-							typeinfo.desc2info_rtv[desc] = { rtvDH.GetCpuHandle(idx), false };
-						else
-							typeinfo.null_info_rtv = { rtvDH.GetCpuHandle(idx), false };
+						frees = &rtvDHfree;
+						useds = &rtvDHused;
 					}
-					// DSV
 					else if constexpr (std::is_same_v<T, D3D12_DEPTH_STENCIL_VIEW_DESC>
 						|| std::is_same_v<T, RsrcImplDesc_DSV_Null>)
 					{
-						if constexpr (std::is_same_v<T, D3D12_DEPTH_STENCIL_VIEW_DESC>) {
-							if (typeinfo.desc2info_dsv.find(desc) != typeinfo.desc2info_dsv.end())
-								return;
-						}
-						else { // std::is_same_v<T, RsrcImplDesc_DSV_Null>
-							if (typeinfo.HaveNullDsv())
-								return;
-						}
-						auto idx = dsvDHfree.back();
-						dsvDHfree.pop_back();
-						dsvDHused.insert(idx);
-						if constexpr (std::is_same_v<T, D3D12_DEPTH_STENCIL_VIEW_DESC>)
-							typeinfo.desc2info_dsv[desc] = { dsvDH.GetCpuHandle(idx), false };
-						else
-							typeinfo.null_info_dsv = { dsvDH.GetCpuHandle(idx), false };
+						frees = &dsvDHfree;
+						useds = &dsvDHused;
+					}
+					else { // CBV, SRV, UAV
+						frees = &csuDHfree;
+						useds = &csuDHused;
 					}
-					else
-						static_assert(always_false_v<T>, "non-exhaustive visitor!");
 				}, desc);
+
+				auto idx = frees->back();
+				frees->pop_back();
+				useds->push_back(idx);
+				AssignHandle(typeinfo, desc, idx);
+				plan.handles.push_back({ rsrcNodeIdx, desc, idx });
+			}
+		}
+	}
+}
+
+void RsrcMngr::PreparePlan(const UFG::Compiler::Result& crst) {
+	const size_t hash = HashPlanInputs(crst);
+	if (plan.valid && plan.hash == hash && IsPlanInputsEqual(crst)) {
+		ReplayPlan();
+		planCacheStats.numHits++;
+		return;
+	}
+
+	planCacheStats.numMisses++;
+	DHReserve();
+	AllocateHandle();
+	PlanAliasing(crst);
+	SavePlan(crst, hash);
+}
+
+size_t RsrcMngr::HashPlanInputs(const UFG::Compiler::Result& crst) const {
+	// unordered containers are hashed by the sum of their element hashes
+	size_t rst = 0;
+	detail::hash_combine(rst, aliasingEnabled);
+
+	// compiled graph
+	for (auto pass : crst.sorted_passes)
+		detail::hash_combine(rst, pass);
+	{
+		size_t sum = 0;
+		for (const auto& [pass, passInfo] : crst.pass2info) {
+			size_t passHash = pass;
+			for (auto rsrcNodeIdx : passInfo.construct_resources)
+				detail::hash_combine(passHash, rsrcNodeIdx);
+			detail::hash_combine(passHash, passInfo.construct_resources.size());
+			for (auto rsrcNodeIdx : passInfo.move_resources)
+				detail::hash_combine(passHash, rsrcNodeIdx);
+			detail::hash_combine(passHash, passInfo.move_resources.size());
+			for (auto rsrcNodeIdx : passInfo.destruct_resources)
+				detail::hash_combine(passHash, rsrcNodeIdx);
+			sum += passHash;
+		}
+		detail::hash_combine(rst, sum);
+	}
+	{
+		size_t sum = 0;
+		for (const auto& [src, dst] : crst.moves_src2dst) {
+			size_t moveHash = src;
+			detail::hash_combine(moveHash, dst);
+			sum += moveHash;
+		}
+		detail::hash_combine(rst, sum);
+	}
+
+	// registrations
+	{
+		size_t sum = 0;
+		for (const auto& [passNodeIdx, rsrcs] : passNodeIdx2rsrcMap) {
+			size_t rsrcsSum = 0;
+			for (const auto& [rsrcNodeIdx, state_descs] : rsrcs) {
+				const auto& [state, descs] = state_descs;
+				size_t rsrcHash = rsrcNodeIdx;
+				detail::hash_combine(rsrcHash, state);
+				for (const auto& desc : descs)
+					detail::hash_combine(rsrcHash, HashRsrcImplDesc(desc));
+				rsrcsSum += rsrcHash;
 			}
+			size_t passHash = passNodeIdx;
+			detail::hash_combine(passHash, rsrcsSum);
+			sum += passHash;
 		}
+		detail::hash_combine(rst, sum);
+	}
+	for (const auto& [rsrcNodeIdx, desc] : registeredDescs) {
+		detail::hash_combine(rst, rsrcNodeIdx);
+		detail::hash_combine(rst, HashRsrcImplDesc(desc));
 	}
+	{
+		size_t sum = 0;
+		for (const auto& [rsrcNodeIdx, type] : temporals) {
+			size_t typeHash = rsrcNodeIdx;
+			detail::hash_combine(typeHash, type.desc);
+			detail::hash_combine(typeHash, type.containClearvalue);
+			sum += typeHash;
+		}
+		for (const auto& [rsrcNodeIdx, reusable] : temporalReusable) {
+			size_t reusableHash = rsrcNodeIdx;
+			detail::hash_combine(reusableHash, reusable);
+			sum += reusableHash;
+		}
+		for (const auto& [rsrcNodeIdx, state] : temporalConstructStates) {
+			size_t stateHash = rsrcNodeIdx;
+			detail::hash_combine(stateHash, state);
+			sum += stateHash;
+		}
+		for (const auto& [rsrcNodeIdx, view] : importeds)
+			sum += std::hash<size_t>{}(rsrcNodeIdx);
+		detail::hash_combine(rst, sum);
+	}
+
+	return rst;
+}
+
+bool RsrcMngr::IsPlanInputsEqual(const UFG::Compiler::Result& crst) const {
+	if (aliasingEnabled != plan.aliasingEnabled)
+		return false;
+
+	const auto& cached = plan.crst;
+	if (crst.sorted_passes != cached.sorted_passes
+		|| crst.pass2order != cached.pass2order
+		|| crst.moves_src2dst != cached.moves_src2dst
+		|| crst.pass2info.size() != cached.pass2info.size())
+	{
+		return false;
+	}
+
+	auto equalRange = [](const auto& lhs, const auto& rhs) {
+		return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+	};
+	for (const auto& [pass, passInfo] : crst.pass2info) {
+		auto target = cached.pass2info.find(pass);
+		if (target == cached.pass2info.end()
+			|| !equalRange(passInfo.construct_resources, target->second.construct_resources)
+			|| !equalRange(passInfo.move_resources, target->second.move_resources)
+			|| !equalRange(passInfo.destruct_resources, target->second.destruct_resources))
+		{
+			return false;
+		}
+	}
+
+	return passNodeIdx2rsrcMap == plan.passNodeIdx2rsrcMap
+		&& registeredDescs == plan.registeredDescs
+		&& temporals == plan.temporals
+		&& temporalReusable == plan.temporalReusable
+		&& temporalConstructStates == plan.temporalConstructStates
+		&& importeds.size() == plan.importeds.size()
+		&& std::all_of(plan.importeds.begin(), plan.importeds.end(), [&](size_t rsrcNodeIdx) {
+			return importeds.contains(rsrcNodeIdx);
+		});
+}
+
+void RsrcMngr::SavePlan(const UFG::Compiler::Result& crst, size_t hash) {
+	// plan.rsrcNodes and plan.handles are recorded by AllocateHandle
+	plan.valid = true;
+	plan.hash = hash;
+
+	plan.aliasingEnabled = aliasingEnabled;
+	plan.crst = crst;
+	plan.passNodeIdx2rsrcMap = passNodeIdx2rsrcMap;
+	plan.registeredDescs = registeredDescs;
+	plan.temporals = temporals;
+	plan.temporalReusable = temporalReusable;
+	plan.temporalConstructStates = temporalConstructStates;
+	plan.importeds.clear();
+	for (const auto& [rsrcNodeIdx, view] : importeds)
+		plan.importeds.push_back(rsrcNodeIdx);
+
+	plan.csuDHfree = csuDHfree;
+	plan.csuDHused = csuDHused;
+	plan.rtvDHfree = rtvDHfree;
+	plan.rtvDHused = rtvDHused;
+	plan.dsvDHfree = dsvDHfree;
+	plan.dsvDHused = dsvDHused;
+}
+
+void RsrcMngr::ReplayPlan() {
+	// the descriptor heaps are not reserved again, so the indices are still valid
+	for (auto rsrcNodeIdx : plan.rsrcNodes)
+		typeinfoMap[rsrcNodeIdx];
+	for (const auto& handle : plan.handles)
+		AssignHandle(typeinfoMap[handle.rsrcNodeIdx], handle.desc, handle.idx);
+
+	csuDHfree = plan.csuDHfree;
+	csuDHused = plan.csuDHused;
+	rtvDHfree = plan.rtvDHfree;
+	rtvDHused = plan.rtvDHused;
+	dsvDHfree = plan.dsvDHfree;
+	dsvDHused = plan.dsvDHused;
+
+	// the aliasing plan (PlanAliasing) is kept across frames
 }
 
 PassRsrcs RsrcMngr::RequestPassRsrcs(ID3D12GraphicsCommandList* cmdList, size_t passNodeIdx) {
+	BarrierList barriers;
+	auto passRsrcs = RequestPassRsrcs(barriers, passNodeIdx);
+	barriers.Record(cmdList);
+	return passRsrcs;
+}
+
+PassRsrcs RsrcMngr::RequestPassRsrcs(BarrierList& barriers, size_t passNodeIdx) {
 	PassRsrcs passRsrc;
 	const auto& rsrcMap = passNodeIdx2rsrcMap[passNodeIdx];
 	for (const auto& [rsrcNodeIdx, state_descs] : rsrcMap) {
@@ -687,11 +1068,24 @@ PassRsrcs RsrcMngr::RequestPassRsrcs(ID3D12GraphicsCommandList* cmdList, size_t
 		auto& view = actives.at(rsrcNodeIdx);
 		auto& typeinfo = typeinfoMap.at(rsrcNodeIdx);
 
-		if (view.state != state) {
-			DirectX::TransitionResource(cmdList, view.pRsrc, view.state, state);
-			view.state = state;
+		// first use of an aliased resource, the memory may hold another resource
+		if (!aliasActivations.empty() && aliasActivations.erase(view.pRsrc) != 0) {
+			barriers.Aliasing(nullptr, view.pRsrc);
+
+			// render targets and depth stencils must be initialized by a clear, a copy or a discard
+			const auto flags = aliasEntries[aliasRsrc2index.at(view.pRsrc)].type.desc.Flags;
+			if ((flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0) {
+				const D3D12_RESOURCE_STATES initState = (flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET) != 0 ?
+					D3D12_RESOURCE_STATE_RENDER_TARGET : D3D12_RESOURCE_STATE_DEPTH_WRITE;
+				barriers.Transition(view.pRsrc, view.state, initState);
+				view.state = initState;
+				barriers.Discard(view.pRsrc);
+			}
 		}
 
+		barriers.Transition(view.pRsrc, view.state, state);
+		view.state = state;
+
 		for (const auto& desc : descs) {
 			std::visit([&, rsrcNodeIdx = rsrcNodeIdx](const auto& desc) {
 				using T = std::decay_t<decltype(desc)>;
@@ -704,10 +1098,14 @@ PassRsrcs RsrcMngr::RequestPassRsrcs(ID3D12GraphicsCommandList* cmdList, size_t
 							assert(desc.BufferLocation == static_cast<D3D12_GPU_VIRTUAL_ADDRESS>(0)
 								|| IsImported(rsrcNodeIdx) && desc.BufferLocation == view.pRsrc->GetGPUVirtualAddress());
 
-							D3D12_CONSTANT_BUFFER_VIEW_DESC bindDesc = desc;
-							bindDesc.BufferLocation = view.pRsrc->GetGPUVirtualAddress();
+							if (!IsImported(rsrcNodeIdx))
+								csuCopyBatch.Add(info.cpuHandle, viewCache.GetOrCreate(view.pRsrc, desc));
+							else {
+								D3D12_CONSTANT_BUFFER_VIEW_DESC bindDesc = desc;
+								bindDesc.BufferLocation = view.pRsrc->GetGPUVirtualAddress();
 
-							device->CreateConstantBufferView(&bindDesc, info.cpuHandle);
+								device->CreateConstantBufferView(&bindDesc, info.cpuHandle);
+							}
 
 							info.init = true;
 						}
@@ -729,7 +1127,10 @@ PassRsrcs RsrcMngr::RequestPassRsrcs(ID3D12GraphicsCommandList* cmdList, size_t
 							else
 								pdesc = nullptr;
 
-							device->CreateShaderResourceView(view.pRsrc, pdesc, info.cpuHandle);
+							if (!IsImported(rsrcNodeIdx))
+								csuCopyBatch.Add(info.cpuHandle, viewCache.GetOrCreate(view.pRsrc, desc));
+							else
+								device->CreateShaderResourceView(view.pRsrc, pdesc, info.cpuHandle);
 
 							info.init = true;
 						}
@@ -752,7 +1153,10 @@ PassRsrcs RsrcMngr::RequestPassRsrcs(ID3D12GraphicsCommandList* cmdList, size_t
 							else
 								pdesc = nullptr;
 
-							device->CreateUnorderedAccessView(view.pRsrc, nullptr, pdesc, info.cpuHandle);
+							if (!IsImported(rsrcNodeIdx))
+								csuCopyBatch.Add(info.cpuHandle, viewCache.GetOrCreate(view.pRsrc, desc));
+							else
+								device->CreateUnorderedAccessView(view.pRsrc, nullptr, pdesc, info.cpuHandle);
 
 							info.init = true;
 						}
@@ -774,7 +1178,10 @@ PassRsrcs RsrcMngr::RequestPassRsrcs(ID3D12GraphicsCommandList* cmdList, size_t
 						else
 							pdesc = nullptr;
 
-						device->CreateRenderTargetView(view.pRsrc, pdesc, info->cpuHandle);
+						if (!IsImported(rsrcNodeIdx))
+							rtvCopyBatch.Add(info->cpuHandle, viewCache.GetOrCreate(view.pRsrc, desc));
+						else
+							device->CreateRenderTargetView(view.pRsrc, pdesc, info->cpuHandle);
 
 						info->init = true;
 					}
@@ -795,7 +1202,10 @@ PassRsrcs RsrcMngr::RequestPassRsrcs(ID3D12GraphicsCommandList* cmdList, size_t
 						else
 							pdesc = nullptr;
 
-						device->CreateDepthStencilView(view.pRsrc, pdesc, info->cpuHandle);
+						if (!IsImported(rsrcNodeIdx))
+							dsvCopyBatch.Add(info->cpuHandle, viewCache.GetOrCreate(view.pRsrc, desc));
+						else
+							device->CreateDepthStencilView(view.pRsrc, pdesc, info->cpuHandle);
 
 						info->init = true;
 					}
@@ -806,6 +1216,12 @@ PassRsrcs RsrcMngr::RequestPassRsrcs(ID3D12GraphicsCommandList* cmdList, size_t
 		}
 		passRsrc.emplace(rsrcNodeIdx, RsrcImpl{ view.pRsrc, &typeinfo });
 	}
+
+	csuCopyBatch.Flush();
+	rtvCopyBatch.Flush();
+	dsvCopyBatch.Flush();
+	viewCache.EndBatch();
+
 	return passRsrc;
 }
 
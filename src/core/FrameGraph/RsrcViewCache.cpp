@@ -0,0 +1,164 @@
+#include <UDX12/FrameGraph/RsrcViewCache.h>
+
+#include <algorithm>
+
+using namespace Ubpa::UDX12::FG;
+using namespace Ubpa::UDX12;
+using namespace Ubpa;
+
+bool RsrcViewCache::Key::operator==(const Key& rhs) const noexcept {
+	if (pRsrc != rhs.pRsrc || desc.index() != rhs.desc.index())
+		return false;
+
+	return std::visit([&](const auto& lhsDesc) {
+		using T = std::decay_t<decltype(lhsDesc)>;
+		if constexpr (std::is_same_v<T, RsrcImplDesc_SRV_NULL>
+			|| std::is_same_v<T, RsrcImplDesc_UAV_NULL>
+			|| std::is_same_v<T, RsrcImplDesc_RTV_Null>
+			|| std::is_same_v<T, RsrcImplDesc_DSV_Null>)
+		{
+			return true;
+		}
+		else
+			return lhsDesc == std::get<T>(rhs.desc);
+	}, desc);
+}
+
+size_t RsrcViewCache::KeyHasher::operator()(const Key& key) const noexcept {
+	size_t rst = std::hash<Rsrc*>{}(key.pRsrc);
+	detail::hash_combine(rst, key.desc.index());
+	std::visit([&](const auto& desc) {
+		using T = std::decay_t<decltype(desc)>;
+		if constexpr (!std::is_same_v<T, RsrcImplDesc_SRV_NULL>
+			&& !std::is_same_v<T, RsrcImplDesc_UAV_NULL>
+			&& !std::is_same_v<T, RsrcImplDesc_RTV_Null>
+			&& !std::is_same_v<T, RsrcImplDesc_DSV_Null>)
+		{
+			detail::hash_combine(rst, desc);
+		}
+	}, key.desc);
+	return rst;
+}
+
+RsrcViewCache::RsrcViewCache(ID3D12Device* device, size_t capacity)
+	: device{ device }, capacity{ capacity }
+{
+	assert(capacity > 0);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE RsrcViewCache::GetOrCreate(Rsrc* pRsrc, const RsrcImplDesc& desc) {
+	assert(pRsrc);
+
+	Key key{ pRsrc, desc };
+	if (auto target = key2entry.find(key); target != key2entry.end()) {
+		lru.splice(lru.begin(), lru, target->second);
+		target->second->batch = curBatch;
+		++stats.numHits;
+		return target->second->allocation.GetCpuHandle();
+	}
+
+	// hits move to the front, so the back is pinned only if all views are pinned
+	while (lru.size() >= capacity && lru.back().batch != curBatch) {
+		Erase(std::prev(lru.end()));
+		++stats.numEvictions;
+	}
+	if (lru.size() >= capacity)
+		++stats.numOverflows;
+
+	UDX12::DescriptorHeapAllocation allocation;
+	std::visit([&](const auto& desc) {
+		using T = std::decay_t<decltype(desc)>;
+		auto& dhMngr = DescriptorHeapMngr::Instance();
+		// CBV
+		if constexpr (std::is_same_v<T, D3D12_CONSTANT_BUFFER_VIEW_DESC>) {
+			allocation = dhMngr.GetCSUCpuDH()->Allocate(1);
+			D3D12_CONSTANT_BUFFER_VIEW_DESC bindDesc = desc;
+			bindDesc.BufferLocation = pRsrc->GetGPUVirtualAddress();
+			device->CreateConstantBufferView(&bindDesc, allocation.GetCpuHandle());
+		}
+		// SRV
+		else if constexpr (std::is_same_v<T, D3D12_SHADER_RESOURCE_VIEW_DESC>) {
+			allocation = dhMngr.GetCSUCpuDH()->Allocate(1);
+			device->CreateShaderResourceView(pRsrc, &desc, allocation.GetCpuHandle());
+		}
+		else if constexpr (std::is_same_v<T, RsrcImplDesc_SRV_NULL>) {
+			allocation = dhMngr.GetCSUCpuDH()->Allocate(1);
+			device->CreateShaderResourceView(pRsrc, nullptr, allocation.GetCpuHandle());
+		}
+		// UAV
+		else if constexpr (std::is_same_v<T, D3D12_UNORDERED_ACCESS_VIEW_DESC>) {
+			allocation = dhMngr.GetCSUCpuDH()->Allocate(1);
+			device->CreateUnorderedAccessView(pRsrc, nullptr, &desc, allocation.GetCpuHandle());
+		}
+		else if constexpr (std::is_same_v<T, RsrcImplDesc_UAV_NULL>) {
+			allocation = dhMngr.GetCSUCpuDH()->Allocate(1);
+			device->CreateUnorderedAccessView(pRsrc, nullptr, nullptr, allocation.GetCpuHandle());
+		}
+		// RTV
+		else if constexpr (std::is_same_v<T, D3D12_RENDER_TARGET_VIEW_DESC>) {
+			allocation = dhMngr.GetRTVCpuDH()->Allocate(1);
+			device->CreateRenderTargetView(pRsrc, &desc, allocation.GetCpuHandle());
+		}
+		else if constexpr (std::is_same_v<T, RsrcImplDesc_RTV_Null>) {
+			allocation = dhMngr.GetRTVCpuDH()->Allocate(1);
+			device->CreateRenderTargetView(pRsrc, nullptr, allocation.GetCpuHandle());
+		}
+		// DSV
+		else if constexpr (std::is_same_v<T, D3D12_DEPTH_STENCIL_VIEW_DESC>) {
+			allocation = dhMngr.GetDSVCpuDH()->Allocate(1);
+			device->CreateDepthStencilView(pRsrc, &desc, allocation.GetCpuHandle());
+		}
+		else if constexpr (std::is_same_v<T, RsrcImplDesc_DSV_Null>) {
+			allocation = dhMngr.GetDSVCpuDH()->Allocate(1);
+			device->CreateDepthStencilView(pRsrc, nullptr, allocation.GetCpuHandle());
+		}
+		else
+			static_assert(always_false_v<T>, "non-exhaustive visitor!");
+	}, desc);
+	++stats.numMisses;
+
+	auto handle = allocation.GetCpuHandle();
+	lru.push_front(Entry{ std::move(key), std::move(allocation), curBatch });
+	key2entry.emplace(lru.front().key, lru.begin());
+	rsrc2entries[pRsrc].push_back(lru.begin());
+	stats.numViews = lru.size();
+
+	return handle;
+}
+
+void RsrcViewCache::Erase(EntryIter iter) {
+	assert(iter->batch != curBatch);
+
+	auto target = rsrc2entries.find(iter->key.pRsrc);
+	assert(target != rsrc2entries.end());
+	auto& entries = target->second;
+	entries.erase(std::find(entries.begin(), entries.end(), iter));
+	if (entries.empty())
+		rsrc2entries.erase(target);
+
+	key2entry.erase(iter->key);
+	lru.erase(iter); // the descriptor returns to its CPU descriptor heap
+	stats.numViews = lru.size();
+}
+
+void RsrcViewCache::Evict(Rsrc* pRsrc) {
+	auto target = rsrc2entries.find(pRsrc);
+	if (target == rsrc2entries.end())
+		return;
+
+	for (auto iter : target->second) {
+		assert(iter->batch != curBatch);
+		key2entry.erase(iter->key);
+		lru.erase(iter);
+		++stats.numEvictions;
+	}
+	rsrc2entries.erase(target);
+	stats.numViews = lru.size();
+}
+
+void RsrcViewCache::Clear() {
+	key2entry.clear();
+	rsrc2entries.clear();
+	lru.clear();
+	stats.numViews = 0;
+}
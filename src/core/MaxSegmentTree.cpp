@@ -0,0 +1,51 @@
+#include <UDX12/MaxSegmentTree.h>
+
+#include <algorithm>
+#include <cassert>
+
+using namespace Ubpa::UDX12;
+
+size_t MaxSegmentTree::Get(size_t idx) const noexcept {
+    assert(idx < numValues);
+    return nodes[numLeaves + idx];
+}
+
+void MaxSegmentTree::PushBack(size_t value) {
+    if (numValues == numLeaves) {
+        // Double the leaves and rebuild the inner nodes
+        size_t newNumLeaves = std::max<size_t>(numLeaves * 2, 1);
+        std::vector<size_t> newNodes(2 * newNumLeaves, 0);
+        std::copy(nodes.begin() + numLeaves, nodes.begin() + numLeaves + numValues, newNodes.begin() + newNumLeaves);
+        for (size_t i = newNumLeaves - 1; i > 0; i--)
+            newNodes[i] = std::max(newNodes[2 * i], newNodes[2 * i + 1]);
+        nodes = std::move(newNodes);
+        numLeaves = newNumLeaves;
+    }
+
+    ++numValues;
+    Set(numValues - 1, value);
+}
+
+void MaxSegmentTree::Set(size_t idx, size_t value) noexcept {
+    assert(idx < numValues);
+    size_t i = numLeaves + idx;
+    nodes[i] = value;
+    for (i /= 2; i > 0; i /= 2) {
+        size_t newMax = std::max(nodes[2 * i], nodes[2 * i + 1]);
+        if (nodes[i] == newMax)
+            break;
+        nodes[i] = newMax;
+    }
+}
+
+size_t MaxSegmentTree::FindFirstNotLess(size_t minValue) const noexcept {
+    if (GetMax() < minValue || numValues == 0)
+        return InvalidIndex;
+
+    size_t i = 1;
+    while (i < numLeaves)
+        i = nodes[2 * i] >= minValue ? 2 * i : 2 * i + 1;
+
+    assert(i - numLeaves < numValues);
+    return i - numLeaves;
+}
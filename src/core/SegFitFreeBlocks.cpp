@@ -0,0 +1,284 @@
+#include <UDX12/SegFitFreeBlocks.h>
+
+#include <bit>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+
+using namespace Ubpa::UDX12;
+
+SegFitFreeBlocks::SegFitFreeBlocks(size_t capacity, size_t secondLevelBits) :
+    begin2block(capacity, InvalidIndex),
+    last2block(capacity, InvalidIndex),
+    secondLevelBits{ secondLevelBits },
+    heads(NumFirstLevels << secondLevelBits, InvalidIndex),
+    maxSizes(NumFirstLevels << secondLevelBits, 0),
+    numMaxSizes(NumFirstLevels << secondLevelBits, 0),
+    slBitmaps(NumFirstLevels, 0)
+{
+    assert("capacity exceeds 32-bit index range" && capacity < std::numeric_limits<Index>::max());
+    assert(secondLevelBits <= MaxSecondLevelBits);
+    // free blocks are never adjacent, so there are at most ceil(capacity / 2) of them
+    blocks.reserve((capacity + 1) / 2);
+}
+
+SegFitFreeBlocks::SegFitFreeBlocks(SegFitFreeBlocks&& rhs) noexcept :
+    blocks{ std::move(rhs.blocks) },
+    begin2block{ std::move(rhs.begin2block) },
+    last2block{ std::move(rhs.last2block) },
+    secondLevelBits{ rhs.secondLevelBits },
+    heads{ std::move(rhs.heads) },
+    maxSizes{ std::move(rhs.maxSizes) },
+    numMaxSizes{ std::move(rhs.numMaxSizes) },
+    slBitmaps{ std::move(rhs.slBitmaps) },
+    flBitmap{ rhs.flBitmap },
+    flNumBlocks{ rhs.flNumBlocks },
+    deadRecords{ rhs.deadRecords },
+    numBlocks{ rhs.numBlocks },
+    numFallbackProbes{ rhs.numFallbackProbes }
+{
+    rhs.secondLevelBits = 0;
+    rhs.flBitmap = 0;
+    rhs.flNumBlocks = {};
+    rhs.deadRecords = InvalidIndex;
+    rhs.numBlocks = 0;
+    rhs.numFallbackProbes = 0;
+}
+
+SegFitFreeBlocks& SegFitFreeBlocks::operator=(SegFitFreeBlocks&& rhs) noexcept {
+    blocks = std::move(rhs.blocks);
+    begin2block = std::move(rhs.begin2block);
+    last2block = std::move(rhs.last2block);
+    secondLevelBits = rhs.secondLevelBits;
+    heads = std::move(rhs.heads);
+    maxSizes = std::move(rhs.maxSizes);
+    numMaxSizes = std::move(rhs.numMaxSizes);
+    slBitmaps = std::move(rhs.slBitmaps);
+    flBitmap = rhs.flBitmap;
+    flNumBlocks = rhs.flNumBlocks;
+    deadRecords = rhs.deadRecords;
+    numBlocks = rhs.numBlocks;
+    numFallbackProbes = rhs.numFallbackProbes;
+
+    rhs.secondLevelBits = 0;
+    rhs.flBitmap = 0;
+    rhs.flNumBlocks = {};
+    rhs.deadRecords = InvalidIndex;
+    rhs.numBlocks = 0;
+    rhs.numFallbackProbes = 0;
+
+    return *this;
+}
+
+SegFitFreeBlocks::SizeClass SegFitFreeBlocks::ClassOf(size_t size) const noexcept {
+    assert(size > 0);
+    // fl : floor(log2(size))
+    // sl : index of the 2^secondLevelBits equal parts of [2^fl, 2^(fl+1)) that contains size
+    //      (sizes below 2^secondLevelBits get a class of their own)
+    size_t fl = static_cast<size_t>(std::bit_width(size)) - 1;
+    size_t sl = fl >= secondLevelBits
+        ? (size >> (fl - secondLevelBits)) - (size_t{ 1 } << secondLevelBits)
+        : (size << (secondLevelBits - fl)) - (size_t{ 1 } << secondLevelBits);
+    return { fl, sl };
+}
+
+SegFitFreeBlocks::SizeClass SegFitFreeBlocks::FitClassOf(size_t size) const noexcept {
+    assert(size > 0);
+    // round size up to the next class boundary, then every block of its class fits
+    size_t fl = static_cast<size_t>(std::bit_width(size)) - 1;
+    if (fl >= secondLevelBits)
+        size += (size_t{ 1 } << (fl - secondLevelBits)) - 1;
+    return ClassOf(size);
+}
+
+SegFitFreeBlocks::Index SegFitFreeBlocks::NewRecord() {
+    if (deadRecords != InvalidIndex) {
+        Index idx = deadRecords;
+        deadRecords = blocks[idx].next;
+        return idx;
+    }
+    assert("record array must not grow beyond the reserved capacity" && blocks.size() < blocks.capacity());
+    blocks.emplace_back();
+    return static_cast<Index>(blocks.size() - 1);
+}
+
+void SegFitFreeBlocks::DeleteRecord(Index idx) noexcept {
+    blocks[idx].size = 0;
+    blocks[idx].prev = InvalidIndex;
+    blocks[idx].next = deadRecords;
+    deadRecords = idx;
+}
+
+void SegFitFreeBlocks::Link(Index idx) noexcept {
+    auto& block = blocks[idx];
+    auto cls = ClassOf(block.size);
+    auto& head = HeadOf(cls);
+    block.prev = InvalidIndex;
+    block.next = head;
+    if (block.next != InvalidIndex)
+        blocks[block.next].prev = idx;
+    head = idx;
+    auto& maxSize = maxSizes[IndexOf(cls)];
+    auto& numMaxSize = numMaxSizes[IndexOf(cls)];
+    if (block.size > maxSize) {
+        maxSize = block.size;
+        numMaxSize = 1;
+    }
+    else if (block.size == maxSize)
+        ++numMaxSize;
+    slBitmaps[cls.fl] |= std::uint32_t{ 1 } << cls.sl;
+    flBitmap |= std::uint64_t{ 1 } << cls.fl;
+    ++flNumBlocks[cls.fl];
+}
+
+void SegFitFreeBlocks::Unlink(Index idx) noexcept {
+    const auto& block = blocks[idx];
+    auto cls = ClassOf(block.size);
+    auto& head = HeadOf(cls);
+    if (block.prev != InvalidIndex)
+        blocks[block.prev].next = block.next;
+    else {
+        assert(head == idx);
+        head = block.next;
+    }
+    if (block.next != InvalidIndex)
+        blocks[block.next].prev = block.prev;
+    --flNumBlocks[cls.fl];
+
+    // the last block of the largest size leaves the class, recompute the maximum
+    auto& maxSize = maxSizes[IndexOf(cls)];
+    auto& numMaxSize = numMaxSizes[IndexOf(cls)];
+    if (block.size == maxSize && --numMaxSize == 0) {
+        maxSize = 0;
+        for (Index i = head; i != InvalidIndex; i = blocks[i].next) {
+            if (blocks[i].size > maxSize) {
+                maxSize = blocks[i].size;
+                numMaxSize = 1;
+            }
+            else if (blocks[i].size == maxSize)
+                ++numMaxSize;
+        }
+    }
+
+    if (head == InvalidIndex) {
+        slBitmaps[cls.fl] &= ~(std::uint32_t{ 1 } << cls.sl);
+        if (slBitmaps[cls.fl] == 0)
+            flBitmap &= ~(std::uint64_t{ 1 } << cls.fl);
+    }
+}
+
+size_t SegFitFreeBlocks::GetLargestBlockSize() const noexcept {
+    if (flBitmap == 0)
+        return 0;
+
+    size_t fl = static_cast<size_t>(std::bit_width(flBitmap)) - 1;
+    size_t sl = static_cast<size_t>(std::bit_width(slBitmaps[fl])) - 1;
+    return maxSizes[IndexOf({ fl, sl })];
+}
+
+SegFitFreeBlocks::Index SegFitFreeBlocks::FindBlockBeginAt(size_t offset) const noexcept {
+    if (offset >= begin2block.size())
+        return InvalidIndex;
+    Index idx = begin2block[offset];
+    if (idx >= blocks.size() || blocks[idx].size == 0 || blocks[idx].offset != offset)
+        return InvalidIndex;
+    return idx;
+}
+
+SegFitFreeBlocks::Index SegFitFreeBlocks::FindBlockEndAt(size_t end) const noexcept {
+    if (end == 0 || end > last2block.size())
+        return InvalidIndex;
+    Index idx = last2block[end - 1];
+    if (idx >= blocks.size() || blocks[idx].size == 0 || blocks[idx].offset + blocks[idx].size != end)
+        return InvalidIndex;
+    return idx;
+}
+
+void SegFitFreeBlocks::Insert(size_t offset, size_t size) {
+    assert(size > 0 && offset + size <= begin2block.size());
+    assert(FindBlockEndAt(offset) == InvalidIndex && FindBlockBeginAt(offset + size) == InvalidIndex);
+
+    Index idx = NewRecord();
+    auto& block = blocks[idx];
+    block.offset = offset;
+    block.size = size;
+    begin2block[offset] = idx;
+    last2block[offset + size - 1] = idx;
+    Link(idx);
+    ++numBlocks;
+}
+
+std::pair<size_t, size_t> SegFitFreeBlocks::Extract(size_t minSize) {
+    assert(minSize > 0);
+
+    Index idx = InvalidIndex;
+
+    // O(1) : the first block of the smallest non-empty class in which every block fits
+    auto fitCls = FitClassOf(minSize);
+    if (fitCls.fl < NumFirstLevels) {
+        std::uint32_t slCandidates = slBitmaps[fitCls.fl] & (~std::uint32_t{ 0 } << fitCls.sl);
+        if (slCandidates != 0)
+            idx = HeadOf({ fitCls.fl, static_cast<size_t>(std::countr_zero(slCandidates)) });
+        else if (fitCls.fl + 1 < NumFirstLevels) {
+            std::uint64_t flCandidates = flBitmap & (~std::uint64_t{ 0 } << (fitCls.fl + 1));
+            if (flCandidates != 0) {
+                size_t fl = static_cast<size_t>(std::countr_zero(flCandidates));
+                idx = HeadOf({ fl, static_cast<size_t>(std::countr_zero(slBitmaps[fl])) });
+            }
+        }
+    }
+
+    // fallback : the class of minSize may still contain a large enough block,
+    // it is walked only if its largest block fits, so the walk always succeeds
+    if (idx == InvalidIndex) {
+        auto cls = ClassOf(minSize);
+        if (maxSizes[IndexOf(cls)] >= minSize) {
+            for (Index i = HeadOf(cls); i != InvalidIndex; i = blocks[i].next) {
+                ++numFallbackProbes;
+                if (blocks[i].size >= minSize) {
+                    idx = i;
+                    break;
+                }
+            }
+            assert(idx != InvalidIndex);
+        }
+    }
+
+    if (idx == InvalidIndex)
+        return { InvalidOffset, 0 };
+
+    Unlink(idx);
+    std::pair<size_t, size_t> rst{ blocks[idx].offset, blocks[idx].size };
+    DeleteRecord(idx);
+    --numBlocks;
+
+    return rst;
+}
+
+void SegFitFreeBlocks::Free(size_t offset, size_t size) {
+    assert(size > 0 && offset + size <= begin2block.size());
+
+    //   PrevBlock.Offset           Offset            NextBlock.Offset
+    //     |                          |                    |
+    //     |<-----PrevBlock.Size----->|<------Size-------->|<-----NextBlock.Size----->|
+    //
+    Index prevIdx = FindBlockEndAt(offset);
+    Index nextIdx = FindBlockBeginAt(offset + size);
+
+    if (prevIdx != InvalidIndex) {
+        Unlink(prevIdx);
+        offset = blocks[prevIdx].offset;
+        size += blocks[prevIdx].size;
+        DeleteRecord(prevIdx);
+        --numBlocks;
+    }
+
+    if (nextIdx != InvalidIndex) {
+        Unlink(nextIdx);
+        size += blocks[nextIdx].size;
+        DeleteRecord(nextIdx);
+        --numBlocks;
+    }
+
+    Insert(offset, size);
+}
@@ -1,6 +1,9 @@
 #include <UDX12/VarSizeAllocMngr.h>
 
 #include <utility>
+#include <algorithm>
+#include <bit>
+#include <tuple>
 #include <cassert>
 #include <type_traits>
 
@@ -32,48 +35,148 @@ namespace Ubpa::UDX12::details {
         // == val & ~(alignment - 1)
         return val & ~(alignment - 1);
     }
+
+    constexpr size_t HistogramBinOf(size_t size) noexcept {
+        assert(size > 0);
+        return static_cast<size_t>(std::bit_width(size)) - 1;
+    }
 }
 
-VarSizeAllocMngr::VarSizeAllocMngr(size_t capacity) :
+VarSizeAllocMngr::VarSizeAllocMngr(size_t capacity, Backend backend) :
+    backend(backend),
     capacity(capacity),
     freeSize(capacity)
 {
+    if (backend == Backend::SegregatedFit)
+        segFitFreeBlocks = SegFitFreeBlocks{ capacity, 0 };
+    else if (backend == Backend::TLSF)
+        segFitFreeBlocks = SegFitFreeBlocks{ capacity, TLSFSecondLevelBits };
+
     // Insert single maximum-size block
-    AddNewBlock(0, capacity);
+    if (capacity > 0)
+        AddNewBlock(0, capacity);
     ResetCurrAlignment();
 }
 
 VarSizeAllocMngr::VarSizeAllocMngr(VarSizeAllocMngr&& rhs) noexcept :
     offset2freeblock{ std::move(rhs.offset2freeblock) },
     size2freeblock{ std::move(rhs.size2freeblock) },
+    treeHistogram{ rhs.treeHistogram },
+    segFitFreeBlocks{ std::move(rhs.segFitFreeBlocks) },
+    backend{ rhs.backend },
     capacity{ rhs.capacity },
     freeSize{ rhs.freeSize },
-    curMinAlignment{ rhs.curMinAlignment }
+    curMinAlignment{ rhs.curMinAlignment },
+    numAllocations{ rhs.numAllocations },
+    peakNumAllocations{ rhs.peakNumAllocations }
 {
+    rhs.treeHistogram = {};
     rhs.capacity = 0;
     rhs.freeSize = 0;
     rhs.curMinAlignment = 0;
+    rhs.numAllocations = 0;
+    rhs.peakNumAllocations = 0;
 }
 
 VarSizeAllocMngr& VarSizeAllocMngr::operator=(VarSizeAllocMngr&& rhs) noexcept {
     offset2freeblock = std::move(rhs.offset2freeblock);
     size2freeblock = std::move(rhs.size2freeblock);
+    treeHistogram = rhs.treeHistogram;
+    segFitFreeBlocks = std::move(rhs.segFitFreeBlocks);
+    backend = rhs.backend;
     capacity = rhs.capacity;
     freeSize = rhs.freeSize;
     curMinAlignment = rhs.curMinAlignment;
+    numAllocations = rhs.numAllocations;
+    peakNumAllocations = rhs.peakNumAllocations;
 
+    rhs.treeHistogram = {};
     rhs.capacity = 0;
     rhs.freeSize = 0;
     rhs.curMinAlignment = 0;
+    rhs.numAllocations = 0;
+    rhs.peakNumAllocations = 0;
 
     return *this;
 }
 
+size_t VarSizeAllocMngr::GetNumFreeBlocks() const noexcept {
+    if (backend != Backend::Tree)
+        return segFitFreeBlocks.GetNumBlocks();
+    else
+        return offset2freeblock.size();
+}
+
+size_t VarSizeAllocMngr::GetLargestFreeBlockSize() const noexcept {
+    if (backend != Backend::Tree)
+        return segFitFreeBlocks.GetLargestBlockSize();
+    else
+        return size2freeblock.empty() ? 0 : size2freeblock.rbegin()->first;
+}
+
+VarSizeAllocMngr::Stats VarSizeAllocMngr::GetStats() const noexcept {
+    Stats stats;
+    stats.capacity = capacity;
+    stats.freeSize = freeSize;
+    stats.largestFreeBlock = GetLargestFreeBlockSize();
+    stats.numFreeBlocks = GetNumFreeBlocks();
+    if (backend != Backend::Tree) {
+        for (size_t i = 0; i < NumHistogramBins; i++)
+            stats.freeBlockHistogram[i] = segFitFreeBlocks.GetNumBlocksOfFirstLevel(i);
+    }
+    else
+        stats.freeBlockHistogram = treeHistogram;
+    stats.fragmentation = freeSize > 0
+        ? 1. - static_cast<double>(stats.largestFreeBlock) / static_cast<double>(freeSize)
+        : 0.;
+    stats.numAllocations = numAllocations;
+    stats.peakNumAllocations = peakNumAllocations;
+    return stats;
+}
+
+std::string VarSizeAllocMngr::DumpFreeBlocks(bool json) const {
+    std::vector<std::pair<size_t, size_t>> freeBlocks; // offset, size
+    freeBlocks.reserve(GetNumFreeBlocks());
+    if (backend != Backend::Tree) {
+        segFitFreeBlocks.ForEachBlock([&](size_t offset, size_t size) { freeBlocks.emplace_back(offset, size); });
+        std::sort(freeBlocks.begin(), freeBlocks.end());
+    }
+    else {
+        for (const auto& [offset, info] : offset2freeblock)
+            freeBlocks.emplace_back(offset, info.size);
+    }
+
+    std::string rst;
+    if (json) {
+        rst += "{\"capacity\":" + std::to_string(capacity) + ",\"freeSize\":" + std::to_string(freeSize) + ",\"blocks\":[";
+        for (size_t i = 0; i < freeBlocks.size(); i++) {
+            if (i > 0)
+                rst += ',';
+            rst += "{\"offset\":" + std::to_string(freeBlocks[i].first) + ",\"size\":" + std::to_string(freeBlocks[i].second) + '}';
+        }
+        rst += "]}";
+    }
+    else {
+        for (size_t i = 0; i < freeBlocks.size(); i++) {
+            if (i > 0)
+                rst += ' ';
+            rst += '[' + std::to_string(freeBlocks[i].first) + ", " + std::to_string(freeBlocks[i].first + freeBlocks[i].second) + ')';
+        }
+    }
+    return rst;
+}
+
 void VarSizeAllocMngr::AddNewBlock(size_t Offset, size_t Size) {
+    if (backend != Backend::Tree) {
+        segFitFreeBlocks.Insert(Offset, Size);
+        return;
+    }
+
     auto [newBlockIter, success] = offset2freeblock.emplace(Offset, Size);
     assert(success);
     auto orderIter = size2freeblock.emplace(Size, newBlockIter);
     newBlockIter->second.OrderBySizeIt = orderIter;
+    ++treeHistogram[details::HistogramBinOf(Size)];
 }
 
 void VarSizeAllocMngr::ResetCurrAlignment() noexcept {
@@ -90,39 +193,79 @@ VarSizeAllocMngr::Allocation VarSizeAllocMngr::Allocate(size_t size, size_t alig
         return Allocation::Invalid();
 
     auto alignmentReserve = (alignment > curMinAlignment) ? alignment - curMinAlignment : 0;
-    // Get the first block that is large enough to encompass size + alignmentReserve bytes
-    // lower_bound() returns an iterator pointing to the first element that
-    // is not less (i.e. >= ) than key
-    auto SmallestBlockItIt = size2freeblock.lower_bound(size + alignmentReserve);
-    if (SmallestBlockItIt == size2freeblock.end())
+    // Get a block that is large enough to encompass size + alignmentReserve bytes
+    auto [blockOffset, blockSize] = ExtractBlock(size + alignmentReserve);
+    if (blockOffset == Allocation::InvalidOffset)
         return Allocation::Invalid();
 
-    auto SmallestBlockIt = SmallestBlockItIt->second;
-    assert(size + alignmentReserve <= SmallestBlockIt->second.size);
-    assert(SmallestBlockIt->second.size == SmallestBlockItIt->first);
+    auto allocation = CarveBlock(blockOffset, blockSize, size, alignment);
+    if (blockSize > 0)
+        AddNewBlock(blockOffset, blockSize);
+
+    return allocation;
+}
+
+void VarSizeAllocMngr::AllocateBatch(std::span<const Request> requests, std::span<Allocation> allocations) {
+    assert(requests.size() == allocations.size());
+
+    // Remainder of the last extracted block, it stays out of the free block index
+    // as long as the following requests fit in it
+    size_t blockOffset = Allocation::InvalidOffset;
+    size_t blockSize = 0;
+
+    for (size_t i = 0; i < requests.size(); i++) {
+        auto [size, alignment] = requests[i];
+        assert(size > 0);
+        assert("alignment must be power of 2" && details::IsPowerOfTwo(alignment));
+        size = details::Align(size, alignment);
+        if (freeSize < size) {
+            allocations[i] = Allocation::Invalid();
+            continue;
+        }
+
+        auto alignmentReserve = (alignment > curMinAlignment) ? alignment - curMinAlignment : 0;
+        if (blockSize < size + alignmentReserve) {
+            // Return the remainder first, so that it takes part in the search
+            if (blockSize > 0)
+                AddNewBlock(blockOffset, blockSize);
+            std::tie(blockOffset, blockSize) = ExtractBlock(size + alignmentReserve);
+            if (blockOffset == Allocation::InvalidOffset) {
+                blockSize = 0;
+                allocations[i] = Allocation::Invalid();
+                continue;
+            }
+        }
+
+        allocations[i] = CarveBlock(blockOffset, blockSize, size, alignment);
+    }
+
+    if (blockSize > 0)
+        AddNewBlock(blockOffset, blockSize);
+}
 
-    //     SmallestBlockIt.Offset
+VarSizeAllocMngr::Allocation VarSizeAllocMngr::CarveBlock(size_t& blockOffset, size_t& blockSize, size_t size, size_t alignment) {
+    auto alignmentReserve = (alignment > curMinAlignment) ? alignment - curMinAlignment : 0;
+    assert(size + alignmentReserve <= blockSize);
+
+    //       blockOffset
     //        |                                  |
-    //        |<------SmallestBlockIt.size------>|
+    //        |<------------blockSize----------->|
     //        |<------size------>|<---newSize--->|
     //        |                  |
-    //      offset              newOffset
+    //      offset              newOffset (blockOffset on return)
     //
-    auto offset = SmallestBlockIt->first;
+    auto offset = blockOffset;
     assert(offset % curMinAlignment == 0);
     auto alignedOffset = details::Align(offset, alignment);
     auto adjustedSize = size + (alignedOffset - offset);
     assert(adjustedSize <= size + alignmentReserve);
 
-    auto newOffset = offset + adjustedSize;
-    auto newSize = SmallestBlockIt->second.size - adjustedSize;
-    assert(SmallestBlockItIt == SmallestBlockIt->second.OrderBySizeIt);
-    size2freeblock.erase(SmallestBlockItIt);
-    offset2freeblock.erase(SmallestBlockIt);
-    if (newSize > 0)
-        AddNewBlock(newOffset, newSize);
+    blockOffset = offset + adjustedSize;
+    blockSize -= adjustedSize;
 
     freeSize -= adjustedSize;
+    ++numAllocations;
+    peakNumAllocations = std::max(peakNumAllocations, numAllocations);
 
     if ((size & (curMinAlignment - 1)) != 0) {
         if (details::IsPowerOfTwo(size)) {
@@ -135,9 +278,74 @@ VarSizeAllocMngr::Allocation VarSizeAllocMngr::Allocate(size_t size, size_t alig
     return Allocation{ offset, adjustedSize };
 }
 
+std::pair<size_t, size_t> VarSizeAllocMngr::ExtractBlock(size_t minSize) {
+    if (backend != Backend::Tree)
+        return segFitFreeBlocks.Extract(minSize);
+
+    // Get the first block that is large enough to encompass minSize bytes
+    // lower_bound() returns an iterator pointing to the first element that
+    // is not less (i.e. >= ) than key
+    auto SmallestBlockItIt = size2freeblock.lower_bound(minSize);
+    if (SmallestBlockItIt == size2freeblock.end())
+        return { Allocation::InvalidOffset, 0 };
+
+    auto SmallestBlockIt = SmallestBlockItIt->second;
+    assert(SmallestBlockIt->second.size == SmallestBlockItIt->first);
+    assert(SmallestBlockItIt == SmallestBlockIt->second.OrderBySizeIt);
+
+    std::pair<size_t, size_t> rst{ SmallestBlockIt->first, SmallestBlockIt->second.size };
+    --treeHistogram[details::HistogramBinOf(rst.second)];
+    size2freeblock.erase(SmallestBlockItIt);
+    offset2freeblock.erase(SmallestBlockIt);
+    return rst;
+}
+
 void VarSizeAllocMngr::Free(size_t offset, size_t size) {
+    assert(numAllocations > 0);
+    FreeRange(offset, size);
+    --numAllocations;
+}
+
+void VarSizeAllocMngr::FreeRange(size_t offset, size_t size) {
     assert(offset + size <= capacity);
 
+    if (backend != Backend::Tree)
+        segFitFreeBlocks.Free(offset, size);
+    else
+        FreeTreeBlock(offset, size);
+
+    freeSize += size;
+    if (IsEmpty()) {
+        // Reset current alignment
+        assert(GetNumFreeBlocks() == 1);
+        ResetCurrAlignment();
+    }
+}
+
+void VarSizeAllocMngr::FreeBatch(std::span<const Allocation> allocations) {
+    batchScratch.assign(allocations.begin(), allocations.end());
+    std::sort(batchScratch.begin(), batchScratch.end(), [](const Allocation& lhs, const Allocation& rhs) {
+        return lhs.unalignedOffset < rhs.unalignedOffset;
+    });
+
+    size_t i = 0;
+    while (i < batchScratch.size()) {
+        assert(batchScratch[i].IsValid());
+        size_t offset = batchScratch[i].unalignedOffset;
+        size_t size = batchScratch[i].size;
+        // Merge the following allocations as long as they are adjacent
+        for (++i; i < batchScratch.size() && batchScratch[i].unalignedOffset == offset + size; ++i)
+            size += batchScratch[i].size;
+        FreeRange(offset, size);
+    }
+
+    assert(numAllocations >= allocations.size());
+    numAllocations -= allocations.size();
+
+    batchScratch.clear();
+}
+
+void VarSizeAllocMngr::FreeTreeBlock(size_t offset, size_t size) {
     // Find the first element whose offset is greater than the specified offset.
     // upper_bound() returns an iterator pointing to the first element in the
     // container whose key is considered to go after k.
@@ -170,6 +378,8 @@ void VarSizeAllocMngr::Free(size_t offset, size_t size) {
             //     |<-----PrevBlock.Size----->|<------Size-------->|<-----NextBlock.Size----->|
             //
             newSize += nextBlockIt->second.size;
+            --treeHistogram[details::HistogramBinOf(prevBlockIt->second.size)];
+            --treeHistogram[details::HistogramBinOf(nextBlockIt->second.size)];
             size2freeblock.erase(prevBlockIt->second.OrderBySizeIt);
             size2freeblock.erase(nextBlockIt->second.OrderBySizeIt);
             // Delete the range of two blocks
@@ -182,6 +392,7 @@ void VarSizeAllocMngr::Free(size_t offset, size_t size) {
             //     |                          |                             |
             //     |<-----PrevBlock.Size----->|<------Size-------->| ~ ~ ~  |<-----NextBlock.Size----->|
             //
+            --treeHistogram[details::HistogramBinOf(prevBlockIt->second.size)];
             size2freeblock.erase(prevBlockIt->second.OrderBySizeIt);
             offset2freeblock.erase(prevBlockIt);
         }
@@ -194,6 +405,7 @@ void VarSizeAllocMngr::Free(size_t offset, size_t size) {
         //
         newSize = size + nextBlockIt->second.size;
         newOffset = offset;
+        --treeHistogram[details::HistogramBinOf(nextBlockIt->second.size)];
         size2freeblock.erase(nextBlockIt->second.OrderBySizeIt);
         offset2freeblock.erase(nextBlockIt);
     }
@@ -208,11 +420,4 @@ void VarSizeAllocMngr::Free(size_t offset, size_t size) {
     }
 
     AddNewBlock(newOffset, newSize);
-
-    freeSize += size;
-    if (IsEmpty()) {
-        // Reset current alignment
-        assert(offset2freeblock.size() == 1);
-        ResetCurrAlignment();
-    }
 }
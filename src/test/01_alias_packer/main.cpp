@@ -0,0 +1,154 @@
+#include "../headless/Check.h"
+
+#include <UDX12/FrameGraph/RsrcAliasPacker.h>
+
+#include <random>
+
+using namespace Ubpa::UDX12::FG;
+
+using Item = RsrcAliasPacker::Item;
+
+constexpr uint64_t KB = 1024;
+constexpr uint64_t MB = 1024 * KB;
+
+// checks the placement, returns the unaliased size (sum of the sizes)
+static uint64_t Verify(const std::vector<Item>& items, const std::vector<uint64_t>& offsets, uint64_t heapSize) {
+	UDX12_CHECK(offsets.size() == items.size());
+
+	uint64_t unaliasedSize = 0;
+	for (size_t i = 0; i < items.size(); i++) {
+		// alignment is honoured and the item is inside the heap
+		UDX12_CHECK(offsets[i] % items[i].alignment == 0);
+		UDX12_CHECK(offsets[i] + items[i].size <= heapSize);
+		unaliasedSize += items[i].size;
+
+		// items alive at the same time never share bytes
+		for (size_t j = i + 1; j < items.size(); j++) {
+			if (!RsrcAliasPacker::Overlap(items[i], items[j]))
+				continue;
+			bool disjoint = offsets[i] + items[i].size <= offsets[j] || offsets[j] + items[j].size <= offsets[i];
+			UDX12_CHECK(disjoint);
+		}
+	}
+	return unaliasedSize;
+}
+
+// resource i lives in passes [i, i + 1], so at most two resources are alive at the same time
+static void TestChain() {
+	RsrcAliasPacker packer;
+	std::vector<Item> items;
+	for (size_t i = 0; i < 8; i++)
+		items.push_back({ i, i + 1, 4 * MB, 64 * KB });
+
+	std::vector<uint64_t> offsets;
+	uint64_t heapSize = packer.Pack(items, offsets);
+	uint64_t unaliasedSize = Verify(items, offsets, heapSize);
+
+	UDX12_CHECK(heapSize == 2 * 4 * MB);
+	UDX12_CHECK(heapSize < unaliasedSize);
+}
+
+// G-buffer (3 RTs) -> lighting -> tone mapping -> post, the G-buffer is dead after the lighting pass
+static void TestDeferred() {
+	RsrcAliasPacker packer;
+	std::vector<Item> items = {
+		{ 0, 1, 8 * MB, 64 * KB }, // albedo
+		{ 0, 1, 8 * MB, 64 * KB }, // normal
+		{ 0, 1, 8 * MB, 64 * KB }, // material
+		{ 1, 2, 8 * MB, 64 * KB }, // lighting
+		{ 2, 3, 8 * MB, 64 * KB }, // tone mapped
+	};
+
+	std::vector<uint64_t> offsets;
+	uint64_t heapSize = packer.Pack(items, offsets);
+	uint64_t unaliasedSize = Verify(items, offsets, heapSize);
+
+	// 4 RTs are alive in the lighting pass
+	UDX12_CHECK(heapSize == 4 * 8 * MB);
+	UDX12_CHECK(heapSize < unaliasedSize);
+}
+
+// all lifetimes overlap, nothing can be aliased
+static void TestNoAliasing() {
+	RsrcAliasPacker packer;
+	std::vector<Item> items = {
+		{ 0, 3, 2 * MB, 64 * KB },
+		{ 1, 2, 1 * MB, 64 * KB },
+		{ 2, 5, 4 * MB, 64 * KB },
+	};
+
+	std::vector<uint64_t> offsets;
+	uint64_t heapSize = packer.Pack(items, offsets);
+	uint64_t unaliasedSize = Verify(items, offsets, heapSize);
+
+	UDX12_CHECK(heapSize == unaliasedSize);
+
+	UDX12_CHECK(packer.Pack({}, offsets) == 0 && offsets.empty());
+}
+
+// an item with a large alignment can't take the unaligned space after another item,
+// the padding may even make the heap larger than the unaliased sum
+static void TestAlignment() {
+	RsrcAliasPacker packer;
+	std::vector<Item> items = {
+		{ 0, 1, 64 * KB + 4 * KB, 4 * KB },
+		{ 0, 1, 64 * KB, 4 * MB },
+		{ 2, 3, 4 * KB, 4 * KB },
+	};
+
+	std::vector<uint64_t> offsets;
+	uint64_t heapSize = packer.Pack(items, offsets);
+	Verify(items, offsets, heapSize);
+
+	UDX12_CHECK(offsets[1] % (4 * MB) == 0);
+	UDX12_CHECK(heapSize == 4 * MB + 64 * KB);
+}
+
+// random graphs : lifetimes in [0, numPasses), sizes and alignments of buffers, textures and MSAA textures
+static void TestRandom() {
+	std::mt19937_64 rng{ 42 };
+	constexpr uint64_t alignments[] = { 4 * KB, 64 * KB, 4 * MB };
+
+	RsrcAliasPacker packer;
+	std::vector<Item> items;
+	std::vector<uint64_t> offsets;
+	uint64_t totalHeapSize = 0;
+	uint64_t totalUnaliasedSize = 0;
+	for (size_t graph = 0; graph < 500; graph++) {
+		const size_t numPasses = std::uniform_int_distribution<size_t>{ 1, 32 }(rng);
+		const size_t numItems = std::uniform_int_distribution<size_t>{ 1, 64 }(rng);
+
+		items.clear();
+		for (size_t i = 0; i < numItems; i++) {
+			size_t first = std::uniform_int_distribution<size_t>{ 0, numPasses - 1 }(rng);
+			size_t last = std::uniform_int_distribution<size_t>{ first, std::min(first + 4, numPasses - 1) }(rng);
+			uint64_t alignment = alignments[std::uniform_int_distribution<size_t>{ 0, 2 }(rng)];
+			uint64_t size = std::uniform_int_distribution<uint64_t>{ 1, 16 * MB }(rng);
+			size = (size + alignment - 1) & ~(alignment - 1);
+			items.push_back({ first, last, size, alignment });
+		}
+
+		uint64_t heapSize = packer.Pack(items, offsets);
+		totalUnaliasedSize += Verify(items, offsets, heapSize);
+		totalHeapSize += heapSize;
+	}
+
+	std::printf("random graphs : heap %llu MB, unaliased %llu MB (%.1f%%)\n",
+		static_cast<unsigned long long>(totalHeapSize / MB),
+		static_cast<unsigned long long>(totalUnaliasedSize / MB),
+		100. * static_cast<double>(totalHeapSize) / static_cast<double>(totalUnaliasedSize));
+
+	// short lifetimes over many passes, most resources share memory
+	UDX12_CHECK(totalHeapSize < totalUnaliasedSize);
+}
+
+int main() {
+	TestChain();
+	TestDeferred();
+	TestNoAliasing();
+	TestAlignment();
+	TestRandom();
+
+	std::printf("alias packer : ok\n");
+	return 0;
+}
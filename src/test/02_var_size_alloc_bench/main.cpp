@@ -0,0 +1,125 @@
+#include "../headless/Check.h"
+
+#include <UDX12/VarSizeAllocMngr.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <random>
+
+using namespace Ubpa::UDX12;
+
+using Backend = VarSizeAllocMngr::Backend;
+using Allocation = VarSizeAllocMngr::Allocation;
+
+constexpr size_t Capacity = 1 << 24;
+constexpr size_t NumOps = 1 << 20;
+
+static const char* NameOf(Backend backend) {
+	switch (backend) {
+	case Backend::Tree: return "Tree";
+	case Backend::SegregatedFit: return "SegregatedFit";
+	case Backend::TLSF: return "TLSF";
+	default: return "?";
+	}
+}
+
+// live allocations never overlap
+static void CheckDisjoint(std::vector<Allocation> live) {
+	std::sort(live.begin(), live.end(), [](const Allocation& lhs, const Allocation& rhs) {
+		return lhs.unalignedOffset < rhs.unalignedOffset;
+	});
+	for (size_t i = 1; i < live.size(); i++)
+		UDX12_CHECK(live[i - 1].unalignedOffset + live[i - 1].size <= live[i].unalignedOffset);
+}
+
+// frees everything, the manager must be back to one free block
+static void CheckEmpty(VarSizeAllocMngr& mngr, std::vector<Allocation>& live) {
+	for (auto& allocation : live)
+		mngr.Free(std::move(allocation));
+	live.clear();
+	UDX12_CHECK(mngr.IsEmpty());
+	UDX12_CHECK(mngr.GetNumFreeBlocks() == 1);
+	UDX12_CHECK(mngr.GetNumAllocations() == 0);
+}
+
+static size_t RandomSize(std::mt19937& rng) {
+	// mostly small (descriptor tables), sometimes large (buffers)
+	if (rng() % 16 == 0)
+		return std::uniform_int_distribution<size_t>{ 1024, 16 * 1024 }(rng);
+	return std::uniform_int_distribution<size_t>{ 1, 256 }(rng);
+}
+
+// random allocations and frees around half of the capacity
+static double RandomPattern(Backend backend, double& fragmentation) {
+	VarSizeAllocMngr mngr{ Capacity, backend };
+	std::mt19937 rng{ 1 };
+	std::vector<Allocation> live;
+
+	auto begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < NumOps; i++) {
+		if (live.empty() || (mngr.GetUsedSize() < Capacity / 2 && rng() % 2 == 0)) {
+			size_t alignment = size_t{ 1 } << (rng() % 5);
+			size_t size = RandomSize(rng);
+			auto allocation = mngr.Allocate(size, alignment);
+			UDX12_CHECK(allocation.IsValid());
+			// the allocation includes the padding that aligns its offset
+			size_t alignedOffset = (allocation.unalignedOffset + alignment - 1) & ~(alignment - 1);
+			UDX12_CHECK(alignedOffset + size <= allocation.unalignedOffset + allocation.size);
+			live.push_back(allocation);
+		}
+		else {
+			size_t idx = rng() % live.size();
+			std::swap(live[idx], live.back());
+			mngr.Free(std::move(live.back()));
+			live.pop_back();
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	fragmentation = mngr.GetStats().fragmentation;
+	CheckDisjoint(live);
+	CheckEmpty(mngr, live);
+
+	return std::chrono::duration<double, std::nano>(end - begin).count() / NumOps;
+}
+
+// ring-like usage : per-frame allocations freed in order a few frames later
+static double FIFOPattern(Backend backend, double& fragmentation) {
+	VarSizeAllocMngr mngr{ Capacity, backend };
+	std::mt19937 rng{ 2 };
+	std::deque<Allocation> live;
+
+	auto begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < NumOps; i++) {
+		if (live.size() < 4096) {
+			auto allocation = mngr.Allocate(RandomSize(rng), 1);
+			UDX12_CHECK(allocation.IsValid());
+			live.push_back(allocation);
+		}
+		else {
+			mngr.Free(std::move(live.front()));
+			live.pop_front();
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	fragmentation = mngr.GetStats().fragmentation;
+	std::vector<Allocation> rest(live.begin(), live.end());
+	CheckDisjoint(rest);
+	CheckEmpty(mngr, rest);
+
+	return std::chrono::duration<double, std::nano>(end - begin).count() / NumOps;
+}
+
+int main() {
+	std::printf("%-14s %12s %8s %12s %8s\n", "backend", "random ns/op", "frag", "FIFO ns/op", "frag");
+	for (auto backend : { Backend::Tree, Backend::SegregatedFit, Backend::TLSF }) {
+		double randomFragmentation, fifoFragmentation;
+		double randomTime = RandomPattern(backend, randomFragmentation);
+		double fifoTime = FIFOPattern(backend, fifoFragmentation);
+		std::printf("%-14s %12.1f %8.3f %12.1f %8.3f\n",
+			NameOf(backend), randomTime, randomFragmentation, fifoTime, fifoFragmentation);
+	}
+	return 0;
+}
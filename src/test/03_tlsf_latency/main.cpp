@@ -0,0 +1,174 @@
+#include "../headless/Check.h"
+
+#include <UDX12/SegFitFreeBlocks.h>
+#include <UDX12/VarSizeAllocMngr.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+using namespace Ubpa::UDX12;
+
+using Backend = VarSizeAllocMngr::Backend;
+using Allocation = VarSizeAllocMngr::Allocation;
+
+// free holes of HoleSize units, separated by allocated spacers of 1 unit
+//
+//  |<--hole-->|s|<--hole-->|s| ... |<--hole-->|s|
+//
+// A request in (HoleSize, end of the class of HoleSize) has no class in which every block fits,
+// so it falls back to the class of the holes, which holds every free block.
+constexpr size_t HoleSize = 256;
+constexpr size_t NumOps = 1 << 16;
+
+struct Latency {
+	size_t numHoles;
+	double p50, p99, p999, max; // ns
+};
+
+// The latencies are only reported, the checks are on the results and the number of blocks
+// Extract() walks, which do not depend on the machine.
+static Latency Measure(size_t secondLevelBits, size_t numHoles) {
+	SegFitFreeBlocks freeBlocks{ numHoles * (HoleSize + 1), secondLevelBits };
+	for (size_t i = 0; i < numHoles; i++)
+		freeBlocks.Insert(i * (HoleSize + 1), HoleSize);
+	UDX12_CHECK(freeBlocks.GetNumBlocks() == numHoles);
+	UDX12_CHECK(freeBlocks.GetLargestBlockSize() == HoleSize);
+
+	// half of the requests fit in a hole, the other half has no fitting block
+	std::mt19937 rng{ 3 };
+	std::vector<double> times(NumOps);
+	for (size_t i = 0; i < NumOps; i++) {
+		size_t size = rng() % 2 == 0
+			? std::uniform_int_distribution<size_t>{ 1, HoleSize }(rng)
+			: std::uniform_int_distribution<size_t>{ HoleSize + 1, HoleSize + 8 }(rng);
+
+		auto begin = std::chrono::steady_clock::now();
+		auto [offset, blockSize] = freeBlocks.Extract(size);
+		bool valid = offset != SegFitFreeBlocks::InvalidOffset;
+		if (valid)
+			freeBlocks.Free(offset, blockSize);
+		auto end = std::chrono::steady_clock::now();
+
+		UDX12_CHECK(valid == (size <= HoleSize));
+		UDX12_CHECK(!valid || blockSize == HoleSize);
+		times[i] = std::chrono::duration<double, std::nano>(end - begin).count();
+	}
+	UDX12_CHECK(freeBlocks.GetNumBlocks() == numHoles);
+	// the largest hole is smaller than every failing request, so the class of the holes is never walked
+	UDX12_CHECK(freeBlocks.GetNumFallbackProbes() == 0);
+
+	Latency latency;
+	latency.numHoles = numHoles;
+	std::sort(times.begin(), times.end());
+	latency.p50 = times[NumOps / 2];
+	latency.p99 = times[NumOps * 99 / 100];
+	latency.p999 = times[NumOps * 999 / 1000];
+	latency.max = times.back();
+	return latency;
+}
+
+static void RunLatency(size_t secondLevelBits, const char* name) {
+	std::printf("%s\n", name);
+	std::printf("%10s %10s %10s %10s %10s\n", "holes", "p50 ns", "p99 ns", "p999 ns", "max ns");
+	for (size_t numHoles = 256; numHoles <= 16384; numHoles *= 4) {
+		auto latency = Measure(secondLevelBits, numHoles);
+		std::printf("%10zu %10.0f %10.0f %10.0f %10.0f\n",
+			latency.numHoles, latency.p50, latency.p99, latency.p999, latency.max);
+	}
+}
+
+// holes of 40, 41, 42, 43 and 60 units in one power-of-two class, the 60 one freed first (last in its list) :
+// a request of 50 has no class in which every block fits and must find the 60 one behind the others
+static void TestDeepBlock(Backend backend) {
+	constexpr size_t sizes[] = { 60, 40, 41, 42, 43 };
+	size_t capacity = 0;
+	for (size_t size : sizes)
+		capacity += size + 1;
+	VarSizeAllocMngr mngr{ capacity, backend };
+
+	std::vector<Allocation> holes;
+	std::vector<Allocation> spacers;
+	for (size_t size : sizes) {
+		holes.push_back(mngr.Allocate(size, 1));
+		spacers.push_back(mngr.Allocate(1, 1));
+	}
+	UDX12_CHECK(mngr.IsFull());
+	const size_t offset60 = holes.front().unalignedOffset;
+	for (auto& hole : holes)
+		mngr.Free(std::move(hole));
+
+	UDX12_CHECK(mngr.GetLargestFreeBlockSize() == 60);
+	UDX12_CHECK(mngr.GetStats().largestFreeBlock == 60);
+	auto allocation = mngr.Allocate(50, 1);
+	UDX12_CHECK(allocation.IsValid() && allocation.unalignedOffset == offset60);
+	UDX12_CHECK(mngr.GetLargestFreeBlockSize() == 43);
+	UDX12_CHECK(!mngr.Allocate(44, 1).IsValid());
+
+	mngr.Free(std::move(allocation));
+	for (auto& spacer : spacers)
+		mngr.Free(std::move(spacer));
+	UDX12_CHECK(mngr.IsEmpty());
+}
+
+// random allocations and frees, checked against a map of the used units :
+// GetLargestFreeBlockSize() is the longest free run and a request succeeds if and only if it is not larger
+static void TestRandom(Backend backend) {
+	constexpr size_t Capacity = 4096;
+	constexpr size_t NumRandomOps = 1 << 13;
+	VarSizeAllocMngr mngr{ Capacity, backend };
+	std::vector<bool> used(Capacity, false);
+
+	std::mt19937 rng{ 7 };
+	std::vector<Allocation> allocations;
+	for (size_t i = 0; i < NumRandomOps; i++) {
+		if (allocations.empty() || rng() % 3 != 0) {
+			size_t size = std::uniform_int_distribution<size_t>{ 1, 96 }(rng);
+			size_t largest = mngr.GetLargestFreeBlockSize();
+			auto allocation = mngr.Allocate(size, 1);
+			UDX12_CHECK(allocation.IsValid() == (size <= largest));
+			if (allocation.IsValid()) {
+				for (size_t u = 0; u < allocation.size; u++) {
+					UDX12_CHECK(!used[allocation.unalignedOffset + u]);
+					used[allocation.unalignedOffset + u] = true;
+				}
+				allocations.push_back(std::move(allocation));
+			}
+		}
+		else {
+			size_t idx = rng() % allocations.size();
+			for (size_t u = 0; u < allocations[idx].size; u++)
+				used[allocations[idx].unalignedOffset + u] = false;
+			mngr.Free(std::move(allocations[idx]));
+			allocations[idx] = std::move(allocations.back());
+			allocations.pop_back();
+		}
+
+		size_t largest = 0;
+		size_t run = 0;
+		for (bool u : used) {
+			run = u ? 0 : run + 1;
+			largest = std::max(largest, run);
+		}
+		UDX12_CHECK(mngr.GetLargestFreeBlockSize() == largest);
+	}
+
+	for (auto& allocation : allocations)
+		mngr.Free(std::move(allocation));
+	UDX12_CHECK(mngr.IsEmpty());
+	UDX12_CHECK(mngr.GetLargestFreeBlockSize() == Capacity);
+}
+
+int main() {
+	TestDeepBlock(Backend::SegregatedFit);
+	TestDeepBlock(Backend::TLSF);
+	std::printf("deep block : ok\n");
+
+	TestRandom(Backend::SegregatedFit);
+	TestRandom(Backend::TLSF);
+	std::printf("random : ok\n");
+
+	RunLatency(0, "SegregatedFit");
+	RunLatency(VarSizeAllocMngr::TLSFSecondLevelBits, "TLSF");
+	return 0;
+}
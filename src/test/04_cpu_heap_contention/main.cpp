@@ -0,0 +1,97 @@
+#include "../headless/Check.h"
+#include "../headless/StubDevice.h"
+
+#include <UDX12/DescriptorHeap/CPUDescriptorHeap.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+
+using namespace Ubpa::UDX12;
+
+constexpr size_t NumOpsPerThread = 1 << 15;
+constexpr size_t NumLivePerThread = 32;
+
+struct Range {
+	SIZE_T begin, end;
+};
+
+// every thread allocates 1 to MaxCachedCount descriptors (views of one resource) and frees a random live allocation,
+// returns the allocations (and frees) per second over all threads
+static double Run(CPUDescriptorHeap& heap, size_t numThreads, std::vector<Range>& liveRanges) {
+	std::vector<std::vector<DescriptorHeapAllocation>> live(numThreads);
+
+	auto worker = [&](size_t threadIdx) {
+		std::mt19937 rng{ static_cast<unsigned>(threadIdx) };
+		auto& allocations = live[threadIdx];
+		for (size_t i = 0; i < NumOpsPerThread; i++) {
+			if (allocations.size() == NumLivePerThread) {
+				size_t idx = rng() % allocations.size();
+				std::swap(allocations[idx], allocations.back());
+				heap.Free(std::move(allocations.back()));
+				allocations.pop_back();
+			}
+			uint32_t count = 1 + rng() % CPUDescriptorHeap::MaxCachedCount;
+			auto allocation = heap.Allocate(count);
+			UDX12_CHECK(!allocation.IsNull() && allocation.GetNumHandles() == count);
+			allocations.push_back(std::move(allocation));
+		}
+	};
+
+	auto begin = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < numThreads; i++)
+		threads.emplace_back(worker, i);
+	for (auto& thread : threads)
+		thread.join();
+	auto end = std::chrono::steady_clock::now();
+
+	liveRanges.clear();
+	for (auto& allocations : live) {
+		for (auto& allocation : allocations) {
+			SIZE_T begin = allocation.GetCpuHandle().ptr;
+			liveRanges.push_back({ begin, begin + SIZE_T{ allocation.GetNumHandles() } * heap.GetDescriptorSize() });
+			heap.Free(std::move(allocation));
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(end - begin).count();
+	return static_cast<double>(numThreads * NumOpsPerThread) / seconds;
+}
+
+// allocations that were live at the same time never share a descriptor
+static void CheckDisjoint(std::vector<Range>& ranges) {
+	std::sort(ranges.begin(), ranges.end(), [](const Range& lhs, const Range& rhs) { return lhs.begin < rhs.begin; });
+	for (size_t i = 1; i < ranges.size(); i++)
+		UDX12_CHECK(ranges[i - 1].end <= ranges[i].begin);
+}
+
+int main() {
+	Headless::StubDevice device;
+
+	std::printf("%8s %16s %16s %8s %10s\n", "threads", "pool ops/s", "cached ops/s", "speedup", "heaps");
+	for (size_t numThreads = 1; numThreads <= 32; numThreads *= 2) {
+		double opsPerSecond[2];
+		size_t numHeaps = 0;
+		for (uint32_t cacheSize : { 0u, 16u }) {
+			CPUDescriptorHeap heap{ &device, 1024, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_FLAG_NONE,
+				VarSizeAllocMngr::Backend::Tree, cacheSize };
+
+			std::vector<Range> liveRanges;
+			opsPerSecond[cacheSize == 0 ? 0 : 1] = Run(heap, numThreads, liveRanges);
+			UDX12_CHECK(liveRanges.size() == numThreads * NumLivePerThread);
+			CheckDisjoint(liveRanges);
+
+			// everything is back in the pool
+			heap.FlushThreadCaches();
+			auto snapshot = heap.GetTelemetry()->GetSnapshot();
+			UDX12_CHECK(snapshot.NumDescriptorsInUse == 0);
+			UDX12_CHECK(snapshot.NumAllocations == snapshot.NumFrees);
+			numHeaps = std::max(numHeaps, heap.GetNumHeaps());
+		}
+		std::printf("%8zu %16.0f %16.0f %8.2f %10zu\n",
+			numThreads, opsPerSecond[0], opsPerSecond[1], opsPerSecond[1] / opsPerSecond[0], numHeaps);
+	}
+	return 0;
+}
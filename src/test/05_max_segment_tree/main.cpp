@@ -0,0 +1,99 @@
+#include "../headless/Check.h"
+
+#include <UDX12/MaxSegmentTree.h>
+
+#include <algorithm>
+#include <random>
+
+using namespace Ubpa::UDX12;
+
+// linear reference of FindFirstNotLess()
+static size_t FindFirstNotLess(const std::vector<size_t>& values, size_t minValue) {
+	auto iter = std::find_if(values.begin(), values.end(), [=](size_t value) { return value >= minValue; });
+	return iter == values.end() ? MaxSegmentTree::InvalidIndex : static_cast<size_t>(iter - values.begin());
+}
+
+static void CheckEqual(const MaxSegmentTree& tree, const std::vector<size_t>& values) {
+	UDX12_CHECK(tree.Size() == values.size());
+	for (size_t i = 0; i < values.size(); i++)
+		UDX12_CHECK(tree.Get(i) == values[i]);
+	UDX12_CHECK(tree.GetMax() == (values.empty() ? 0 : *std::max_element(values.begin(), values.end())));
+}
+
+static void TestEmpty() {
+	MaxSegmentTree tree;
+	UDX12_CHECK(tree.Size() == 0);
+	UDX12_CHECK(tree.GetMax() == 0);
+	UDX12_CHECK(tree.FindFirstNotLess(0) == MaxSegmentTree::InvalidIndex);
+	UDX12_CHECK(tree.FindFirstNotLess(1) == MaxSegmentTree::InvalidIndex);
+}
+
+// the example of the header
+static void TestExample() {
+	MaxSegmentTree tree;
+	for (size_t value : { 4, 1, 9, 0 })
+		tree.PushBack(value);
+
+	UDX12_CHECK(tree.GetMax() == 9);
+	UDX12_CHECK(tree.FindFirstNotLess(5) == 2);
+	UDX12_CHECK(tree.FindFirstNotLess(4) == 0);
+	UDX12_CHECK(tree.FindFirstNotLess(10) == MaxSegmentTree::InvalidIndex);
+
+	// the max moves left, then disappears
+	tree.Set(1, 7);
+	UDX12_CHECK(tree.FindFirstNotLess(5) == 1);
+	tree.Set(1, 0);
+	tree.Set(2, 3);
+	UDX12_CHECK(tree.GetMax() == 4);
+	UDX12_CHECK(tree.FindFirstNotLess(5) == MaxSegmentTree::InvalidIndex);
+}
+
+// the padding leaves (0) after the last value are never returned
+static void TestPadding() {
+	MaxSegmentTree tree;
+	for (size_t value : { 0, 0, 0, 0, 0 })
+		tree.PushBack(value);
+
+	UDX12_CHECK(tree.FindFirstNotLess(0) == 0);
+	UDX12_CHECK(tree.FindFirstNotLess(1) == MaxSegmentTree::InvalidIndex);
+	tree.Set(4, 1);
+	UDX12_CHECK(tree.FindFirstNotLess(1) == 4);
+}
+
+// random PushBack() and Set() against the linear reference, across several growths of the leaves
+static void TestRandom() {
+	std::mt19937 rng{ 5 };
+	MaxSegmentTree tree;
+	std::vector<size_t> values;
+	for (size_t step = 0; step < 20000; step++) {
+		if (values.empty() || (values.size() < 300 && rng() % 8 == 0)) {
+			size_t value = rng() % 64;
+			tree.PushBack(value);
+			values.push_back(value);
+		}
+		else {
+			size_t idx = rng() % values.size();
+			size_t value = rng() % 64;
+			tree.Set(idx, value);
+			values[idx] = value;
+		}
+
+		size_t minValue = rng() % 70;
+		UDX12_CHECK(tree.FindFirstNotLess(minValue) == FindFirstNotLess(values, minValue));
+		if (step % 512 == 0)
+			CheckEqual(tree, values);
+	}
+	CheckEqual(tree, values);
+	for (size_t minValue = 0; minValue <= 64; minValue++)
+		UDX12_CHECK(tree.FindFirstNotLess(minValue) == FindFirstNotLess(values, minValue));
+}
+
+int main() {
+	TestEmpty();
+	TestExample();
+	TestPadding();
+	TestRandom();
+
+	std::printf("max segment tree : ok\n");
+	return 0;
+}
@@ -0,0 +1,92 @@
+#include "../headless/Check.h"
+#include "../headless/StubDevice.h"
+
+#include <UDX12/DescriptorHeap/CPUDescriptorHeap.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+using namespace Ubpa::UDX12;
+
+using Backend = VarSizeAllocMngr::Backend;
+
+constexpr uint32_t NumDescriptorsInHeap = 128;
+constexpr size_t NumLive = 1500;
+constexpr size_t NumOps = 1 << 18;
+
+// views of one resource, descriptor tables, and a few large tables (up to a whole heap)
+static uint32_t RandomCount(std::mt19937& rng) {
+	uint32_t r = rng() % 10;
+	if (r < 6)
+		return 1 + rng() % 4;
+	if (r < 9)
+		return 5 + rng() % 28;
+	return 33 + rng() % (NumDescriptorsInHeap - 32);
+}
+
+struct Result {
+	double nsPerOp;
+	size_t numHeaps;
+};
+
+// without the thread caches, so every request goes through AllocateFromPool()
+static Result Run(Headless::StubDevice& device, Backend backend) {
+	CPUDescriptorHeap heap{ &device, NumDescriptorsInHeap, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+		D3D12_DESCRIPTOR_HEAP_FLAG_NONE, backend };
+
+	std::mt19937 rng{ 7 };
+	std::vector<DescriptorHeapAllocation> live;
+	auto allocate = [&]() {
+		uint32_t count = RandomCount(rng);
+		auto allocation = heap.Allocate(count);
+		UDX12_CHECK(!allocation.IsNull() && allocation.GetNumHandles() == count);
+		live.push_back(std::move(allocation));
+	};
+
+	// warm up : the pool grows to its working set
+	while (live.size() < NumLive)
+		allocate();
+
+	auto begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < NumOps; i++) {
+		size_t idx = rng() % live.size();
+		std::swap(live[idx], live.back());
+		heap.Free(std::move(live.back()));
+		live.pop_back();
+		allocate();
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	// live allocations never share a descriptor
+	std::vector<std::pair<SIZE_T, SIZE_T>> ranges;
+	for (const auto& allocation : live) {
+		SIZE_T first = allocation.GetCpuHandle().ptr;
+		ranges.emplace_back(first, first + SIZE_T{ allocation.GetNumHandles() } * heap.GetDescriptorSize());
+	}
+	std::sort(ranges.begin(), ranges.end());
+	for (size_t i = 1; i < ranges.size(); i++)
+		UDX12_CHECK(ranges[i - 1].second <= ranges[i].first);
+
+	Result result;
+	result.numHeaps = heap.GetNumHeaps();
+	result.nsPerOp = std::chrono::duration<double, std::nano>(end - begin).count() / NumOps;
+
+	for (auto& allocation : live)
+		heap.Free(std::move(allocation));
+	UDX12_CHECK(heap.GetTelemetry()->GetSnapshot().NumDescriptorsInUse == 0);
+
+	return result;
+}
+
+int main() {
+	Headless::StubDevice device;
+
+	std::printf("%-14s %10s %20s\n", "backend", "heaps", "alloc + free ns");
+	for (auto [backend, name] : { std::pair{ Backend::Tree, "Tree" }, std::pair{ Backend::TLSF, "TLSF" } }) {
+		auto result = Run(device, backend);
+		std::printf("%-14s %10zu %20.1f\n", name, result.numHeaps, result.nsPerOp);
+		UDX12_CHECK(result.numHeaps >= 64);
+	}
+	return 0;
+}
@@ -0,0 +1,123 @@
+#include "../headless/Check.h"
+#include "../headless/StubDevice.h"
+
+#include <UDX12/DescriptorHeap/DescriptorRingAllocMngr.h>
+
+#include <memory>
+
+using namespace Ubpa::UDX12;
+
+constexpr uint32_t NumDescriptors = 64;
+constexpr uint32_t FirstDescriptor = 8;
+
+// ring allocations are released with their frame, the parent only drops them
+class RingParent final : public IDescriptorAllocator {
+public:
+	virtual DescriptorHeapAllocation Allocate(uint32_t Count) override { return {}; }
+	virtual void Free(DescriptorHeapAllocation&& Allocation) override { Allocation.Reset(); }
+	virtual uint32_t GetDescriptorSize() const override { return Headless::StubDevice::DescriptorSize; }
+};
+
+struct Ring {
+	Headless::StubDevice device;
+	RingParent parent;
+	CComPtr<ID3D12DescriptorHeap> heap;
+	std::unique_ptr<DescriptorRingAllocMngr> ring;
+
+	Ring() {
+		D3D12_DESCRIPTOR_HEAP_DESC desc{};
+		desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+		desc.NumDescriptors = FirstDescriptor + NumDescriptors;
+		desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+		UDX12_CHECK(SUCCEEDED(device.CreateDescriptorHeap(&desc, IID_PPV_ARGS(&heap))));
+		ring = std::make_unique<DescriptorRingAllocMngr>(&device, parent, 0, heap, FirstDescriptor, NumDescriptors);
+	}
+
+	// offset of the allocation in the range of the ring
+	SIZE_T OffsetOf(const DescriptorHeapAllocation& allocation) {
+		auto cpuBegin = heap->GetCPUDescriptorHandleForHeapStart().ptr + FirstDescriptor * Headless::StubDevice::DescriptorSize;
+		auto gpuBegin = heap->GetGPUDescriptorHandleForHeapStart().ptr + FirstDescriptor * Headless::StubDevice::DescriptorSize;
+		SIZE_T offset = (allocation.GetCpuHandle().ptr - cpuBegin) / Headless::StubDevice::DescriptorSize;
+		UDX12_CHECK(allocation.GetGpuHandle().ptr - gpuBegin == offset * Headless::StubDevice::DescriptorSize);
+		UDX12_CHECK(offset + allocation.GetNumHandles() <= NumDescriptors);
+		return offset;
+	}
+};
+
+// allocations made before the first BeginFrame() belong to the first frame,
+// they must not be released before its fence completes
+static void TestAllocationsBeforeFirstFrame() {
+	Ring r;
+	auto early = r.ring->Allocate(16);
+	UDX12_CHECK(!early.IsNull() && r.OffsetOf(early) == 0);
+
+	r.ring->BeginFrame(1);
+	auto frame1 = r.ring->Allocate(16);
+	UDX12_CHECK(!frame1.IsNull() && r.OffsetOf(frame1) == 16);
+	r.ring->BeginFrame(2);
+
+	// nothing has completed yet
+	r.ring->ReleaseCompletedFrames(0);
+	UDX12_CHECK(r.ring->GetUsedSize() == 32);
+
+	r.ring->ReleaseCompletedFrames(1);
+	UDX12_CHECK(r.ring->GetUsedSize() == 0);
+}
+
+// closed frames are released in order, the open frame is never released
+static void TestFrames() {
+	Ring r;
+	for (uint64_t fenceValue = 1; fenceValue <= 3; fenceValue++) {
+		r.ring->BeginFrame(fenceValue);
+		UDX12_CHECK(!r.ring->Allocate(10).IsNull());
+	}
+	UDX12_CHECK(r.ring->GetUsedSize() == 30);
+
+	r.ring->ReleaseCompletedFrames(1);
+	UDX12_CHECK(r.ring->GetUsedSize() == 20);
+
+	// frame 3 is still open
+	r.ring->ReleaseCompletedFrames(3);
+	UDX12_CHECK(r.ring->GetUsedSize() == 10);
+
+	// an empty frame closes nothing
+	r.ring->BeginFrame(4);
+	r.ring->BeginFrame(5);
+	r.ring->ReleaseCompletedFrames(5);
+	UDX12_CHECK(r.ring->GetUsedSize() == 0);
+	// sampled by BeginFrame(), before the third allocation
+	UDX12_CHECK(r.ring->GetMaxUsedSize() == 20);
+}
+
+// an allocation never wraps around the end of the range, the rest of the lap is skipped
+static void TestWrapAround() {
+	Ring r;
+	r.ring->BeginFrame(1);
+	UDX12_CHECK(!r.ring->Allocate(40).IsNull());
+	r.ring->BeginFrame(2);
+	r.ring->ReleaseCompletedFrames(1);
+
+	auto allocation = r.ring->Allocate(30);
+	UDX12_CHECK(!allocation.IsNull() && r.OffsetOf(allocation) == 0);
+	UDX12_CHECK(r.ring->GetUsedSize() == (NumDescriptors - 40) + 30);
+
+	// the skipped descriptors stay used until the frame is released, 10 descriptors are left
+	UDX12_CHECK(r.ring->Allocate(11).IsNull());
+	UDX12_CHECK(r.ring->Allocate(NumDescriptors + 1).IsNull());
+	auto rest = r.ring->Allocate(10);
+	UDX12_CHECK(!rest.IsNull() && r.OffsetOf(rest) == 30);
+	UDX12_CHECK(r.ring->Allocate(1).IsNull());
+
+	r.ring->BeginFrame(3);
+	r.ring->ReleaseCompletedFrames(2);
+	UDX12_CHECK(r.ring->GetUsedSize() == 0);
+}
+
+int main() {
+	TestAllocationsBeforeFirstFrame();
+	TestFrames();
+	TestWrapAround();
+
+	std::printf("descriptor ring : ok\n");
+	return 0;
+}
@@ -0,0 +1,208 @@
+#include "../headless/Check.h"
+#include "../headless/StubDevice.h"
+
+#include <UDX12/DescriptorHeap/DescriptorCopyBatch.h>
+#include <UDX12/DescriptorHeap/CPUDescriptorHeap.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+using namespace Ubpa::UDX12;
+
+using Headless::StubDevice;
+
+constexpr D3D12_DESCRIPTOR_HEAP_TYPE Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+
+// descriptor i of a fake heap
+static D3D12_CPU_DESCRIPTOR_HANDLE H(size_t i) {
+	return { 0x100000 + i * StubDevice::DescriptorSize };
+}
+
+// dst descriptor -> src descriptor
+using CopyMap = std::map<SIZE_T, SIZE_T>;
+
+// expands the ranges of the recorded call, both sides must have the same number of descriptors
+static CopyMap Expand(const StubDevice::CopyCall& call) {
+	std::vector<SIZE_T> dsts, srcs;
+	for (size_t i = 0; i < call.DstStarts.size(); i++) {
+		for (UINT j = 0; j < call.DstSizes[i]; j++)
+			dsts.push_back(call.DstStarts[i].ptr + j * StubDevice::DescriptorSize);
+	}
+	for (size_t i = 0; i < call.SrcStarts.size(); i++) {
+		for (UINT j = 0; j < call.SrcSizes[i]; j++)
+			srcs.push_back(call.SrcStarts[i].ptr + j * StubDevice::DescriptorSize);
+	}
+	UDX12_CHECK(dsts.size() == srcs.size());
+
+	CopyMap copies;
+	for (size_t i = 0; i < dsts.size(); i++)
+		UDX12_CHECK(copies.emplace(dsts[i], srcs[i]).second);
+	return copies;
+}
+
+struct Batch {
+	StubDevice device;
+	DescriptorCopyBatch batch{ &device, Type };
+	CopyMap expected;
+
+	void Add(size_t dst, size_t src, uint32_t count = 1) {
+		batch.Add(H(dst), H(src), count);
+		for (uint32_t i = 0; i < count; i++)
+			expected[H(dst + i).ptr] = H(src + i).ptr;
+	}
+
+	// flushes and checks that the one recorded call copies exactly the added descriptors
+	StubDevice::CopyCall Flush(const DescriptorCopyBatch::FlushStats& expectedStats) {
+		auto stats = batch.Flush();
+		UDX12_CHECK(stats.NumCopies == expectedStats.NumCopies);
+		UDX12_CHECK(stats.NumDescriptors == expectedStats.NumDescriptors);
+		UDX12_CHECK(stats.NumDstRanges == expectedStats.NumDstRanges);
+		UDX12_CHECK(stats.NumSrcRanges == expectedStats.NumSrcRanges);
+		UDX12_CHECK(batch.GetNumPendingCopies() == 0);
+
+		auto calls = device.GetCopyCalls();
+		UDX12_CHECK(calls.size() == 1);
+		const auto& call = calls.front();
+		UDX12_CHECK(call.Type == Type);
+		UDX12_CHECK(call.DstStarts.size() == stats.NumDstRanges && call.SrcStarts.size() == stats.NumSrcRanges);
+		// CopyDescriptorsSimple() iff there is one range on both sides
+		UDX12_CHECK(call.Simple == (stats.NumDstRanges == 1 && stats.NumSrcRanges == 1));
+		UDX12_CHECK(Expand(call) == expected);
+
+		device.ClearCopyCalls();
+		expected.clear();
+		return call;
+	}
+};
+
+// the example of the header
+static void TestExample() {
+	Batch b;
+	b.Add(12, 40);
+	b.Add(10, 3);
+	b.Add(11, 4);
+	b.Add(13, 41);
+	auto call = b.Flush({ 4, 4, 1, 2 });
+	UDX12_CHECK(call.DstStarts[0].ptr == H(10).ptr && call.DstSizes[0] == 4);
+	UDX12_CHECK(call.SrcStarts[0].ptr == H(3).ptr && call.SrcSizes[0] == 2);
+	UDX12_CHECK(call.SrcStarts[1].ptr == H(40).ptr && call.SrcSizes[1] == 2);
+}
+
+// a descriptor table gathered from scattered views : one destination range, one source range per view
+static void TestDstContiguousSrcDiscontiguous() {
+	Batch b;
+	for (size_t i = 0; i < 8; i++)
+		b.Add(100 + i, 1000 + 7 * i);
+	b.Flush({ 8, 8, 1, 8 });
+
+	// multi-descriptor sources, added in reverse order
+	for (size_t i = 0; i < 4; i++)
+		b.Add(200 + 3 * (3 - i), 500 + 10 * i, 3);
+	b.Flush({ 4, 12, 1, 4 });
+}
+
+// the same source copied to several destinations is never merged with itself
+static void TestDuplicateSources() {
+	Batch b;
+	for (size_t i = 0; i < 4; i++)
+		b.Add(10 + i, 77);
+	b.Flush({ 4, 4, 1, 4 });
+
+	// one source range to two destination ranges
+	b.Add(0, 100, 4);
+	b.Add(20, 100, 4);
+	b.Flush({ 2, 8, 2, 2 });
+
+	// a repeated source range next to its own end merges as a plain contiguous range
+	b.Add(30, 300, 2);
+	b.Add(32, 302, 2);
+	b.Add(34, 300, 2);
+	b.Flush({ 3, 6, 1, 2 });
+}
+
+// contiguous on both sides after sorting : one CopyDescriptorsSimple()
+static void TestSimple() {
+	Batch b;
+	for (size_t i = 4; i-- > 0;)
+		b.Add(20 + i, 50 + i);
+	auto call = b.Flush({ 4, 4, 1, 1 });
+	UDX12_CHECK(call.Simple && call.DstStarts[0].ptr == H(20).ptr && call.SrcStarts[0].ptr == H(50).ptr && call.DstSizes[0] == 4);
+
+	b.Add(7, 9, 16);
+	b.Flush({ 1, 16, 1, 1 });
+
+	// nothing to copy : no call
+	b.batch.Add(H(1), H(2), 0);
+	auto stats = b.batch.Flush();
+	UDX12_CHECK(stats.NumCopies == 0 && stats.NumDescriptors == 0);
+	UDX12_CHECK(b.device.GetCopyCalls().empty());
+}
+
+// the DescriptorHeapAllocation overload uses the handles of the allocations
+static void TestAllocations() {
+	StubDevice device;
+	CPUDescriptorHeap heap{ &device, 64, Type, D3D12_DESCRIPTOR_HEAP_FLAG_NONE };
+	auto src = heap.Allocate(8);
+	auto dst = heap.Allocate(8);
+	{
+		DescriptorCopyBatch batch{ &device, Type };
+		batch.Add(dst, 0, src, 4, 4);
+		batch.Add(dst, 4, src, 0, 4);
+		auto stats = batch.Flush();
+		UDX12_CHECK(stats.NumDstRanges == 1 && stats.NumSrcRanges == 2 && stats.NumDescriptors == 8);
+
+		auto calls = device.GetCopyCalls();
+		UDX12_CHECK(calls.size() == 1 && calls[0].DstStarts[0].ptr == dst.GetCpuHandle().ptr);
+		UDX12_CHECK(calls[0].SrcStarts[0].ptr == src.GetCpuHandle(4).ptr && calls[0].SrcStarts[1].ptr == src.GetCpuHandle().ptr);
+	}
+	heap.Free(std::move(src));
+	heap.Free(std::move(dst));
+}
+
+// random non-overlapping destinations : the ranges are the maximal contiguous runs
+static void TestRandom() {
+	std::mt19937 rng{ 11 };
+	for (size_t round = 0; round < 200; round++) {
+		Batch b;
+		std::vector<std::pair<size_t, uint32_t>> dsts; // {first, count}
+		size_t next = 0;
+		size_t numCopies = rng() % 32 + 2;
+		for (size_t i = 0; i < numCopies; i++) {
+			next += rng() % 3 == 0 ? rng() % 4 : 0;
+			uint32_t count = 1 + rng() % 3;
+			dsts.emplace_back(next, count);
+			next += count;
+		}
+		std::shuffle(dsts.begin(), dsts.end(), rng);
+
+		size_t numDescriptors = 0;
+		for (auto [dst, count] : dsts) {
+			b.Add(dst, rng() % 4 == 0 ? 5000 : rng() % 256, count);
+			numDescriptors += count;
+		}
+
+		std::sort(dsts.begin(), dsts.end());
+		size_t numDstRanges = 1;
+		for (size_t i = 1; i < dsts.size(); i++)
+			numDstRanges += dsts[i].first != dsts[i - 1].first + dsts[i - 1].second ? 1 : 0;
+
+		auto stats = b.batch.Flush();
+		UDX12_CHECK(stats.NumCopies == numCopies && stats.NumDescriptors == numDescriptors);
+		UDX12_CHECK(stats.NumDstRanges == numDstRanges && stats.NumSrcRanges <= numCopies);
+		auto calls = b.device.GetCopyCalls();
+		UDX12_CHECK(calls.size() == 1 && Expand(calls[0]) == b.expected);
+	}
+}
+
+int main() {
+	TestExample();
+	TestDstContiguousSrcDiscontiguous();
+	TestDuplicateSources();
+	TestSimple();
+	TestAllocations();
+	TestRandom();
+
+	std::printf("descriptor copy batch : ok\n");
+	return 0;
+}
@@ -0,0 +1,111 @@
+#include "../headless/Check.h"
+#include "../headless/StubDevice.h"
+
+#include <UDX12/FrameGraph/RsrcViewCache.h>
+
+#include <memory>
+#include <set>
+
+using namespace Ubpa::UDX12;
+using namespace Ubpa::UDX12::FG;
+
+using Headless::StubDevice;
+using Headless::StubResource;
+
+constexpr size_t Capacity = 4;
+
+struct Fixture {
+	StubDevice device;
+	std::vector<std::unique_ptr<StubResource>> rsrcs;
+
+	Fixture() {
+		DescriptorHeapMngr::Instance().Init(&device, 256, 16, 16, 8, 64);
+
+		D3D12_RESOURCE_DESC desc{};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		desc.Width = 64;
+		desc.Height = 64;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.SampleDesc.Count = 1;
+		for (size_t i = 0; i < 16; i++)
+			rsrcs.push_back(std::make_unique<StubResource>(&device, desc, 0x10000 * (i + 1)));
+	}
+
+	~Fixture() {
+		DescriptorHeapMngr::Instance().Clear();
+	}
+
+	Rsrc* operator[](size_t i) const { return rsrcs[i].get(); }
+};
+
+static const RsrcImplDesc SRV = RsrcImplDesc_SRV_NULL{};
+
+// a pass with more views than the capacity : the views of the pass stay valid until EndBatch()
+static void TestPinnedBatch() {
+	Fixture rsrcs;
+	RsrcViewCache cache{ &rsrcs.device, Capacity };
+
+	for (size_t i = 0; i < Capacity; i++)
+		cache.GetOrCreate(rsrcs[i], SRV);
+	cache.EndBatch();
+
+	// the old views are evicted first, then the cache grows past capacity
+	std::set<SIZE_T> handles;
+	for (size_t i = Capacity; i < 2 * Capacity + 2; i++)
+		UDX12_CHECK(handles.insert(cache.GetOrCreate(rsrcs[i], SRV).ptr).second);
+	// hits of the batch return the pinned descriptors
+	for (size_t i = Capacity; i < 2 * Capacity + 2; i++)
+		UDX12_CHECK(handles.contains(cache.GetOrCreate(rsrcs[i], SRV).ptr));
+
+	UDX12_CHECK(cache.GetStats().numViews == Capacity + 2);
+	UDX12_CHECK(cache.GetStats().numEvictions == Capacity);
+	UDX12_CHECK(cache.GetStats().numOverflows == 2);
+	UDX12_CHECK(cache.GetStats().numHits == Capacity + 2);
+	cache.EndBatch();
+
+	// the next miss shrinks the cache back to capacity
+	cache.GetOrCreate(rsrcs[0], SRV);
+	UDX12_CHECK(cache.GetStats().numViews == Capacity);
+	UDX12_CHECK(cache.GetStats().numEvictions == Capacity + 3);
+	cache.EndBatch();
+
+	cache.Clear();
+}
+
+// a hit pins the least recently used view of the previous batches
+static void TestHitPins() {
+	Fixture rsrcs;
+	RsrcViewCache cache{ &rsrcs.device, Capacity };
+
+	std::vector<SIZE_T> handles;
+	for (size_t i = 0; i < Capacity; i++)
+		handles.push_back(cache.GetOrCreate(rsrcs[i], SRV).ptr);
+	cache.EndBatch();
+
+	UDX12_CHECK(cache.GetOrCreate(rsrcs[0], SRV).ptr == handles[0]);
+	cache.GetOrCreate(rsrcs[Capacity], SRV); // evicts rsrcs[1]
+	UDX12_CHECK(cache.GetOrCreate(rsrcs[0], SRV).ptr == handles[0]);
+	UDX12_CHECK(cache.GetStats().numEvictions == 1 && cache.GetStats().numOverflows == 0);
+	cache.EndBatch();
+
+	UDX12_CHECK(cache.GetOrCreate(rsrcs[2], SRV).ptr == handles[2]);
+	cache.GetOrCreate(rsrcs[1], SRV); // miss, evicts rsrcs[3]
+	UDX12_CHECK(cache.GetStats().numMisses == Capacity + 2);
+	cache.EndBatch();
+
+	// destroyed resources are evicted between the batches
+	cache.Evict(rsrcs[0]);
+	cache.Evict(rsrcs[3]);
+	UDX12_CHECK(cache.GetStats().numViews == Capacity - 1);
+
+	cache.Clear();
+}
+
+int main() {
+	TestPinnedBatch();
+	TestHitPins();
+
+	std::printf("rsrc view cache : ok\n");
+	return 0;
+}
@@ -0,0 +1,205 @@
+#include "../headless/Check.h"
+#include "../headless/StubDevice.h"
+
+#include <UDX12/DescriptorHeap/DescriptorHeapAllocMngr.h>
+#include <UDX12/DescriptorHeap/DescriptorHeapAllocation.h>
+#include <UDX12/DescriptorHeap/CPUDescriptorHeap.h>
+#include <UDX12/DescriptorHeap/GPUDescriptorHeap.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+
+using namespace Ubpa::UDX12;
+
+constexpr uint32_t NumDescriptors = 4096;
+constexpr uint32_t MaxCount = 8;
+constexpr size_t NumOpsPerThread = 1 << 15;
+constexpr size_t NumLivePerThread = 24;
+
+// frees go back to the manager, like the static part of GPUDescriptorHeap
+class MngrParent final : public IDescriptorAllocator {
+public:
+	DescriptorHeapAllocMngr* mngr{ nullptr };
+
+	virtual DescriptorHeapAllocation Allocate(uint32_t Count) override { return mngr->Allocate(Count); }
+	virtual void Free(DescriptorHeapAllocation&& Allocation) override { mngr->FreeAllocation(std::move(Allocation)); }
+	virtual uint32_t GetDescriptorSize() const override { return Headless::StubDevice::DescriptorSize; }
+};
+
+struct Range {
+	SIZE_T begin, end;
+};
+
+// every thread allocates 1 to MaxCount descriptors and frees a random live allocation,
+// every 64th operation frees half of its allocations with one FreeAllocations(),
+// returns the allocations per second over all threads
+static double Run(DescriptorHeapAllocMngr& mngr, size_t numThreads, std::vector<Range>& liveRanges) {
+	std::vector<std::vector<DescriptorHeapAllocation>> live(numThreads);
+
+	auto worker = [&](size_t threadIdx) {
+		std::mt19937 rng{ static_cast<unsigned>(threadIdx) };
+		auto& allocations = live[threadIdx];
+		for (size_t i = 0; i < NumOpsPerThread; i++) {
+			if (i % 64 == 63) {
+				size_t half = allocations.size() / 2;
+				mngr.FreeAllocations({ allocations.data() + half, allocations.size() - half });
+				allocations.resize(half);
+			}
+			else if (allocations.size() == NumLivePerThread) {
+				size_t idx = rng() % allocations.size();
+				std::swap(allocations[idx], allocations.back());
+				mngr.FreeAllocation(std::move(allocations.back()));
+				allocations.pop_back();
+			}
+			uint32_t count = 1 + rng() % MaxCount;
+			auto allocation = mngr.Allocate(count);
+			UDX12_CHECK(!allocation.IsNull() && allocation.GetNumHandles() == count);
+			allocations.push_back(std::move(allocation));
+		}
+	};
+
+	auto begin = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < numThreads; i++)
+		threads.emplace_back(worker, i);
+	for (auto& thread : threads)
+		thread.join();
+	auto end = std::chrono::steady_clock::now();
+
+	liveRanges.clear();
+	for (auto& allocations : live) {
+		for (auto& allocation : allocations) {
+			SIZE_T begin = allocation.GetCpuHandle().ptr;
+			liveRanges.push_back({ begin, begin + SIZE_T{ allocation.GetNumHandles() } * Headless::StubDevice::DescriptorSize });
+			mngr.FreeAllocation(std::move(allocation));
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(end - begin).count();
+	return static_cast<double>(numThreads * NumOpsPerThread) / seconds;
+}
+
+// allocations that were live at the same time never share a descriptor
+static void CheckDisjoint(std::vector<Range>& ranges) {
+	std::sort(ranges.begin(), ranges.end(), [](const Range& lhs, const Range& rhs) { return lhs.begin < rhs.begin; });
+	for (size_t i = 1; i < ranges.size(); i++)
+		UDX12_CHECK(ranges[i - 1].end <= ranges[i].begin);
+}
+
+// pending frees are counted as available and returned by the next allocation, GetMaxAllocatableCount() or Flush()
+static void TestPendingFrees(ID3D12Device* device, ID3D12DescriptorHeap* heap) {
+	MngrParent parent;
+	DescriptorHeapAllocMngr mngr{ device, parent, 0, heap, 0, NumDescriptors };
+	parent.mngr = &mngr;
+	mngr.EnablePendingFrees();
+
+	auto a = mngr.Allocate(NumDescriptors / 2);
+	auto b = mngr.Allocate(NumDescriptors / 2);
+	UDX12_CHECK(!a.IsNull() && !b.IsNull() && mngr.GetMaxAllocatableCount() == 0);
+
+	mngr.FreeAllocation(std::move(a));
+	mngr.FreeAllocation(std::move(b));
+	UDX12_CHECK(mngr.GetNumAvailableDescriptors() == NumDescriptors);
+
+	// the adjacent ranges are merged
+	UDX12_CHECK(mngr.GetMaxAllocatableCount() == NumDescriptors);
+	UDX12_CHECK(mngr.GetFreeBlockStats().numFreeBlocks == 1);
+
+	b = mngr.Allocate(NumDescriptors / 2);
+	mngr.FreeAllocation(std::move(b));
+	mngr.Flush();
+	UDX12_CHECK(mngr.GetMaxAllocatableCount() == NumDescriptors);
+
+	a = mngr.Allocate(1);
+	mngr.FreeAllocation(std::move(a));
+	a = mngr.Allocate(NumDescriptors);
+	UDX12_CHECK(!a.IsNull());
+	mngr.FreeAllocation(std::move(a));
+}
+
+// null allocations (failed or moved-from) are skipped by every free, they have no manager Id
+static void TestNullAllocations(ID3D12Device* device, ID3D12DescriptorHeap* heap) {
+	{
+		MngrParent parent;
+		DescriptorHeapAllocMngr mngr{ device, parent, 0, heap, 0, NumDescriptors };
+		parent.mngr = &mngr;
+
+		std::vector<DescriptorHeapAllocation> allocations(4);
+		allocations[1] = mngr.Allocate(3);
+		allocations[2] = mngr.Allocate(5);
+		mngr.FreeAllocations(allocations);
+		mngr.FreeAllocation({});
+		UDX12_CHECK(mngr.GetNumAvailableDescriptors() == NumDescriptors);
+	}
+
+	{
+		CPUDescriptorHeap cpuHeap{ device, 64, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_FLAG_NONE };
+		cpuHeap.Free({});
+		auto allocation = cpuHeap.Allocate(2);
+		cpuHeap.Free(std::move(allocation));
+		cpuHeap.Free(std::move(allocation));
+		UDX12_CHECK(cpuHeap.GetTelemetry()->GetSnapshot().NumDescriptorsInUse == 0);
+	}
+
+	for (bool deferredRelease : { false, true }) {
+		GPUDescriptorHeap gpuHeap{ device, 64, 64, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE };
+		gpuHeap.EnableDeferredRelease(deferredRelease);
+		gpuHeap.SetFrameFenceValue(1);
+
+		std::vector<DescriptorHeapAllocation> allocations(5);
+		allocations[0] = gpuHeap.Allocate(4);
+		allocations[2] = gpuHeap.AllocateDynamic(4);
+		allocations[3] = gpuHeap.Allocate(2);
+		UDX12_CHECK(!allocations[0].IsNull() && !allocations[2].IsNull() && !allocations[3].IsNull());
+		gpuHeap.FreeBatch(allocations);
+		gpuHeap.Free({});
+		gpuHeap.ReleaseStaleAllocations(1);
+
+		auto snapshot = gpuHeap.GetTelemetry()->GetSnapshot();
+		UDX12_CHECK(snapshot.NumFrees == 3 && snapshot.NumDescriptorsInUse == 0);
+		// every descriptor is back
+		auto allocation = gpuHeap.Allocate(64);
+		UDX12_CHECK(!allocation.IsNull());
+		gpuHeap.Free(std::move(allocation));
+	}
+}
+
+int main() {
+	Headless::StubDevice device;
+	D3D12_DESCRIPTOR_HEAP_DESC desc{};
+	desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	desc.NumDescriptors = NumDescriptors;
+	desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	CComPtr<ID3D12DescriptorHeap> heap;
+	UDX12_CHECK(SUCCEEDED(device.CreateDescriptorHeap(&desc, IID_PPV_ARGS(&heap))));
+
+	TestPendingFrees(&device, heap);
+	TestNullAllocations(&device, heap);
+
+	std::printf("%8s %16s %16s %8s\n", "threads", "locked ops/s", "pending ops/s", "speedup");
+	for (size_t numThreads = 1; numThreads <= 16; numThreads *= 2) {
+		double opsPerSecond[2];
+		for (bool pendingFrees : { false, true }) {
+			MngrParent parent;
+			DescriptorHeapAllocMngr mngr{ &device, parent, 0, heap, 0, NumDescriptors };
+			parent.mngr = &mngr;
+			if (pendingFrees)
+				mngr.EnablePendingFrees();
+
+			std::vector<Range> liveRanges;
+			opsPerSecond[pendingFrees ? 1 : 0] = Run(mngr, numThreads, liveRanges);
+			CheckDisjoint(liveRanges);
+
+			// everything is back in one free block
+			mngr.Flush();
+			UDX12_CHECK(mngr.GetNumAvailableDescriptors() == NumDescriptors);
+			auto stats = mngr.GetFreeBlockStats();
+			UDX12_CHECK(stats.numFreeBlocks == 1 && stats.largestFreeBlock == NumDescriptors && stats.numAllocations == 0);
+		}
+		std::printf("%8zu %16.0f %16.0f %8.2f\n",
+			numThreads, opsPerSecond[0], opsPerSecond[1], opsPerSecond[1] / opsPerSecond[0]);
+	}
+	return 0;
+}
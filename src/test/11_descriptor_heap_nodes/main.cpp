@@ -0,0 +1,101 @@
+#include "../headless/Check.h"
+#include "../headless/StubDevice.h"
+
+#include <UDX12/DescriptorHeapMngr.h>
+
+#include <memory>
+
+using namespace Ubpa::UDX12;
+
+constexpr UINT NumNodes = 3;
+
+struct Key {
+	UINT nodeMask;
+	uint32_t domain;
+};
+
+// the allocations of one manager, one per heap
+struct Allocations {
+	std::vector<std::pair<IDescriptorAllocator*, DescriptorHeapAllocation>> allocations;
+
+	explicit Allocations(DescriptorHeapMngr& mngr) {
+		for (IDescriptorAllocator* heap : std::initializer_list<IDescriptorAllocator*>{
+			mngr.GetCSUCpuDH(), mngr.GetRTVCpuDH(), mngr.GetDSVCpuDH(), mngr.GetSamplerCpuDH(),
+			mngr.GetCSUGpuDH(), mngr.GetSamplerGpuDH() })
+		{
+			auto allocation = heap->Allocate(4);
+			UDX12_CHECK(!allocation.IsNull());
+			allocations.emplace_back(heap, std::move(allocation));
+		}
+	}
+
+	~Allocations() {
+		for (auto& [heap, allocation] : allocations)
+			heap->Free(std::move(allocation));
+	}
+};
+
+// every (node mask, domain) has its own manager, all heaps of a manager are created on its node
+static void TestInstances() {
+	Headless::StubDevice device{ NumNodes };
+
+	UDX12_CHECK(&DescriptorHeapMngr::Instance(1, 0) == &DescriptorHeapMngr::Instance());
+	UDX12_CHECK(&DescriptorHeapMngr::Instance(2, 1) == &DescriptorHeapMngr::Instance(2, 1));
+
+	const Key keys[] = { { 1, 0 }, { 2, 0 }, { 4, 0 }, { 1, 1 }, { 2, 1 } };
+	std::vector<DescriptorHeapMngr*> mngrs;
+	std::vector<std::unique_ptr<Allocations>> allocations;
+	for (const auto& key : keys) {
+		auto& mngr = DescriptorHeapMngr::Instance(key.nodeMask, key.domain);
+		for (auto* other : mngrs)
+			UDX12_CHECK(other != &mngr);
+		UDX12_CHECK(!mngr.IsInit());
+
+		// the CPU heaps create their D3D12 heaps on the first allocation
+		size_t numHeaps = device.GetDescriptorHeapDescs().size();
+		mngr.Init(&device, 64, 16, 16, 32, 32, false, key.nodeMask, 16);
+		UDX12_CHECK(mngr.GetNodeMask() == key.nodeMask);
+		allocations.push_back(std::make_unique<Allocations>(mngr));
+
+		auto descs = device.GetDescriptorHeapDescs();
+		UDX12_CHECK(descs.size() == numHeaps + 6);
+		for (size_t i = numHeaps; i < descs.size(); i++)
+			UDX12_CHECK(descs[i].NodeMask == key.nodeMask);
+		mngrs.push_back(&mngr);
+	}
+
+	// no descriptor heap is shared between the managers
+	for (size_t i = 0; i < allocations.size(); i++) {
+		for (size_t j = i + 1; j < allocations.size(); j++) {
+			for (const auto& lhs : allocations[i]->allocations) {
+				for (const auto& rhs : allocations[j]->allocations)
+					UDX12_CHECK(lhs.second.GetDescriptorHeap() != rhs.second.GetDescriptorHeap());
+			}
+		}
+	}
+
+	// clearing a manager leaves the others working
+	allocations[1].reset();
+	mngrs[1]->Clear();
+	UDX12_CHECK(!mngrs[1]->IsInit() && mngrs[2]->IsInit());
+	allocations.push_back(std::make_unique<Allocations>(*mngrs[2]));
+	for (size_t i = 0; i < allocations.back()->allocations.size(); i++) {
+		UDX12_CHECK(allocations.back()->allocations[i].second.GetDescriptorHeap()
+			== allocations[2]->allocations[i].second.GetDescriptorHeap());
+	}
+
+	allocations.clear();
+	DescriptorHeapMngr::Instance().Clear();
+	DescriptorHeapMngr::DestroyInstances();
+
+	// the managers are created again, uninitialized
+	UDX12_CHECK(!DescriptorHeapMngr::Instance(2, 0).IsInit());
+	DescriptorHeapMngr::DestroyInstances();
+}
+
+int main() {
+	TestInstances();
+
+	std::printf("descriptor heap nodes : ok\n");
+	return 0;
+}
@@ -0,0 +1,130 @@
+#include "../headless/Check.h"
+
+#include <UDX12/DescriptorHeap/DescriptorTelemetry.h>
+
+#include <thread>
+#include <vector>
+
+using namespace Ubpa::UDX12;
+
+constexpr uint32_t DescriptorSize = 32;
+
+// the per-frame counters are reset, the usage and the lifetime peak are kept
+static void TestEndFrame() {
+	DescriptorTelemetry telemetry{ DescriptorSize };
+	telemetry.OnAllocate(4);
+	telemetry.OnAllocate(4);
+	telemetry.OnAllocate(2);
+	telemetry.OnFree(4);
+	telemetry.OnFailedAllocation();
+	telemetry.AddLockHeldTime(std::chrono::nanoseconds{ 100 });
+
+	auto frame = telemetry.EndFrame();
+	UDX12_CHECK(frame.NumAllocations == 3 && frame.NumFrees == 1 && frame.NumFailedAllocations == 1);
+	UDX12_CHECK(frame.LockHeldNanoseconds == 100);
+	UDX12_CHECK(frame.NumDescriptorsInUse == 6 && frame.NumBytesInUse == 6 * DescriptorSize);
+	UDX12_CHECK(frame.FramePeakDescriptorsInUse == 10 && frame.PeakDescriptorsInUse == 10);
+	UDX12_CHECK(frame.FrameIndex == 0);
+
+	auto snapshot = telemetry.GetSnapshot();
+	UDX12_CHECK(snapshot.NumAllocations == 0 && snapshot.NumFrees == 0 && snapshot.NumFailedAllocations == 0);
+	UDX12_CHECK(snapshot.LockHeldNanoseconds == 0);
+	UDX12_CHECK(snapshot.NumDescriptorsInUse == 6 && snapshot.PeakDescriptorsInUse == 10);
+	UDX12_CHECK(snapshot.FrameIndex == 1);
+
+	// OnFree() of a batch counts every allocation
+	telemetry.OnFree(6, 2);
+	frame = telemetry.EndFrame();
+	UDX12_CHECK(frame.NumFrees == 2 && frame.NumDescriptorsInUse == 0 && frame.FrameIndex == 1);
+}
+
+// a frame starts at the usage the previous frame ended with
+static void TestFramePeak() {
+	DescriptorTelemetry telemetry{ DescriptorSize };
+	telemetry.OnAllocate(8);
+	UDX12_CHECK(telemetry.EndFrame().FramePeakDescriptorsInUse == 8);
+
+	// nothing allocated, the peak is the usage carried over
+	telemetry.OnFree(4);
+	UDX12_CHECK(telemetry.GetSnapshot().FramePeakDescriptorsInUse == 8);
+	UDX12_CHECK(telemetry.EndFrame().FramePeakDescriptorsInUse == 8);
+
+	UDX12_CHECK(telemetry.EndFrame().FramePeakDescriptorsInUse == 4);
+
+	telemetry.OnAllocate(2);
+	telemetry.OnFree(2);
+	auto frame = telemetry.EndFrame();
+	UDX12_CHECK(frame.FramePeakDescriptorsInUse == 6 && frame.PeakDescriptorsInUse == 8);
+}
+
+// a free counted before its allocation (on another thread) never reports a negative or huge usage
+static void TestNegativeInUse() {
+	DescriptorTelemetry telemetry{ DescriptorSize };
+	telemetry.OnFree(4);
+	auto snapshot = telemetry.GetSnapshot();
+	UDX12_CHECK(snapshot.NumDescriptorsInUse == 0 && snapshot.NumBytesInUse == 0);
+	auto frame = telemetry.EndFrame();
+	UDX12_CHECK(frame.NumDescriptorsInUse == 0 && frame.FramePeakDescriptorsInUse == 0);
+
+	// the allocation brings the usage back to 0, the peaks are not touched
+	telemetry.OnAllocate(4);
+	snapshot = telemetry.GetSnapshot();
+	UDX12_CHECK(snapshot.NumDescriptorsInUse == 0 && snapshot.PeakDescriptorsInUse == 0);
+
+	telemetry.OnAllocate(2);
+	snapshot = telemetry.GetSnapshot();
+	UDX12_CHECK(snapshot.NumDescriptorsInUse == 2 && snapshot.PeakDescriptorsInUse == 2);
+}
+
+// the lock time is measured only if lock timing is enabled
+static void TestLockTiming() {
+	DescriptorTelemetry telemetry{ DescriptorSize };
+	std::mutex mutex;
+	{
+		DescriptorTelemetry::LockGuard<std::mutex> lockGuard(mutex, telemetry);
+		std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+	}
+	UDX12_CHECK(telemetry.EndFrame().LockHeldNanoseconds == 0);
+
+	telemetry.EnableLockTiming(true);
+	{
+		DescriptorTelemetry::LockGuard<std::mutex> lockGuard(mutex, telemetry);
+		std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+	}
+	UDX12_CHECK(telemetry.EndFrame().LockHeldNanoseconds >= 1000000);
+}
+
+// relaxed updates from many threads add up
+static void TestConcurrent() {
+	constexpr size_t NumThreads = 8;
+	constexpr size_t NumOpsPerThread = 1 << 14;
+
+	DescriptorTelemetry telemetry{ DescriptorSize };
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < NumThreads; i++) {
+		threads.emplace_back([&] {
+			for (size_t j = 0; j < NumOpsPerThread; j++) {
+				telemetry.OnAllocate(3);
+				telemetry.OnFree(3);
+			}
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	auto frame = telemetry.EndFrame();
+	UDX12_CHECK(frame.NumAllocations == NumThreads * NumOpsPerThread && frame.NumFrees == frame.NumAllocations);
+	UDX12_CHECK(frame.NumDescriptorsInUse == 0);
+	UDX12_CHECK(frame.PeakDescriptorsInUse >= 3 && frame.PeakDescriptorsInUse <= 3 * NumThreads);
+}
+
+int main() {
+	TestEndFrame();
+	TestFramePeak();
+	TestNegativeInUse();
+	TestLockTiming();
+	TestConcurrent();
+
+	std::printf("descriptor telemetry : ok\n");
+	return 0;
+}
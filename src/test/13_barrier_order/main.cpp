@@ -0,0 +1,280 @@
+#include "../headless/Check.h"
+#include "../headless/StubQueue.h"
+
+#include <UDX12/FrameGraph/Executor.h>
+#include <UDX12/FrameGraph/RsrcMngr.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <span>
+
+using namespace Ubpa;
+using namespace Ubpa::UDX12;
+using namespace Ubpa::UDX12::FG;
+
+using Headless::RecordingCmdList;
+using Headless::StubCommandQueue;
+using Headless::StubFence;
+
+using Command = RecordingCmdList::Command;
+
+constexpr size_t NumPasses = 3;
+constexpr size_t NumRsrcs = 7;
+
+// rsrc : (pass, state) of every use
+//
+//   pass 0 : r0 (RT)   r3 (depth)
+//   pass 1 : r0 (SRV)  r1 (RT)  r5 (UAV buffer)
+//   pass 2 : r1 (SRV)  r2 (RT)  r4 (depth)  r6 (UAV buffer)
+//
+// r2 can take the memory of r0, r4 of r3 and r6 of r5
+struct Graph {
+	UFG::Compiler::Result crst;
+	D3D12_RESOURCE_DESC descs[NumRsrcs];
+	std::vector<std::pair<size_t, RsrcState>> uses[NumPasses]; // (rsrc, state)
+
+	Graph() {
+		crst.sorted_passes = { 0, 1, 2 };
+		crst.pass2order = { 0, 1, 2 };
+		crst.pass2info[0].construct_resources = { 0, 3 };
+		crst.pass2info[0].destruct_resources = { 3 };
+		crst.pass2info[1].construct_resources = { 1, 5 };
+		crst.pass2info[1].destruct_resources = { 0, 5 };
+		crst.pass2info[2].construct_resources = { 2, 4, 6 };
+		crst.pass2info[2].destruct_resources = { 1, 2, 4, 6 };
+
+		D3D12_RESOURCE_DESC rt{};
+		rt.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		rt.Width = 256;
+		rt.Height = 256;
+		rt.DepthOrArraySize = 1;
+		rt.MipLevels = 1;
+		rt.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		rt.SampleDesc.Count = 1;
+		rt.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+
+		D3D12_RESOURCE_DESC depth = rt;
+		depth.Format = DXGI_FORMAT_D32_FLOAT;
+		depth.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+
+		D3D12_RESOURCE_DESC buffer{};
+		buffer.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		buffer.Width = 64 * 1024;
+		buffer.Height = 1;
+		buffer.DepthOrArraySize = 1;
+		buffer.MipLevels = 1;
+		buffer.Format = DXGI_FORMAT_UNKNOWN;
+		buffer.SampleDesc.Count = 1;
+		buffer.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		buffer.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+		descs[0] = descs[1] = descs[2] = rt;
+		descs[3] = descs[4] = depth;
+		descs[5] = descs[6] = buffer;
+
+		uses[0] = { { 0, D3D12_RESOURCE_STATE_RENDER_TARGET }, { 3, D3D12_RESOURCE_STATE_DEPTH_WRITE } };
+		uses[1] = { { 0, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE }, { 1, D3D12_RESOURCE_STATE_RENDER_TARGET },
+			{ 5, D3D12_RESOURCE_STATE_UNORDERED_ACCESS } };
+		uses[2] = { { 1, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE }, { 2, D3D12_RESOURCE_STATE_RENDER_TARGET },
+			{ 4, D3D12_RESOURCE_STATE_DEPTH_WRITE }, { 6, D3D12_RESOURCE_STATE_UNORDERED_ACCESS } };
+	}
+
+	void Register(RsrcMngr& rsrcMngr) const {
+		for (size_t i = 0; i < NumRsrcs; i++)
+			rsrcMngr.RegisterTemporalRsrc(i, descs[i]);
+
+		for (size_t pass = 0; pass < NumPasses; pass++) {
+			for (auto [rsrc, state] : uses[pass]) {
+				RsrcImplDesc desc;
+				switch (state) {
+				case D3D12_RESOURCE_STATE_RENDER_TARGET: desc = D3D12_RENDER_TARGET_VIEW_DESC{}; break;
+				case D3D12_RESOURCE_STATE_DEPTH_WRITE: desc = RsrcImplDesc_DSV_Null{}; break;
+				case D3D12_RESOURCE_STATE_UNORDERED_ACCESS: desc = RsrcImplDesc_UAV_NULL{}; break;
+				default: desc = RsrcImplDesc_SRV_NULL{}; break;
+				}
+				rsrcMngr.RegisterPassRsrc(pass, rsrc, state, desc);
+			}
+		}
+	}
+};
+
+// replays the recorded barriers and discards, the state of every resource lives across passes and frames
+class Checker {
+public:
+	// checks the commands recorded before the pass
+	// - a resource constructed by the pass is activated by an aliasing barrier before any other barrier of it
+	// - a render target or depth stencil is then transitioned to its write state and discarded,
+	//   before any other transition
+	// - after the commands, every resource of the pass is in its requested state
+	void CheckPass(const Graph& graph, size_t pass, const PassRsrcs& passRsrcs, std::span<const Command> commands) {
+		const auto& constructs = graph.crst.pass2info.at(pass).construct_resources;
+
+		std::map<Rsrc*, size_t> rsrc2node;
+		for (auto [rsrc, state] : graph.uses[pass])
+			rsrc2node.emplace(passRsrcs.at(rsrc).resource, rsrc);
+
+		auto isConstructed = [&](Rsrc* pRsrc) {
+			return std::find(constructs.begin(), constructs.end(), rsrc2node.at(pRsrc)) != constructs.end();
+		};
+		auto initStateOf = [&](Rsrc* pRsrc) -> RsrcState {
+			auto flags = graph.descs[rsrc2node.at(pRsrc)].Flags;
+			if (flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET)
+				return D3D12_RESOURCE_STATE_RENDER_TARGET;
+			if (flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)
+				return D3D12_RESOURCE_STATE_DEPTH_WRITE;
+			return D3D12_RESOURCE_STATE_COMMON; // no discard
+		};
+
+		std::set<Rsrc*> aliased, discarded;
+		for (const auto& command : commands) {
+			if (command.Type == Command::Kind::Discard) {
+				Rsrc* pRsrc = command.pResource;
+				UDX12_CHECK(aliased.contains(pRsrc) && !discarded.contains(pRsrc));
+				UDX12_CHECK(initStateOf(pRsrc) != D3D12_RESOURCE_STATE_COMMON && StateOf(pRsrc) == initStateOf(pRsrc));
+				discarded.insert(pRsrc);
+				++numDiscards;
+				continue;
+			}
+
+			const auto& barrier = command.Barrier;
+			if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_ALIASING) {
+				Rsrc* pRsrc = barrier.Aliasing.pResourceAfter;
+				UDX12_CHECK(barrier.Aliasing.pResourceBefore == nullptr);
+				UDX12_CHECK(isConstructed(pRsrc) && aliased.insert(pRsrc).second);
+				++numAliasingBarriers;
+				continue;
+			}
+
+			UDX12_CHECK(barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION);
+			Rsrc* pRsrc = barrier.Transition.pResource;
+			UDX12_CHECK(barrier.Transition.StateBefore == StateOf(pRsrc));
+			if (isConstructed(pRsrc)) {
+				UDX12_CHECK(aliased.contains(pRsrc));
+				// the only transition before the discard is the one to the write state
+				if (initStateOf(pRsrc) != D3D12_RESOURCE_STATE_COMMON && !discarded.contains(pRsrc))
+					UDX12_CHECK(barrier.Transition.StateAfter == initStateOf(pRsrc));
+			}
+			states[pRsrc] = barrier.Transition.StateAfter;
+		}
+
+		for (auto [rsrc, state] : graph.uses[pass]) {
+			Rsrc* pRsrc = passRsrcs.at(rsrc).resource;
+			UDX12_CHECK(StateOf(pRsrc) == state);
+			if (isConstructed(pRsrc)) {
+				UDX12_CHECK(aliased.contains(pRsrc));
+				UDX12_CHECK(discarded.contains(pRsrc) == (initStateOf(pRsrc) != D3D12_RESOURCE_STATE_COMMON));
+			}
+		}
+	}
+
+	size_t numAliasingBarriers{ 0 };
+	size_t numDiscards{ 0 };
+
+private:
+	// placed resources are created in the common state
+	RsrcState StateOf(Rsrc* pRsrc) const {
+		auto target = states.find(pRsrc);
+		return target == states.end() ? D3D12_RESOURCE_STATE_COMMON : target->second;
+	}
+
+	std::map<Rsrc*, RsrcState> states;
+};
+
+// executes one frame, every pass sets a marker with its node index :
+// the commands of a command list between two markers are the barriers of the next pass
+// (temporal resources keep their state, so a pass has no barriers after it)
+static void RunFrame(Executor& executor, StubCommandQueue* queue, RsrcMngr& rsrcMngr, const Graph& graph, Checker& checker,
+	Executor::BatchPolicy policy, size_t numCmdLists)
+{
+	rsrcMngr.NewFrame();
+	graph.Register(rsrcMngr);
+
+	// the resources every pass function gets, written by the recording threads
+	PassRsrcs passRsrcs[NumPasses];
+	for (auto pass : graph.crst.sorted_passes) {
+		executor.RegisterPassFunc(pass, [pass, &passRsrcs](ID3D12GraphicsCommandList* cmdList, const PassRsrcs& rsrcs) {
+			passRsrcs[pass] = rsrcs;
+			cmdList->SetMarker(static_cast<UINT>(pass), nullptr, 0);
+		});
+	}
+
+	executor.SetBatchPolicy(policy);
+	queue->ClearSubmissions();
+	executor.Execute(queue, graph.crst, rsrcMngr);
+	static_cast<StubFence*>(executor.GetFence())->CompleteAll();
+
+	const auto submissions = queue->GetSubmissions();
+	UDX12_CHECK(submissions.size() == 1 && submissions.front().Commands.size() == numCmdLists);
+	UDX12_CHECK(queue->GetNumUnclosedCmdLists() == 0);
+
+	// the command lists are executed in order, so the resource states carry over from one list to the next
+	size_t order = 0;
+	for (const auto& commands : submissions.front().Commands) {
+		size_t begin = 0;
+		for (size_t i = 0; i < commands.size(); i++) {
+			if (commands[i].Type != Command::Kind::Marker)
+				continue;
+			const size_t pass = commands[i].Metadata;
+			UDX12_CHECK(pass == graph.crst.sorted_passes[order++]);
+
+			std::span<const Command> passCommands{ commands.data() + begin, i - begin };
+			checker.CheckPass(graph, pass, passRsrcs[pass], passCommands);
+
+			// consecutive barriers share one call, a discard splits them
+			std::set<size_t> calls;
+			size_t numDiscards = 0;
+			for (const auto& command : passCommands) {
+				calls.insert(command.Call);
+				if (command.Type == Command::Kind::Discard)
+					numDiscards++;
+			}
+			UDX12_CHECK(calls.size() <= 2 * numDiscards + 1);
+			begin = i + 1;
+		}
+		UDX12_CHECK(begin == commands.size());
+	}
+	UDX12_CHECK(order == NumPasses);
+}
+
+int main() {
+	Headless::StubDevice device;
+	DescriptorHeapMngr::Instance().Init(&device, 256, 64, 64, 64, 1024);
+	{
+		D3D12_COMMAND_QUEUE_DESC queueDesc{};
+		queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+		ComPtr<ID3D12CommandQueue> queue;
+		ThrowIfFailed(device.CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&queue)));
+
+		Graph graph;
+		Checker checker;
+		RsrcMngr rsrcMngr{ &device };
+		rsrcMngr.EnableAliasing(true);
+		Executor executor{ &device, 2 };
+
+		// a command list per pass, then passes 0 and 1 in one list, then all passes in one list
+		constexpr size_t NumFrames = 3;
+		const Executor::BatchPolicy policies[NumFrames] = { { 1, 1 }, { 2, 1 }, { 3, 1 } };
+		const size_t numCmdLists[NumFrames] = { 3, 2, 1 };
+		for (size_t frame = 0; frame < NumFrames; frame++) {
+			RunFrame(executor, static_cast<StubCommandQueue*>(queue.Get()), rsrcMngr, graph, checker,
+				policies[frame], numCmdLists[frame]);
+		}
+
+		// every resource is aliased, r2, r4 and r6 reuse memory
+		const auto& stats = rsrcMngr.GetAliasingStats();
+		UDX12_CHECK(stats.numAliasedRsrcs == NumRsrcs && stats.numPlans == 1);
+		UDX12_CHECK(stats.numHeapBytes < stats.numUnaliasedBytes);
+		UDX12_CHECK(device.GetNumPlacedResources() == NumRsrcs && device.GetNumCommittedResources() == 0);
+
+		// every frame activates every resource, 5 of them are render targets or depth stencils
+		UDX12_CHECK(checker.numAliasingBarriers == NumFrames * NumRsrcs);
+		UDX12_CHECK(checker.numDiscards == NumFrames * 5);
+
+		rsrcMngr.Clear();
+	}
+	DescriptorHeapMngr::Instance().Clear();
+
+	std::printf("barrier order : ok\n");
+	return 0;
+}
@@ -0,0 +1,152 @@
+#include "../headless/Check.h"
+#include "../headless/StubQueue.h"
+
+#include <UDX12/FrameGraph/Executor.h>
+#include <UDX12/FrameGraph/RsrcMngr.h>
+
+#include <random>
+
+using namespace Ubpa;
+using namespace Ubpa::UDX12;
+using namespace Ubpa::UDX12::FG;
+
+using Headless::RecordingCmdList;
+using Headless::StubCommandQueue;
+using Headless::StubFence;
+
+// passes without resources, the pass of order i is the node NumPasses - 1 - i,
+// so the costs are looked up by node index and not by order
+struct Graph {
+	UFG::Compiler::Result crst;
+
+	explicit Graph(size_t numPasses) {
+		crst.pass2order.resize(numPasses);
+		for (size_t order = 0; order < numPasses; order++) {
+			const size_t pass = numPasses - 1 - order;
+			crst.sorted_passes.push_back(pass);
+			crst.pass2order[pass] = order;
+			crst.pass2info[pass];
+		}
+	}
+};
+
+// executes one frame, every pass sets a marker with its node index,
+// returns the passes (in recording order) of every command list
+static std::vector<std::vector<size_t>> Execute(Executor& executor, StubCommandQueue* queue, RsrcMngr& rsrcMngr, const Graph& graph) {
+	rsrcMngr.NewFrame();
+	for (auto pass : graph.crst.sorted_passes) {
+		executor.RegisterPassFunc(pass, [pass](ID3D12GraphicsCommandList* cmdList, const PassRsrcs&) {
+			cmdList->SetMarker(static_cast<UINT>(pass), nullptr, 0);
+		});
+	}
+
+	queue->ClearSubmissions();
+	executor.Execute(queue, graph.crst, rsrcMngr);
+	static_cast<StubFence*>(executor.GetFence())->CompleteAll();
+
+	const auto submissions = queue->GetSubmissions();
+	UDX12_CHECK(submissions.size() == 1);
+	UDX12_CHECK(submissions.front().FenceValue == executor.GetLastFenceValue());
+	UDX12_CHECK(queue->GetNumUnclosedCmdLists() == 0);
+
+	std::vector<std::vector<size_t>> cmdLists;
+	for (const auto& commands : submissions.front().Commands) {
+		auto& passes = cmdLists.emplace_back();
+		for (const auto& command : commands) {
+			UDX12_CHECK(command.Type == RecordingCmdList::Command::Kind::Marker);
+			passes.push_back(command.Metadata);
+		}
+	}
+	return cmdLists;
+}
+
+// number of passes of every command list
+static std::vector<size_t> Group(ID3D12Device* device, StubCommandQueue* queue, const std::vector<size_t>& costs,
+	Executor::BatchPolicy policy)
+{
+	Graph graph{ costs.size() };
+	Executor executor{ device, 2 };
+	RsrcMngr rsrcMngr{ device };
+	executor.SetBatchPolicy(policy);
+	for (size_t order = 0; order < costs.size(); order++)
+		executor.RegisterPassCost(graph.crst.sorted_passes[order], costs[order]);
+
+	const auto cmdLists = Execute(executor, queue, rsrcMngr, graph);
+
+	// the command lists hold consecutive passes in the compiled order
+	std::vector<size_t> sizes;
+	size_t order = 0;
+	for (const auto& passes : cmdLists) {
+		UDX12_CHECK(!passes.empty());
+		for (auto pass : passes)
+			UDX12_CHECK(pass == graph.crst.sorted_passes[order++]);
+		sizes.push_back(passes.size());
+	}
+	UDX12_CHECK(order == costs.size());
+	return sizes;
+}
+
+static void TestGrouping(ID3D12Device* device, StubCommandQueue* queue) {
+	using Sizes = std::vector<size_t>;
+
+	// every pass has its own command list by default
+	UDX12_CHECK(Group(device, queue, { 1, 1, 1, 1, 1 }, {}) == Sizes({ 1, 1, 1, 1, 1 }));
+
+	// a command list is closed before a pass would exceed the target
+	UDX12_CHECK(Group(device, queue, { 3, 3, 3 }, { 5, 1 }) == Sizes({ 1, 1, 1 }));
+	UDX12_CHECK(Group(device, queue, { 2, 2, 2, 2, 2, 2 }, { 6, 1 }) == Sizes({ 3, 3 }));
+	UDX12_CHECK(Group(device, queue, { 1, 10, 1 }, { 4, 1 }) == Sizes({ 1, 1, 1 }));
+	UDX12_CHECK(Group(device, queue, { 1, 1, 1, 1 }, { 100, 1 }) == Sizes({ 4 }));
+
+	// the target is lowered to total cost / minNumCmdLists
+	UDX12_CHECK(Group(device, queue, { 1, 1, 1, 1, 6 }, { 8, 2 }) == Sizes({ 4, 1 }));
+	UDX12_CHECK(Group(device, queue, { 1, 1, 1, 1, 6 }, { 100, 3 }) == Sizes({ 3, 1, 1 }));
+
+	// the last passes are split when the costs alone give fewer command lists
+	UDX12_CHECK(Group(device, queue, { 0, 0, 0, 0 }, { 100, 3 }) == Sizes({ 2, 1, 1 }));
+	UDX12_CHECK(Group(device, queue, { 1, 1, 1 }, { 100, 10 }) == Sizes({ 1, 1, 1 }));
+}
+
+static void TestRandom(ID3D12Device* device, StubCommandQueue* queue) {
+	std::mt19937 rng{ 5 };
+	for (size_t i = 0; i < 200; i++) {
+		std::vector<size_t> costs(std::uniform_int_distribution<size_t>{ 1, 12 }(rng));
+		for (auto& cost : costs)
+			cost = std::uniform_int_distribution<size_t>{ 0, 8 }(rng);
+		Executor::BatchPolicy policy;
+		policy.targetCostPerCmdList = std::uniform_int_distribution<size_t>{ 0, 20 }(rng);
+		policy.minNumCmdLists = std::uniform_int_distribution<size_t>{ 0, 6 }(rng);
+
+		const auto sizes = Group(device, queue, costs, policy);
+
+		UDX12_CHECK(sizes.size() >= std::min(std::max<size_t>(policy.minNumCmdLists, 1), costs.size()));
+		// a shared command list never exceeds the target
+		size_t order = 0;
+		for (auto size : sizes) {
+			size_t cost = 0;
+			for (size_t j = 0; j < size; j++)
+				cost += costs[order++];
+			UDX12_CHECK(size == 1 || cost <= std::max<size_t>(policy.targetCostPerCmdList, 1));
+		}
+	}
+}
+
+int main() {
+	Headless::StubDevice device;
+	DescriptorHeapMngr::Instance().Init(&device, 256, 64, 64, 64, 1024);
+	{
+		D3D12_COMMAND_QUEUE_DESC queueDesc{};
+		queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+		ComPtr<ID3D12CommandQueue> queue;
+		ThrowIfFailed(device.CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&queue)));
+		auto* stubQueue = static_cast<StubCommandQueue*>(queue.Get());
+
+		TestGrouping(&device, stubQueue);
+		std::printf("grouping : ok\n");
+
+		TestRandom(&device, stubQueue);
+		std::printf("random : ok\n");
+	}
+	DescriptorHeapMngr::Instance().Clear();
+	return 0;
+}
@@ -0,0 +1,129 @@
+#include "../headless/Check.h"
+#include "../headless/StubQueue.h"
+
+#include <UDX12/FrameGraph/Executor.h>
+#include <UDX12/FrameGraph/RsrcMngr.h>
+
+#include <algorithm>
+#include <set>
+
+using namespace Ubpa;
+using namespace Ubpa::UDX12;
+using namespace Ubpa::UDX12::FG;
+
+using Headless::StubCommandAllocator;
+using Headless::StubCommandQueue;
+using Headless::StubFence;
+
+constexpr size_t NumPasses = 3;
+
+using Allocators = std::set<ID3D12CommandAllocator*>;
+
+// passes without resources, every pass has its own command list
+struct Graph {
+	UFG::Compiler::Result crst;
+
+	Graph() {
+		crst.pass2order.resize(NumPasses);
+		for (size_t pass = 0; pass < NumPasses; pass++) {
+			crst.sorted_passes.push_back(pass);
+			crst.pass2order[pass] = pass;
+			crst.pass2info[pass];
+		}
+	}
+};
+
+// executes one frame without completing it on the GPU, returns the allocators of its command lists
+static Allocators Execute(Executor& executor, StubCommandQueue* queue, RsrcMngr& rsrcMngr, const Graph& graph) {
+	rsrcMngr.NewFrame();
+	for (auto pass : graph.crst.sorted_passes)
+		executor.RegisterPassFunc(pass, [](ID3D12GraphicsCommandList*, const PassRsrcs&) {});
+
+	queue->ClearSubmissions();
+	executor.Execute(queue, graph.crst, rsrcMngr);
+
+	const auto submissions = queue->GetSubmissions();
+	UDX12_CHECK(submissions.size() == 1 && submissions.front().Commands.size() == NumPasses);
+	UDX12_CHECK(submissions.front().FenceValue == executor.GetLastFenceValue());
+	UDX12_CHECK(queue->GetNumUnclosedCmdLists() == 0);
+
+	const auto& allocators = submissions.front().Allocators;
+	Allocators frameAllocators{ allocators.begin(), allocators.end() };
+	// no allocator is shared by two command lists of a submission
+	UDX12_CHECK(frameAllocators.size() == NumPasses);
+	return frameAllocators;
+}
+
+static bool Disjoint(const Allocators& lhs, const Allocators& rhs) {
+	return std::none_of(lhs.begin(), lhs.end(), [&](auto* allocator) { return rhs.contains(allocator); });
+}
+
+// the command lists are created once and reset right after the submission,
+// an allocator is reset and reused only after the GPU completes the fence value of its submission
+static void TestReuse(Headless::StubDevice& device, StubCommandQueue* queue) {
+	Graph graph;
+	RsrcMngr rsrcMngr{ &device };
+	Executor executor{ &device, 2 };
+	auto* fence = static_cast<StubFence*>(executor.GetFence());
+
+	const size_t numAllocators = device.GetNumCommandAllocators();
+	const size_t numCmdLists = device.GetNumCommandLists();
+
+	// frame 1 and 2 are in flight, the allocators of frame 1 are not reused by frame 2
+	const auto allocators1 = Execute(executor, queue, rsrcMngr, graph);
+	UDX12_CHECK(executor.GetLastFenceValue() == 1);
+	const auto allocators2 = Execute(executor, queue, rsrcMngr, graph);
+	UDX12_CHECK(Disjoint(allocators1, allocators2));
+	UDX12_CHECK(device.GetNumCommandAllocators() == numAllocators + 2 * NumPasses);
+	UDX12_CHECK(device.GetNumCommandLists() == numCmdLists + NumPasses);
+
+	// the GPU completes frame 1 : frame 3 takes its allocators, the ones of frame 2 are still in flight
+	fence->Complete(1);
+	const auto allocators3 = Execute(executor, queue, rsrcMngr, graph);
+	UDX12_CHECK(allocators3 == allocators1);
+
+	// NewFrame() reclaims as well, frame 4 takes the allocators of frame 2
+	fence->Complete(2);
+	executor.NewFrame();
+	const auto allocators4 = Execute(executor, queue, rsrcMngr, graph);
+	UDX12_CHECK(allocators4 == allocators2);
+
+	// no new allocator or command list after the second frame
+	UDX12_CHECK(device.GetNumCommandAllocators() == numAllocators + 2 * NumPasses);
+	UDX12_CHECK(device.GetNumCommandLists() == numCmdLists + NumPasses);
+
+	// nothing completed : frame 5 needs new allocators
+	const auto allocators5 = Execute(executor, queue, rsrcMngr, graph);
+	UDX12_CHECK(Disjoint(allocators5, allocators3) && Disjoint(allocators5, allocators4));
+	UDX12_CHECK(device.GetNumCommandAllocators() == numAllocators + 3 * NumPasses);
+
+	size_t numResets = 0;
+	for (const auto* allocators : { &allocators1, &allocators2, &allocators5 }) {
+		for (auto* allocator : *allocators) {
+			auto* stubAllocator = static_cast<StubCommandAllocator*>(allocator);
+			UDX12_CHECK(stubAllocator->GetNumEarlyResets() == 0);
+			numResets += stubAllocator->GetNumResets();
+		}
+	}
+	UDX12_CHECK(numResets == 2 * NumPasses);
+
+	// the executor waits for frame 5 on destruction
+	UDX12_CHECK(fence->GetCompletedValue() == 2 && fence->GetSignaledValue() == 5);
+}
+
+int main() {
+	Headless::StubDevice device;
+	DescriptorHeapMngr::Instance().Init(&device, 256, 64, 64, 64, 1024);
+	{
+		D3D12_COMMAND_QUEUE_DESC queueDesc{};
+		queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+		ComPtr<ID3D12CommandQueue> queue;
+		ThrowIfFailed(device.CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&queue)));
+
+		TestReuse(device, static_cast<StubCommandQueue*>(queue.Get()));
+	}
+	DescriptorHeapMngr::Instance().Clear();
+
+	std::printf("executor command list pool : ok\n");
+	return 0;
+}
@@ -0,0 +1,175 @@
+#include "../headless/Check.h"
+#include "../headless/StubQueue.h"
+
+#include <UDX12/FrameGraph/Executor.h>
+#include <UDX12/FrameGraph/RsrcMngr.h>
+
+#include <map>
+#include <set>
+
+using namespace Ubpa;
+using namespace Ubpa::UDX12;
+using namespace Ubpa::UDX12::FG;
+
+using Headless::StubCommandQueue;
+using Headless::StubFence;
+
+constexpr size_t NumPasses = 2;
+constexpr size_t NumRsrcs = 3;
+
+//   pass 0 : r0 (RT)   r1 (depth)
+//   pass 1 : r0 (SRV)  r2 (UAV buffer)
+struct Graph {
+	UFG::Compiler::Result crst;
+	D3D12_RESOURCE_DESC descs[NumRsrcs];
+	RsrcState srvState{ D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE };
+
+	Graph() {
+		crst.sorted_passes = { 0, 1 };
+		crst.pass2order = { 0, 1 };
+		crst.pass2info[0].construct_resources = { 0, 1 };
+		crst.pass2info[0].destruct_resources = { 1 };
+		crst.pass2info[1].construct_resources = { 2 };
+		crst.pass2info[1].destruct_resources = { 0, 2 };
+
+		D3D12_RESOURCE_DESC rt{};
+		rt.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		rt.Width = 256;
+		rt.Height = 256;
+		rt.DepthOrArraySize = 1;
+		rt.MipLevels = 1;
+		rt.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		rt.SampleDesc.Count = 1;
+		rt.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+
+		D3D12_RESOURCE_DESC depth = rt;
+		depth.Format = DXGI_FORMAT_D32_FLOAT;
+		depth.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+
+		D3D12_RESOURCE_DESC buffer{};
+		buffer.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		buffer.Width = 64 * 1024;
+		buffer.Height = 1;
+		buffer.DepthOrArraySize = 1;
+		buffer.MipLevels = 1;
+		buffer.Format = DXGI_FORMAT_UNKNOWN;
+		buffer.SampleDesc.Count = 1;
+		buffer.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		buffer.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+		descs[0] = rt;
+		descs[1] = depth;
+		descs[2] = buffer;
+	}
+
+	void Register(RsrcMngr& rsrcMngr) const {
+		for (size_t i = 0; i < NumRsrcs; i++)
+			rsrcMngr.RegisterTemporalRsrc(i, descs[i]);
+
+		rsrcMngr.RegisterPassRsrc(0, 0, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RENDER_TARGET_VIEW_DESC{});
+		rsrcMngr.RegisterPassRsrc(0, 1, D3D12_RESOURCE_STATE_DEPTH_WRITE, RsrcImplDesc_DSV_Null{});
+		rsrcMngr.RegisterPassRsrc(1, 0, srvState, RsrcImplDesc_SRV_NULL{});
+		rsrcMngr.RegisterPassRsrc(1, 2, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, RsrcImplDesc_UAV_NULL{});
+	}
+};
+
+// (rsrcNodeIdx, view type) -> cpu handle
+using Handles = std::map<std::pair<size_t, char>, SIZE_T>;
+
+// executes one frame, the pass functions read the handles of their resources
+static Handles Execute(Executor& executor, StubCommandQueue* queue, RsrcMngr& rsrcMngr, const Graph& graph) {
+	rsrcMngr.NewFrame();
+	graph.Register(rsrcMngr);
+
+	Handles passHandles[NumPasses];
+	executor.RegisterPassFunc(0, [&passHandles](ID3D12GraphicsCommandList*, const PassRsrcs& rsrcs) {
+		passHandles[0][{ 0, 'r' }] = rsrcs.at(0).info->desc2info_rtv.at(D3D12_RENDER_TARGET_VIEW_DESC{}).cpuHandle.ptr;
+		passHandles[0][{ 1, 'd' }] = rsrcs.at(1).info->null_info_dsv.cpuHandle.ptr;
+	});
+	executor.RegisterPassFunc(1, [&passHandles](ID3D12GraphicsCommandList*, const PassRsrcs& rsrcs) {
+		const auto& srv = rsrcs.at(0).info->null_info_srv.at(RsrcDescInfo::CpuGpuInfo::DefaultID);
+		const auto& uav = rsrcs.at(2).info->null_info_uav.at(RsrcDescInfo::CpuGpuInfo::DefaultID);
+		passHandles[1][{ 0, 's' }] = srv.cpuHandle.ptr;
+		passHandles[1][{ 2, 'u' }] = uav.cpuHandle.ptr;
+	});
+
+	executor.Execute(queue, graph.crst, rsrcMngr);
+	static_cast<StubFence*>(executor.GetFence())->CompleteAll();
+
+	Handles handles;
+	std::set<SIZE_T> ptrs;
+	for (const auto& frameHandles : passHandles) {
+		for (const auto& [key, ptr] : frameHandles) {
+			// every view has a handle of its own
+			UDX12_CHECK(ptr != 0 && ptrs.insert(ptr).second);
+			handles.emplace(key, ptr);
+		}
+	}
+	UDX12_CHECK(handles.size() == 4);
+	return handles;
+}
+
+static bool Stats(const RsrcMngr& rsrcMngr, size_t numHits, size_t numMisses) {
+	const auto& stats = rsrcMngr.GetPlanCacheStats();
+	return stats.numHits == numHits && stats.numMisses == numMisses;
+}
+
+// the plan of last frame is replayed if the graph and the registrations are unchanged,
+// the replayed handles are the ones a fresh AllocateHandle assigns
+static void TestPlanCache(ID3D12Device* device, StubCommandQueue* queue) {
+	Graph graph;
+	RsrcMngr rsrcMngr{ device };
+	Executor executor{ device, 2 };
+
+	const auto handles = Execute(executor, queue, rsrcMngr, graph);
+	UDX12_CHECK(Stats(rsrcMngr, 0, 1));
+
+	UDX12_CHECK(Execute(executor, queue, rsrcMngr, graph) == handles);
+	UDX12_CHECK(Execute(executor, queue, rsrcMngr, graph) == handles);
+	UDX12_CHECK(Stats(rsrcMngr, 2, 1));
+
+	// Clear() drops the plan, the handles are assigned again
+	rsrcMngr.Clear();
+	UDX12_CHECK(Execute(executor, queue, rsrcMngr, graph) == handles);
+	UDX12_CHECK(Stats(rsrcMngr, 2, 2));
+	UDX12_CHECK(Execute(executor, queue, rsrcMngr, graph) == handles);
+	UDX12_CHECK(Stats(rsrcMngr, 3, 2));
+
+	// one changed state of a pass resource
+	graph.srvState = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+	UDX12_CHECK(Execute(executor, queue, rsrcMngr, graph) == handles);
+	UDX12_CHECK(Stats(rsrcMngr, 3, 3));
+	Execute(executor, queue, rsrcMngr, graph);
+	UDX12_CHECK(Stats(rsrcMngr, 4, 3));
+
+	// one changed temporal resource description
+	graph.descs[2].Width *= 2;
+	UDX12_CHECK(Execute(executor, queue, rsrcMngr, graph) == handles);
+	UDX12_CHECK(Stats(rsrcMngr, 4, 4));
+	Execute(executor, queue, rsrcMngr, graph);
+	UDX12_CHECK(Stats(rsrcMngr, 5, 4));
+
+	// back to the first registrations, the plan of the previous frame does not match
+	graph = Graph{};
+	UDX12_CHECK(Execute(executor, queue, rsrcMngr, graph) == handles);
+	UDX12_CHECK(Stats(rsrcMngr, 5, 5));
+
+	rsrcMngr.Clear();
+}
+
+int main() {
+	Headless::StubDevice device;
+	DescriptorHeapMngr::Instance().Init(&device, 256, 64, 64, 64, 1024);
+	{
+		D3D12_COMMAND_QUEUE_DESC queueDesc{};
+		queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+		ComPtr<ID3D12CommandQueue> queue;
+		ThrowIfFailed(device.CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&queue)));
+
+		TestPlanCache(&device, static_cast<StubCommandQueue*>(queue.Get()));
+	}
+	DescriptorHeapMngr::Instance().Clear();
+
+	std::printf("plan cache : ok\n");
+	return 0;
+}
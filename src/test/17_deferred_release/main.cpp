@@ -0,0 +1,178 @@
+#include "../headless/Check.h"
+#include "../headless/StubDevice.h"
+
+#include <UDX12/DescriptorHeap/CPUDescriptorHeap.h>
+#include <UDX12/DescriptorHeap/DescriptorHeapAllocMngr.h>
+#include <UDX12/DescriptorHeap/DescriptorReleaseQueue.h>
+#include <UDX12/DescriptorHeap/DynamicSuballocMngr.h>
+#include <UDX12/DescriptorHeap/GPUDescriptorHeap.h>
+
+#include <set>
+
+using namespace Ubpa::UDX12;
+
+// The fence is a plain counter : the frame N frees under fence value N,
+// "the GPU completes frame N" is ReleaseStaleAllocations(N)
+
+// frees go back to the manager
+class MngrParent final : public IDescriptorAllocator {
+public:
+	DescriptorHeapAllocMngr* mngr{ nullptr };
+
+	virtual DescriptorHeapAllocation Allocate(uint32_t Count) override { return mngr->Allocate(Count); }
+	virtual void Free(DescriptorHeapAllocation&& Allocation) override { mngr->FreeAllocation(std::move(Allocation)); }
+	virtual uint32_t GetDescriptorSize() const override { return Headless::StubDevice::DescriptorSize; }
+};
+
+// the allocations of the completed fence values are retired in one batch, the others stay in the queue
+static void TestQueue(ID3D12Device* device) {
+	constexpr uint32_t NumDescriptors = 64;
+
+	D3D12_DESCRIPTOR_HEAP_DESC desc{};
+	desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	desc.NumDescriptors = NumDescriptors;
+	CComPtr<ID3D12DescriptorHeap> heap;
+	UDX12_CHECK(SUCCEEDED(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&heap))));
+
+	MngrParent parent;
+	DescriptorHeapAllocMngr mngr{ device, parent, 0, heap, 0, NumDescriptors };
+	parent.mngr = &mngr;
+
+	DescriptorReleaseQueue queue;
+	// number of allocations pushed under the fence values 1, 2 and 3
+	constexpr size_t NumPushes[] = { 3, 1, 4 };
+	for (uint64_t fenceValue = 1; fenceValue <= 3; fenceValue++) {
+		queue.SetFenceValue(fenceValue);
+		UDX12_CHECK(queue.GetFenceValue() == fenceValue);
+		for (size_t i = 0; i < NumPushes[fenceValue - 1]; i++)
+			queue.Push(mngr.Allocate(2));
+	}
+	UDX12_CHECK(queue.GetSize() == 8);
+
+	size_t numBatches = 0;
+	size_t batchSize = 0;
+	auto release = [&](uint64_t completedFenceValue) {
+		numBatches = 0;
+		batchSize = 0;
+		queue.Release(completedFenceValue, [&](std::span<DescriptorHeapAllocation> allocations) {
+			++numBatches;
+			batchSize = allocations.size();
+			mngr.FreeAllocations(allocations);
+		});
+	};
+
+	// nothing is completed
+	release(0);
+	UDX12_CHECK(numBatches == 0 && queue.GetSize() == 8);
+	UDX12_CHECK(mngr.GetNumAvailableDescriptors() == NumDescriptors - 16);
+
+	release(1);
+	UDX12_CHECK(numBatches == 1 && batchSize == 3 && queue.GetSize() == 5);
+	UDX12_CHECK(mngr.GetNumAvailableDescriptors() == NumDescriptors - 10);
+
+	// the same completed value again retires nothing
+	release(1);
+	UDX12_CHECK(numBatches == 0 && queue.GetSize() == 5);
+
+	// fence values 2 and 3 at once
+	release(5);
+	UDX12_CHECK(numBatches == 1 && batchSize == 5 && queue.GetSize() == 0);
+	UDX12_CHECK(mngr.GetNumAvailableDescriptors() == NumDescriptors);
+}
+
+// a freed allocation is not handed out again before its fence completes,
+// one release returns every allocation of the completed frames to the pool
+static void TestCPUHeap(Headless::StubDevice& device) {
+	constexpr uint32_t NumDescriptorsInHeap = 8;
+
+	for (uint32_t cacheSize : { 0u, 4u }) {
+		CPUDescriptorHeap heap{ &device, NumDescriptorsInHeap, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+			D3D12_DESCRIPTOR_HEAP_FLAG_NONE, VarSizeAllocMngr::Backend::Tree, cacheSize };
+		heap.EnableDeferredRelease(true);
+
+		// frame 1 frees a full heap of single descriptors
+		heap.SetFrameFenceValue(1);
+		std::set<SIZE_T> freed;
+		for (uint32_t i = 0; i < NumDescriptorsInHeap; i++) {
+			auto allocation = heap.Allocate(1);
+			UDX12_CHECK(!allocation.IsNull());
+			freed.insert(allocation.GetCpuHandle().ptr);
+			heap.Free(std::move(allocation));
+		}
+		UDX12_CHECK(heap.GetNumHeaps() == 1);
+
+		// frame 2, the GPU has not completed frame 1
+		heap.SetFrameFenceValue(2);
+		heap.ReleaseStaleAllocations(0);
+		auto allocation = heap.Allocate(1);
+		UDX12_CHECK(!freed.contains(allocation.GetCpuHandle().ptr));
+		UDX12_CHECK(heap.GetNumHeaps() == 2);
+		heap.Free(std::move(allocation));
+
+		// frame 1 is completed, the first heap is free again, the allocation of frame 2 is still stale
+		heap.ReleaseStaleAllocations(1);
+		allocation = heap.Allocate(NumDescriptorsInHeap);
+		UDX12_CHECK(freed.contains(allocation.GetCpuHandle().ptr));
+		UDX12_CHECK(heap.GetNumHeaps() == 2);
+		heap.Free(std::move(allocation));
+
+		heap.ReleaseStaleAllocations(2);
+	}
+}
+
+// static and dynamic allocations (directly or through a DynamicSuballocMngr) go through the release queue
+static void TestGPUHeap(Headless::StubDevice& device) {
+	constexpr uint32_t NumStatic = 16;
+	constexpr uint32_t NumDynamic = 16;
+	constexpr uint32_t ChunkSize = 8;
+
+	GPUDescriptorHeap heap{ &device, NumStatic, NumDynamic, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+		D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE };
+	heap.EnableDeferredRelease(true);
+	DynamicSuballocMngr suballocMngr{ &heap, ChunkSize, "deferred release" };
+
+	// frame 1 fills the static and the dynamic region and frees everything
+	heap.SetFrameFenceValue(1);
+	heap.Free(heap.Allocate(NumStatic));
+	for (uint32_t i = 0; i < NumDynamic; i++)
+		UDX12_CHECK(!suballocMngr.Allocate(1).IsNull());
+	UDX12_CHECK(suballocMngr.GetSuballocationCount() == NumDynamic / ChunkSize);
+	suballocMngr.ReleaseAllocations();
+
+	// frame 2 frees under its own fence value
+	heap.SetFrameFenceValue(2);
+	heap.ReleaseStaleAllocations(0);
+	UDX12_CHECK(heap.Allocate(1).IsNull());
+	UDX12_CHECK(heap.AllocateDynamic(1).IsNull());
+
+	// frame 1 is completed, both regions are free in one release
+	heap.ReleaseStaleAllocations(1);
+	auto staticAllocation = heap.Allocate(NumStatic);
+	auto dynamicAllocation = heap.AllocateDynamic(NumDynamic);
+	UDX12_CHECK(!staticAllocation.IsNull() && !dynamicAllocation.IsNull());
+	heap.Free(std::move(staticAllocation));
+	heap.Free(std::move(dynamicAllocation));
+
+	// the frees of frame 2 wait for fence value 2
+	heap.ReleaseStaleAllocations(1);
+	UDX12_CHECK(heap.Allocate(1).IsNull());
+	heap.ReleaseStaleAllocations(2);
+	auto allocation = heap.Allocate(NumStatic);
+	UDX12_CHECK(!allocation.IsNull());
+	heap.Free(std::move(allocation));
+	heap.ReleaseStaleAllocations(2);
+
+	auto snapshot = heap.GetTelemetry()->GetSnapshot();
+	UDX12_CHECK(snapshot.NumDescriptorsInUse == 0);
+}
+
+int main() {
+	Headless::StubDevice device;
+
+	TestQueue(&device);
+	TestCPUHeap(device);
+	TestGPUHeap(device);
+
+	std::printf("deferred release : ok\n");
+	return 0;
+}
@@ -0,0 +1,80 @@
+#include "../headless/Check.h"
+#include "../headless/StubDevice.h"
+
+#include <UDX12/DescriptorHeap/CPUDescriptorHeap.h>
+#include <UDX12/DescriptorHeap/GPUDescriptorHeap.h>
+#include <UDX12/DescriptorHeap/SamplerCache.h>
+
+using namespace Ubpa::UDX12;
+
+constexpr size_t Capacity = 4;
+
+static D3D12_SAMPLER_DESC LinearWrap() {
+	D3D12_SAMPLER_DESC desc{};
+	desc.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+	desc.AddressU = desc.AddressV = desc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+	desc.MaxAnisotropy = 1;
+	desc.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+	desc.MaxLOD = 1000.0f;
+	return desc;
+}
+
+static bool Same(const SamplerCache::Sampler& lhs, const SamplerCache::Sampler& rhs) {
+	return lhs.CpuHandle.ptr == rhs.CpuHandle.ptr && lhs.GpuHandle.ptr == rhs.GpuHandle.ptr;
+}
+
+// identical descs share a sampler, -0.0f and +0.0f are identical, any other difference is a new sampler
+static void TestDedup(SamplerCache& cache, Headless::StubDevice& device) {
+	const size_t numViews = device.GetNumViews();
+
+	const auto desc = LinearWrap();
+	const auto sampler = cache.GetOrCreate(desc);
+	UDX12_CHECK(!sampler.IsNull());
+	UDX12_CHECK(Same(cache.GetOrCreate(desc), sampler));
+
+	auto negativeZero = desc;
+	negativeZero.MipLODBias = -0.0f;
+	negativeZero.MinLOD = -0.0f;
+	for (auto& channel : negativeZero.BorderColor)
+		channel = -0.0f;
+	UDX12_CHECK(Same(cache.GetOrCreate(negativeZero), sampler));
+
+	auto stats = cache.GetStats();
+	UDX12_CHECK(stats.NumSamplers == 1 && stats.NumMisses == 1 && stats.NumHits == 2);
+	UDX12_CHECK(device.GetNumViews() == numViews + 1);
+
+	auto border = desc;
+	border.BorderColor[3] = 1.0f;
+	auto bias = desc;
+	bias.MipLODBias = 0.5f;
+	auto maxLOD = desc;
+	maxLOD.MaxLOD = 4.0f;
+	for (const auto* other : { &border, &bias, &maxLOD }) {
+		auto otherSampler = cache.GetOrCreate(*other);
+		UDX12_CHECK(!otherSampler.IsNull() && !Same(otherSampler, sampler));
+	}
+	stats = cache.GetStats();
+	UDX12_CHECK(stats.NumSamplers == Capacity && stats.NumMisses == Capacity);
+
+	// the cache is full, the cached samplers are still returned
+	auto anisotropic = desc;
+	anisotropic.MaxAnisotropy = 16;
+	UDX12_CHECK(cache.GetOrCreate(anisotropic).IsNull());
+	UDX12_CHECK(Same(cache.GetOrCreate(negativeZero), sampler));
+	stats = cache.GetStats();
+	UDX12_CHECK(stats.NumRejected == 1 && stats.NumHits == 3);
+}
+
+int main() {
+	Headless::StubDevice device;
+	{
+		CPUDescriptorHeap cpuHeap{ &device, 16, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, D3D12_DESCRIPTOR_HEAP_FLAG_NONE };
+		GPUDescriptorHeap gpuHeap{ &device, 16, 0, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE };
+		SamplerCache cache{ &device, cpuHeap, gpuHeap, Capacity };
+
+		TestDedup(cache, device);
+	}
+
+	std::printf("sampler cache : ok\n");
+	return 0;
+}
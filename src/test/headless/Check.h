@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// assert that is kept in release builds, so the headless tests check something in every configuration
+#define UDX12_CHECK(expr)                                                                    \
+    do {                                                                                     \
+        if (!(expr)) {                                                                       \
+            std::fprintf(stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #expr);   \
+            std::abort();                                                                    \
+        }                                                                                    \
+    } while (false)
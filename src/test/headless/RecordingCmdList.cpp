@@ -0,0 +1,34 @@
+#include "RecordingCmdList.h"
+
+using namespace Ubpa::UDX12::Headless;
+
+void STDMETHODCALLTYPE RecordingCmdList::ResourceBarrier(UINT NumBarriers, const D3D12_RESOURCE_BARRIER* pBarriers) {
+	for (UINT i = 0; i < NumBarriers; i++)
+		m_Commands.push_back({ Command::Kind::Barrier, pBarriers[i], nullptr, m_NumCalls });
+	++m_NumCalls;
+}
+
+void STDMETHODCALLTYPE RecordingCmdList::DiscardResource(ID3D12Resource* pResource, const D3D12_DISCARD_REGION* pRegion) {
+	m_Commands.push_back({ Command::Kind::Discard, {}, pResource, m_NumCalls });
+	++m_NumCalls;
+}
+
+void STDMETHODCALLTYPE RecordingCmdList::SetMarker(UINT Metadata, const void* pData, UINT Size) {
+	m_Commands.push_back({ Command::Kind::Marker, {}, nullptr, m_NumCalls, Metadata });
+}
+
+HRESULT STDMETHODCALLTYPE RecordingCmdList::Close() {
+	if (m_Closed)
+		return E_FAIL;
+	m_Closed = true;
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE RecordingCmdList::Reset(ID3D12CommandAllocator* pAllocator, ID3D12PipelineState* pInitialState) {
+	if (!m_Closed || !pAllocator)
+		return E_FAIL;
+	Clear();
+	m_pAllocator = pAllocator;
+	m_Closed = false;
+	return S_OK;
+}
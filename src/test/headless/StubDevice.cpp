@@ -0,0 +1,166 @@
+#include "StubDevice.h"
+
+#include "StubQueue.h"
+
+using namespace Ubpa::UDX12::Headless;
+
+std::vector<D3D12_DESCRIPTOR_HEAP_DESC> StubDevice::GetDescriptorHeapDescs() {
+	std::lock_guard<std::mutex> lockGuard(m_Mutex);
+	return m_DescriptorHeapDescs;
+}
+
+std::vector<StubDevice::CopyCall> StubDevice::GetCopyCalls() {
+	std::lock_guard<std::mutex> lockGuard(m_Mutex);
+	return m_CopyCalls;
+}
+
+void StubDevice::ClearCopyCalls() {
+	std::lock_guard<std::mutex> lockGuard(m_Mutex);
+	m_CopyCalls.clear();
+}
+
+HRESULT STDMETHODCALLTYPE StubDevice::CreateDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC* pDescriptorHeapDesc, REFIID riid, void** ppvHeap) {
+	if (pDescriptorHeapDesc->NumDescriptors == 0 || (pDescriptorHeapDesc->NodeMask >> m_NodeCount) != 0)
+		return E_INVALIDARG;
+
+	// a gap of one descriptor between the heaps, so ranges of different heaps are never adjacent
+	const SIZE_T size = SIZE_T{ pDescriptorHeapDesc->NumDescriptors + 1 } * DescriptorSize;
+	D3D12_CPU_DESCRIPTOR_HANDLE cpuStart{ 0 };
+	D3D12_GPU_DESCRIPTOR_HANDLE gpuStart{ 0 };
+	{
+		std::lock_guard<std::mutex> lockGuard(m_Mutex);
+		m_DescriptorHeapDescs.push_back(*pDescriptorHeapDesc);
+		cpuStart.ptr = m_NextCPUDescriptor;
+		m_NextCPUDescriptor += size;
+		if (pDescriptorHeapDesc->Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE) {
+			gpuStart.ptr = m_NextGPUDescriptor;
+			m_NextGPUDescriptor += size;
+		}
+	}
+
+	*ppvHeap = static_cast<ID3D12DescriptorHeap*>(new StubDescriptorHeap(this, *pDescriptorHeapDesc, cpuStart, gpuStart));
+	return S_OK;
+}
+
+void STDMETHODCALLTYPE StubDevice::CopyDescriptors(UINT NumDestDescriptorRanges, const D3D12_CPU_DESCRIPTOR_HANDLE* pDestDescriptorRangeStarts,
+	const UINT* pDestDescriptorRangeSizes, UINT NumSrcDescriptorRanges, const D3D12_CPU_DESCRIPTOR_HANDLE* pSrcDescriptorRangeStarts,
+	const UINT* pSrcDescriptorRangeSizes, D3D12_DESCRIPTOR_HEAP_TYPE DescriptorHeapsType)
+{
+	CopyCall call;
+	call.Simple = false;
+	call.DstStarts.assign(pDestDescriptorRangeStarts, pDestDescriptorRangeStarts + NumDestDescriptorRanges);
+	// a null size array means ranges of 1 descriptor
+	if (pDestDescriptorRangeSizes)
+		call.DstSizes.assign(pDestDescriptorRangeSizes, pDestDescriptorRangeSizes + NumDestDescriptorRanges);
+	else
+		call.DstSizes.assign(NumDestDescriptorRanges, 1);
+	call.SrcStarts.assign(pSrcDescriptorRangeStarts, pSrcDescriptorRangeStarts + NumSrcDescriptorRanges);
+	if (pSrcDescriptorRangeSizes)
+		call.SrcSizes.assign(pSrcDescriptorRangeSizes, pSrcDescriptorRangeSizes + NumSrcDescriptorRanges);
+	else
+		call.SrcSizes.assign(NumSrcDescriptorRanges, 1);
+	call.Type = DescriptorHeapsType;
+
+	std::lock_guard<std::mutex> lockGuard(m_Mutex);
+	m_CopyCalls.push_back(std::move(call));
+}
+
+void STDMETHODCALLTYPE StubDevice::CopyDescriptorsSimple(UINT NumDescriptors, D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptorRangeStart,
+	D3D12_CPU_DESCRIPTOR_HANDLE SrcDescriptorRangeStart, D3D12_DESCRIPTOR_HEAP_TYPE DescriptorHeapsType)
+{
+	CopyCall call;
+	call.Simple = true;
+	call.DstStarts = { DestDescriptorRangeStart };
+	call.DstSizes = { NumDescriptors };
+	call.SrcStarts = { SrcDescriptorRangeStart };
+	call.SrcSizes = { NumDescriptors };
+	call.Type = DescriptorHeapsType;
+
+	std::lock_guard<std::mutex> lockGuard(m_Mutex);
+	m_CopyCalls.push_back(std::move(call));
+}
+
+D3D12_RESOURCE_ALLOCATION_INFO STDMETHODCALLTYPE StubDevice::GetResourceAllocationInfo(UINT visibleMask, UINT numResourceDescs,
+	const D3D12_RESOURCE_DESC* pResourceDescs)
+{
+	constexpr UINT64 alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+	D3D12_RESOURCE_ALLOCATION_INFO info{ 0, alignment };
+	for (UINT i = 0; i < numResourceDescs; i++) {
+		const auto& desc = pResourceDescs[i];
+		UINT64 size = desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER
+			? desc.Width
+			: desc.Width * desc.Height * desc.DepthOrArraySize * 4;
+		info.SizeInBytes += (size + alignment - 1) & ~(alignment - 1);
+	}
+	return info;
+}
+
+HRESULT STDMETHODCALLTYPE StubDevice::CreateCommittedResource(const D3D12_HEAP_PROPERTIES* pHeapProperties, D3D12_HEAP_FLAGS HeapFlags,
+	const D3D12_RESOURCE_DESC* pDesc, D3D12_RESOURCE_STATES InitialResourceState, const D3D12_CLEAR_VALUE* pOptimizedClearValue,
+	REFIID riidResource, void** ppvResource)
+{
+	D3D12_GPU_VIRTUAL_ADDRESS address;
+	{
+		std::lock_guard<std::mutex> lockGuard(m_Mutex);
+		address = m_NextGPUAddress;
+		m_NextGPUAddress += GetResourceAllocationInfo(0, 1, pDesc).SizeInBytes;
+	}
+	++m_NumCommittedResources;
+
+	*ppvResource = static_cast<ID3D12Resource*>(new StubResource(this, *pDesc, address));
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE StubDevice::CreateCommandQueue(const D3D12_COMMAND_QUEUE_DESC* pDesc, REFIID riid, void** ppCommandQueue) {
+	if ((pDesc->NodeMask >> m_NodeCount) != 0)
+		return E_INVALIDARG;
+
+	*ppCommandQueue = static_cast<ID3D12CommandQueue*>(new StubCommandQueue(this, *pDesc));
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE StubDevice::CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE type, REFIID riid, void** ppCommandAllocator) {
+	++m_NumCommandAllocators;
+
+	*ppCommandAllocator = static_cast<ID3D12CommandAllocator*>(new StubCommandAllocator(this, type));
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE StubDevice::CreateCommandList(UINT nodeMask, D3D12_COMMAND_LIST_TYPE type, ID3D12CommandAllocator* pCommandAllocator,
+	ID3D12PipelineState* pInitialState, REFIID riid, void** ppCommandList)
+{
+	if (type != D3D12_COMMAND_LIST_TYPE_DIRECT)
+		return E_NOTIMPL;
+	if ((nodeMask >> m_NodeCount) != 0 || !pCommandAllocator || static_cast<StubCommandAllocator*>(pCommandAllocator)->GetType() != type)
+		return E_INVALIDARG;
+	++m_NumCommandLists;
+
+	*ppCommandList = static_cast<ID3D12GraphicsCommandList*>(new RecordingCmdList(this, pCommandAllocator));
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE StubDevice::CreateFence(UINT64 InitialValue, D3D12_FENCE_FLAGS Flags, REFIID riid, void** ppFence) {
+	*ppFence = static_cast<ID3D12Fence*>(new StubFence(this, InitialValue));
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE StubDevice::CreateHeap(const D3D12_HEAP_DESC* pDesc, REFIID riid, void** ppvHeap) {
+	++m_NumHeaps;
+
+	*ppvHeap = static_cast<ID3D12Heap*>(new StubHeap(this, *pDesc));
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE StubDevice::CreatePlacedResource(ID3D12Heap* pHeap, UINT64 HeapOffset, const D3D12_RESOURCE_DESC* pDesc,
+	D3D12_RESOURCE_STATES InitialState, const D3D12_CLEAR_VALUE* pOptimizedClearValue, REFIID riid, void** ppvResource)
+{
+	if (HeapOffset + GetResourceAllocationInfo(0, 1, pDesc).SizeInBytes > pHeap->GetDesc().SizeInBytes)
+		return E_INVALIDARG;
+	++m_NumPlacedResources;
+
+	// resources placed in the same heap share the address range of the heap
+	auto address = reinterpret_cast<D3D12_GPU_VIRTUAL_ADDRESS>(pHeap) + HeapOffset;
+	*ppvResource = static_cast<ID3D12Resource*>(new StubResource(this, *pDesc, address, pHeap, HeapOffset));
+	return S_OK;
+}
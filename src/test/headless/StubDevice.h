@@ -0,0 +1,239 @@
+#pragma once
+
+#include <UDX12/Util.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace Ubpa::UDX12::Headless {
+	// Driverless stand-ins of the D3D12 objects, so the descriptor heaps and the frame graph run on any machine.
+	//
+	// Descriptor heaps hand out unique, non-overlapping CPU (and GPU for shader visible heaps) address ranges,
+	// the device records the calls the core code makes (descriptor heaps, copies, views, resources),
+	// command queues, allocators, lists and fences are the recording ones of StubQueue.h and
+	// everything else returns E_NOTIMPL or does nothing. All objects are thread safe, except command lists.
+
+	// COM object without a driver : refcounted, QueryInterface finds nothing, private data is dropped
+	template<typename Interface>
+	class StubObject : public Interface {
+	public:
+		virtual ~StubObject() = default;
+
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override {
+			if (!ppvObject)
+				return E_INVALIDARG;
+			*ppvObject = nullptr;
+			return E_NOINTERFACE;
+		}
+		ULONG STDMETHODCALLTYPE AddRef() override { return ++m_RefCount; }
+		ULONG STDMETHODCALLTYPE Release() override {
+			assert(m_RefCount > 0);
+			ULONG n = --m_RefCount;
+			if (n == 0)
+				delete this;
+			return n;
+		}
+
+		HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid, UINT* pDataSize, void* pData) override { return E_FAIL; }
+		HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid, UINT DataSize, const void* pData) override { return S_OK; }
+		HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid, const IUnknown* pData) override { return S_OK; }
+		HRESULT STDMETHODCALLTYPE SetName(LPCWSTR Name) override { return S_OK; }
+
+	private:
+		std::atomic<ULONG> m_RefCount{ 1 };
+	};
+
+	template<typename Interface>
+	class StubDeviceChild : public StubObject<Interface> {
+	public:
+		explicit StubDeviceChild(ID3D12Device* pDevice) : m_pDevice{ pDevice } {}
+
+		HRESULT STDMETHODCALLTYPE GetDevice(REFIID riid, void** ppvDevice) override {
+			m_pDevice->AddRef();
+			*ppvDevice = m_pDevice;
+			return S_OK;
+		}
+
+	protected:
+		ID3D12Device* m_pDevice;
+	};
+
+	class StubDescriptorHeap final : public StubDeviceChild<ID3D12DescriptorHeap> {
+	public:
+		StubDescriptorHeap(ID3D12Device* pDevice, const D3D12_DESCRIPTOR_HEAP_DESC& Desc,
+			D3D12_CPU_DESCRIPTOR_HANDLE CPUStart, D3D12_GPU_DESCRIPTOR_HANDLE GPUStart)
+			: StubDeviceChild{ pDevice }, m_Desc{ Desc }, m_CPUStart{ CPUStart }, m_GPUStart{ GPUStart } {}
+
+		D3D12_DESCRIPTOR_HEAP_DESC  STDMETHODCALLTYPE GetDesc() override { return m_Desc; }
+		D3D12_CPU_DESCRIPTOR_HANDLE STDMETHODCALLTYPE GetCPUDescriptorHandleForHeapStart() override { return m_CPUStart; }
+		D3D12_GPU_DESCRIPTOR_HANDLE STDMETHODCALLTYPE GetGPUDescriptorHandleForHeapStart() override { return m_GPUStart; }
+
+	private:
+		D3D12_DESCRIPTOR_HEAP_DESC  m_Desc;
+		D3D12_CPU_DESCRIPTOR_HANDLE m_CPUStart;
+		D3D12_GPU_DESCRIPTOR_HANDLE m_GPUStart; // 0 if the heap is not shader visible
+	};
+
+	class StubHeap final : public StubDeviceChild<ID3D12Heap> {
+	public:
+		StubHeap(ID3D12Device* pDevice, const D3D12_HEAP_DESC& Desc) : StubDeviceChild{ pDevice }, m_Desc{ Desc } {}
+
+		D3D12_HEAP_DESC STDMETHODCALLTYPE GetDesc() override { return m_Desc; }
+
+	private:
+		D3D12_HEAP_DESC m_Desc;
+	};
+
+	// Committed (pHeap == nullptr) or placed resource, Map() fails
+	class StubResource final : public StubDeviceChild<ID3D12Resource> {
+	public:
+		StubResource(ID3D12Device* pDevice, const D3D12_RESOURCE_DESC& Desc, D3D12_GPU_VIRTUAL_ADDRESS Address,
+			ID3D12Heap* pHeap = nullptr, UINT64 HeapOffset = 0)
+			: StubDeviceChild{ pDevice }, m_Desc{ Desc }, m_Address{ Address }, m_pHeap{ pHeap }, m_HeapOffset{ HeapOffset } {}
+
+		ID3D12Heap* GetHeap() const noexcept { return m_pHeap.Get(); }
+		UINT64      GetHeapOffset() const noexcept { return m_HeapOffset; }
+
+		HRESULT STDMETHODCALLTYPE Map(UINT Subresource, const D3D12_RANGE* pReadRange, void** ppData) override { return E_NOTIMPL; }
+		void    STDMETHODCALLTYPE Unmap(UINT Subresource, const D3D12_RANGE* pWrittenRange) override {}
+
+		D3D12_RESOURCE_DESC       STDMETHODCALLTYPE GetDesc() override { return m_Desc; }
+		D3D12_GPU_VIRTUAL_ADDRESS STDMETHODCALLTYPE GetGPUVirtualAddress() override { return m_Address; }
+
+		HRESULT STDMETHODCALLTYPE WriteToSubresource(UINT DstSubresource, const D3D12_BOX* pDstBox,
+			const void* pSrcData, UINT SrcRowPitch, UINT SrcDepthPitch) override { return E_NOTIMPL; }
+		HRESULT STDMETHODCALLTYPE ReadFromSubresource(void* pDstData, UINT DstRowPitch, UINT DstDepthPitch,
+			UINT SrcSubresource, const D3D12_BOX* pSrcBox) override { return E_NOTIMPL; }
+		HRESULT STDMETHODCALLTYPE GetHeapProperties(D3D12_HEAP_PROPERTIES* pHeapProperties,
+			D3D12_HEAP_FLAGS* pHeapFlags) override { return E_NOTIMPL; }
+
+	private:
+		D3D12_RESOURCE_DESC       m_Desc;
+		D3D12_GPU_VIRTUAL_ADDRESS m_Address;
+		ComPtr<ID3D12Heap>        m_pHeap;
+		UINT64                    m_HeapOffset;
+	};
+
+	class StubDevice final : public StubObject<ID3D12Device> {
+	public:
+		// increment size of every descriptor heap type
+		static constexpr UINT DescriptorSize = 32;
+
+		// NodeCount adapter nodes, every node mask in [1, 2^NodeCount) is accepted
+		explicit StubDevice(UINT NodeCount = 1) : m_NodeCount{ NodeCount } {}
+
+		// one CopyDescriptors() or CopyDescriptorsSimple() call
+		struct CopyCall {
+			bool                                     Simple;
+			std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> DstStarts;
+			std::vector<UINT>                        DstSizes;
+			std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> SrcStarts;
+			std::vector<UINT>                        SrcSizes;
+			D3D12_DESCRIPTOR_HEAP_TYPE               Type;
+		};
+
+		// snapshots of the records
+		std::vector<D3D12_DESCRIPTOR_HEAP_DESC> GetDescriptorHeapDescs();
+		std::vector<CopyCall>                   GetCopyCalls();
+		void                                    ClearCopyCalls();
+		size_t GetNumViews() const noexcept { return m_NumViews.load(); }
+		size_t GetNumCommittedResources() const noexcept { return m_NumCommittedResources.load(); }
+		size_t GetNumPlacedResources() const noexcept { return m_NumPlacedResources.load(); }
+		size_t GetNumHeaps() const noexcept { return m_NumHeaps.load(); }
+		size_t GetNumCommandAllocators() const noexcept { return m_NumCommandAllocators.load(); }
+		size_t GetNumCommandLists() const noexcept { return m_NumCommandLists.load(); }
+
+		UINT STDMETHODCALLTYPE GetNodeCount() override { return m_NodeCount; }
+
+		HRESULT STDMETHODCALLTYPE CreateCommandQueue(const D3D12_COMMAND_QUEUE_DESC* pDesc, REFIID riid, void** ppCommandQueue) override;
+		HRESULT STDMETHODCALLTYPE CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE type, REFIID riid, void** ppCommandAllocator) override;
+		HRESULT STDMETHODCALLTYPE CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC* pDesc, REFIID riid, void** ppPipelineState) override { return E_NOTIMPL; }
+		HRESULT STDMETHODCALLTYPE CreateComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC* pDesc, REFIID riid, void** ppPipelineState) override { return E_NOTIMPL; }
+		// direct command lists only
+		HRESULT STDMETHODCALLTYPE CreateCommandList(UINT nodeMask, D3D12_COMMAND_LIST_TYPE type, ID3D12CommandAllocator* pCommandAllocator,
+			ID3D12PipelineState* pInitialState, REFIID riid, void** ppCommandList) override;
+		HRESULT STDMETHODCALLTYPE CheckFeatureSupport(D3D12_FEATURE Feature, void* pFeatureSupportData, UINT FeatureSupportDataSize) override { return E_NOTIMPL; }
+
+		HRESULT STDMETHODCALLTYPE CreateDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC* pDescriptorHeapDesc, REFIID riid, void** ppvHeap) override;
+		UINT    STDMETHODCALLTYPE GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE DescriptorHeapType) override { return DescriptorSize; }
+
+		HRESULT STDMETHODCALLTYPE CreateRootSignature(UINT nodeMask, const void* pBlobWithRootSignature, SIZE_T blobLengthInBytes,
+			REFIID riid, void** ppvRootSignature) override { return E_NOTIMPL; }
+
+		void STDMETHODCALLTYPE CreateConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC* pDesc,
+			D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override { ++m_NumViews; }
+		void STDMETHODCALLTYPE CreateShaderResourceView(ID3D12Resource* pResource, const D3D12_SHADER_RESOURCE_VIEW_DESC* pDesc,
+			D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override { ++m_NumViews; }
+		void STDMETHODCALLTYPE CreateUnorderedAccessView(ID3D12Resource* pResource, ID3D12Resource* pCounterResource,
+			const D3D12_UNORDERED_ACCESS_VIEW_DESC* pDesc, D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override { ++m_NumViews; }
+		void STDMETHODCALLTYPE CreateRenderTargetView(ID3D12Resource* pResource, const D3D12_RENDER_TARGET_VIEW_DESC* pDesc,
+			D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override { ++m_NumViews; }
+		void STDMETHODCALLTYPE CreateDepthStencilView(ID3D12Resource* pResource, const D3D12_DEPTH_STENCIL_VIEW_DESC* pDesc,
+			D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override { ++m_NumViews; }
+		void STDMETHODCALLTYPE CreateSampler(const D3D12_SAMPLER_DESC* pDesc, D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptor) override { ++m_NumViews; }
+
+		void STDMETHODCALLTYPE CopyDescriptors(UINT NumDestDescriptorRanges, const D3D12_CPU_DESCRIPTOR_HANDLE* pDestDescriptorRangeStarts,
+			const UINT* pDestDescriptorRangeSizes, UINT NumSrcDescriptorRanges, const D3D12_CPU_DESCRIPTOR_HANDLE* pSrcDescriptorRangeStarts,
+			const UINT* pSrcDescriptorRangeSizes, D3D12_DESCRIPTOR_HEAP_TYPE DescriptorHeapsType) override;
+		void STDMETHODCALLTYPE CopyDescriptorsSimple(UINT NumDescriptors, D3D12_CPU_DESCRIPTOR_HANDLE DestDescriptorRangeStart,
+			D3D12_CPU_DESCRIPTOR_HANDLE SrcDescriptorRangeStart, D3D12_DESCRIPTOR_HEAP_TYPE DescriptorHeapsType) override;
+
+		// Width * Height * DepthOrArraySize * 4 bytes, 64KB aligned
+		D3D12_RESOURCE_ALLOCATION_INFO STDMETHODCALLTYPE GetResourceAllocationInfo(UINT visibleMask, UINT numResourceDescs,
+			const D3D12_RESOURCE_DESC* pResourceDescs) override;
+		D3D12_HEAP_PROPERTIES STDMETHODCALLTYPE GetCustomHeapProperties(UINT nodeMask, D3D12_HEAP_TYPE heapType) override { return {}; }
+
+		HRESULT STDMETHODCALLTYPE CreateCommittedResource(const D3D12_HEAP_PROPERTIES* pHeapProperties, D3D12_HEAP_FLAGS HeapFlags,
+			const D3D12_RESOURCE_DESC* pDesc, D3D12_RESOURCE_STATES InitialResourceState, const D3D12_CLEAR_VALUE* pOptimizedClearValue,
+			REFIID riidResource, void** ppvResource) override;
+		HRESULT STDMETHODCALLTYPE CreateHeap(const D3D12_HEAP_DESC* pDesc, REFIID riid, void** ppvHeap) override;
+		HRESULT STDMETHODCALLTYPE CreatePlacedResource(ID3D12Heap* pHeap, UINT64 HeapOffset, const D3D12_RESOURCE_DESC* pDesc,
+			D3D12_RESOURCE_STATES InitialState, const D3D12_CLEAR_VALUE* pOptimizedClearValue, REFIID riid, void** ppvResource) override;
+		HRESULT STDMETHODCALLTYPE CreateReservedResource(const D3D12_RESOURCE_DESC* pDesc, D3D12_RESOURCE_STATES InitialState,
+			const D3D12_CLEAR_VALUE* pOptimizedClearValue, REFIID riid, void** ppvResource) override { return E_NOTIMPL; }
+
+		HRESULT STDMETHODCALLTYPE CreateSharedHandle(ID3D12DeviceChild* pObject, const SECURITY_ATTRIBUTES* pAttributes, DWORD Access,
+			LPCWSTR Name, HANDLE* pHandle) override { return E_NOTIMPL; }
+		HRESULT STDMETHODCALLTYPE OpenSharedHandle(HANDLE NTHandle, REFIID riid, void** ppvObj) override { return E_NOTIMPL; }
+		HRESULT STDMETHODCALLTYPE OpenSharedHandleByName(LPCWSTR Name, DWORD Access, HANDLE* pNTHandle) override { return E_NOTIMPL; }
+		HRESULT STDMETHODCALLTYPE MakeResident(UINT NumObjects, ID3D12Pageable* const* ppObjects) override { return S_OK; }
+		HRESULT STDMETHODCALLTYPE Evict(UINT NumObjects, ID3D12Pageable* const* ppObjects) override { return S_OK; }
+
+		HRESULT STDMETHODCALLTYPE CreateFence(UINT64 InitialValue, D3D12_FENCE_FLAGS Flags, REFIID riid, void** ppFence) override;
+		HRESULT STDMETHODCALLTYPE GetDeviceRemovedReason() override { return S_OK; }
+
+		void STDMETHODCALLTYPE GetCopyableFootprints(const D3D12_RESOURCE_DESC* pResourceDesc, UINT FirstSubresource, UINT NumSubresources,
+			UINT64 BaseOffset, D3D12_PLACED_SUBRESOURCE_FOOTPRINT* pLayouts, UINT* pNumRows, UINT64* pRowSizeInBytes,
+			UINT64* pTotalBytes) override {}
+
+		HRESULT STDMETHODCALLTYPE CreateQueryHeap(const D3D12_QUERY_HEAP_DESC* pDesc, REFIID riid, void** ppvHeap) override { return E_NOTIMPL; }
+		HRESULT STDMETHODCALLTYPE SetStablePowerState(BOOL Enable) override { return S_OK; }
+		HRESULT STDMETHODCALLTYPE CreateCommandSignature(const D3D12_COMMAND_SIGNATURE_DESC* pDesc, ID3D12RootSignature* pRootSignature,
+			REFIID riid, void** ppvCommandSignature) override { return E_NOTIMPL; }
+
+		void STDMETHODCALLTYPE GetResourceTiling(ID3D12Resource* pTiledResource, UINT* pNumTilesForEntireResource,
+			D3D12_PACKED_MIP_INFO* pPackedMipDesc, D3D12_TILE_SHAPE* pStandardTileShapeForNonPackedMips, UINT* pNumSubresourceTilings,
+			UINT FirstSubresourceTilingToGet, D3D12_SUBRESOURCE_TILING* pSubresourceTilingsForNonPackedMips) override {}
+
+		LUID STDMETHODCALLTYPE GetAdapterLuid() override { return {}; }
+
+	private:
+		const UINT m_NodeCount;
+
+		std::mutex                              m_Mutex;
+		std::vector<D3D12_DESCRIPTOR_HEAP_DESC> m_DescriptorHeapDescs;
+		std::vector<CopyCall>                   m_CopyCalls;
+		// next free address of the descriptor heaps and the resources, guarded by m_Mutex
+		SIZE_T                                  m_NextCPUDescriptor{ 0x10000 };
+		UINT64                                  m_NextGPUDescriptor{ 0x10000 };
+		D3D12_GPU_VIRTUAL_ADDRESS               m_NextGPUAddress{ 0x10000 };
+
+		std::atomic<size_t> m_NumViews{ 0 };
+		std::atomic<size_t> m_NumCommittedResources{ 0 };
+		std::atomic<size_t> m_NumPlacedResources{ 0 };
+		std::atomic<size_t> m_NumHeaps{ 0 };
+		std::atomic<size_t> m_NumCommandAllocators{ 0 };
+		std::atomic<size_t> m_NumCommandLists{ 0 };
+	};
+}
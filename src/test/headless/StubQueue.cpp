@@ -0,0 +1,96 @@
+#include "StubQueue.h"
+
+#include <algorithm>
+
+using namespace Ubpa::UDX12::Headless;
+
+void StubFence::Complete(UINT64 Value) noexcept {
+	Value = std::min(Value, m_SignaledValue.load());
+	UINT64 completedValue = m_CompletedValue.load();
+	while (completedValue < Value && !m_CompletedValue.compare_exchange_weak(completedValue, Value))
+		;
+}
+
+HRESULT STDMETHODCALLTYPE StubFence::SetEventOnCompletion(UINT64 Value, HANDLE hEvent) {
+	if (hEvent)
+		return E_NOTIMPL;
+	if (Value > m_SignaledValue.load())
+		return E_FAIL;
+	Complete(Value);
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE StubFence::Signal(UINT64 Value) {
+	m_SignaledValue = Value;
+	m_CompletedValue = Value;
+	return S_OK;
+}
+
+void StubCommandAllocator::Submit() {
+	std::lock_guard<std::mutex> lockGuard(m_Mutex);
+	m_Unfenced = true;
+}
+
+void StubCommandAllocator::Fence(ID3D12Fence* pFence, UINT64 Value) {
+	std::lock_guard<std::mutex> lockGuard(m_Mutex);
+	m_Unfenced = false;
+	m_pFence = pFence;
+	m_FenceValue = Value;
+}
+
+HRESULT STDMETHODCALLTYPE StubCommandAllocator::Reset() {
+	std::lock_guard<std::mutex> lockGuard(m_Mutex);
+	if (m_Unfenced || (m_pFence && m_pFence->GetCompletedValue() < m_FenceValue)) {
+		++m_NumEarlyResets;
+		return E_FAIL;
+	}
+	m_pFence.Reset();
+	m_FenceValue = 0;
+	++m_NumResets;
+	return S_OK;
+}
+
+std::vector<StubCommandQueue::Submission> StubCommandQueue::GetSubmissions() {
+	std::lock_guard<std::mutex> lockGuard(m_Mutex);
+	return m_Submissions;
+}
+
+void StubCommandQueue::ClearSubmissions() {
+	std::lock_guard<std::mutex> lockGuard(m_Mutex);
+	m_Submissions.clear();
+	m_NumFencedSubmissions = 0;
+}
+
+void STDMETHODCALLTYPE StubCommandQueue::ExecuteCommandLists(UINT NumCommandLists, ID3D12CommandList* const* ppCommandLists) {
+	Submission submission;
+	submission.FenceValue = 0;
+	std::vector<ComPtr<StubCommandAllocator>> allocators;
+	for (UINT i = 0; i < NumCommandLists; i++) {
+		auto* cmdList = static_cast<RecordingCmdList*>(static_cast<ID3D12GraphicsCommandList*>(ppCommandLists[i]));
+		if (!cmdList->IsClosed())
+			++m_NumUnclosedCmdLists;
+		submission.Commands.push_back(cmdList->GetCommands());
+		submission.Allocators.push_back(cmdList->GetAllocator());
+
+		auto* allocator = static_cast<StubCommandAllocator*>(cmdList->GetAllocator());
+		allocator->Submit();
+		allocators.emplace_back(allocator);
+	}
+
+	std::lock_guard<std::mutex> lockGuard(m_Mutex);
+	m_Submissions.push_back(std::move(submission));
+	for (auto& allocator : allocators)
+		m_UnfencedAllocators.push_back(std::move(allocator));
+}
+
+HRESULT STDMETHODCALLTYPE StubCommandQueue::Signal(ID3D12Fence* pFence, UINT64 Value) {
+	static_cast<StubFence*>(pFence)->Enqueue(Value);
+
+	std::lock_guard<std::mutex> lockGuard(m_Mutex);
+	for (auto& allocator : m_UnfencedAllocators)
+		allocator->Fence(pFence, Value);
+	m_UnfencedAllocators.clear();
+	for (; m_NumFencedSubmissions < m_Submissions.size(); ++m_NumFencedSubmissions)
+		m_Submissions[m_NumFencedSubmissions].FenceValue = Value;
+	return S_OK;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "RecordingCmdList.h"
+
+namespace Ubpa::UDX12::Headless {
+	// There is no GPU behind the stub queue : a fence value signaled on the queue is completed only by
+	// StubFence::Complete() or by a blocking SetEventOnCompletion(), so a test decides when the GPU is done.
+
+	class StubFence final : public StubDeviceChild<ID3D12Fence> {
+	public:
+		StubFence(ID3D12Device* pDevice, UINT64 InitialValue)
+			: StubDeviceChild{ pDevice }, m_CompletedValue{ InitialValue }, m_SignaledValue{ InitialValue } {}
+
+		// the GPU reaches Value, clamped to the last value signaled on a queue
+		void   Complete(UINT64 Value) noexcept;
+		void   CompleteAll() noexcept { Complete(m_SignaledValue.load()); }
+		UINT64 GetSignaledValue() const noexcept { return m_SignaledValue.load(); }
+
+		// called by StubCommandQueue::Signal()
+		void Enqueue(UINT64 Value) noexcept { m_SignaledValue = Value; }
+
+		UINT64  STDMETHODCALLTYPE GetCompletedValue() override { return m_CompletedValue.load(); }
+		// a null event blocks until Value is completed : the signaled work up to Value completes at once,
+		// a value that is not signaled yet would block forever and fails instead
+		HRESULT STDMETHODCALLTYPE SetEventOnCompletion(UINT64 Value, HANDLE hEvent) override;
+		HRESULT STDMETHODCALLTYPE Signal(UINT64 Value) override;
+
+	private:
+		std::atomic<UINT64> m_CompletedValue;
+		std::atomic<UINT64> m_SignaledValue;
+	};
+
+	// Reset() fails with E_FAIL while the GPU may still execute a command list recorded into the allocator,
+	// i.e. the list is submitted and the queue has not signaled a completed fence value after it.
+	// Such resets are counted, a correct caller never makes one.
+	class StubCommandAllocator final : public StubDeviceChild<ID3D12CommandAllocator> {
+	public:
+		StubCommandAllocator(ID3D12Device* pDevice, D3D12_COMMAND_LIST_TYPE Type) : StubDeviceChild{ pDevice }, m_Type{ Type } {}
+
+		D3D12_COMMAND_LIST_TYPE GetType() const noexcept { return m_Type; }
+		size_t GetNumResets() const noexcept { return m_NumResets.load(); }
+		size_t GetNumEarlyResets() const noexcept { return m_NumEarlyResets.load(); }
+
+		// called by StubCommandQueue : a command list of the allocator is executed, the next Signal() fences it
+		void Submit();
+		void Fence(ID3D12Fence* pFence, UINT64 Value);
+
+		HRESULT STDMETHODCALLTYPE Reset() override;
+
+	private:
+		const D3D12_COMMAND_LIST_TYPE m_Type;
+
+		std::mutex          m_Mutex;
+		bool                m_Unfenced{ false };
+		ComPtr<ID3D12Fence> m_pFence;
+		UINT64              m_FenceValue{ 0 };
+
+		std::atomic<size_t> m_NumResets{ 0 };
+		std::atomic<size_t> m_NumEarlyResets{ 0 };
+	};
+
+	// Records every ExecuteCommandLists() call. The command lists must be RecordingCmdLists,
+	// their commands are copied because the caller resets and reuses the lists.
+	class StubCommandQueue final : public StubDeviceChild<ID3D12CommandQueue> {
+	public:
+		struct Submission {
+			std::vector<std::vector<RecordingCmdList::Command>> Commands;   // per command list
+			std::vector<ID3D12CommandAllocator*>                Allocators; // per command list, only for identity
+			UINT64                                              FenceValue; // value of the next Signal(), 0 until then
+		};
+
+		StubCommandQueue(ID3D12Device* pDevice, const D3D12_COMMAND_QUEUE_DESC& Desc) : StubDeviceChild{ pDevice }, m_Desc{ Desc } {}
+
+		// snapshots of the records
+		std::vector<Submission> GetSubmissions();
+		void                    ClearSubmissions();
+		size_t GetNumUnclosedCmdLists() const noexcept { return m_NumUnclosedCmdLists.load(); }
+
+		void STDMETHODCALLTYPE UpdateTileMappings(ID3D12Resource* pResource, UINT NumResourceRegions,
+			const D3D12_TILED_RESOURCE_COORDINATE* pResourceRegionStartCoordinates, const D3D12_TILE_REGION_SIZE* pResourceRegionSizes,
+			ID3D12Heap* pHeap, UINT NumRanges, const D3D12_TILE_RANGE_FLAGS* pRangeFlags, const UINT* pHeapRangeStartOffsets,
+			const UINT* pRangeTileCounts, D3D12_TILE_MAPPING_FLAGS Flags) override {}
+		void STDMETHODCALLTYPE CopyTileMappings(ID3D12Resource* pDstResource, const D3D12_TILED_RESOURCE_COORDINATE* pDstRegionStartCoordinate,
+			ID3D12Resource* pSrcResource, const D3D12_TILED_RESOURCE_COORDINATE* pSrcRegionStartCoordinate,
+			const D3D12_TILE_REGION_SIZE* pRegionSize, D3D12_TILE_MAPPING_FLAGS Flags) override {}
+
+		void STDMETHODCALLTYPE ExecuteCommandLists(UINT NumCommandLists, ID3D12CommandList* const* ppCommandLists) override;
+
+		void STDMETHODCALLTYPE SetMarker(UINT Metadata, const void* pData, UINT Size) override {}
+		void STDMETHODCALLTYPE BeginEvent(UINT Metadata, const void* pData, UINT Size) override {}
+		void STDMETHODCALLTYPE EndEvent() override {}
+
+		// pFence must be a StubFence
+		HRESULT STDMETHODCALLTYPE Signal(ID3D12Fence* pFence, UINT64 Value) override;
+		HRESULT STDMETHODCALLTYPE Wait(ID3D12Fence* pFence, UINT64 Value) override { return S_OK; }
+
+		HRESULT STDMETHODCALLTYPE GetTimestampFrequency(UINT64* pFrequency) override { return E_NOTIMPL; }
+		HRESULT STDMETHODCALLTYPE GetClockCalibration(UINT64* pGpuTimestamp, UINT64* pCpuTimestamp) override { return E_NOTIMPL; }
+		D3D12_COMMAND_QUEUE_DESC STDMETHODCALLTYPE GetDesc() override { return m_Desc; }
+
+	private:
+		const D3D12_COMMAND_QUEUE_DESC m_Desc;
+
+		std::mutex                                m_Mutex;
+		std::vector<Submission>                   m_Submissions;
+		size_t                                    m_NumFencedSubmissions{ 0 };
+		std::vector<ComPtr<StubCommandAllocator>> m_UnfencedAllocators;
+
+		std::atomic<size_t> m_NumUnclosedCmdLists{ 0 };
+	};
+}